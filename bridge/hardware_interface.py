@@ -10,20 +10,42 @@ import serial
 
 spacelock = serial.Serial('/dev/ttyS0', baudrate=9600)
 
-def send_code(code):
-    print("sending code: %r" % (code,))
-    spacelock.write((code + '\n').encode())
+def read_reply(timeout=2.0, quiet=0.05):
+    """
+    reads what the door replies until nothing has arrived for `quiet`
+    seconds: at 9600 baud, the reply to 'status' alone takes 125 ms
+    """
+    reply = b''
+    deadline = time.monotonic() + timeout
     time.sleep(0.1)
-    reply = spacelock.read(spacelock.in_waiting).decode(errors='replace')
+    while time.monotonic() < deadline:
+        waiting = spacelock.in_waiting
+        if waiting == 0 and reply:
+            break
+        reply += spacelock.read(waiting)
+        time.sleep(quiet)
+    reply = reply.decode(errors='replace')
     print("reply: %r" % (reply,))
     return reply
 
+def send_code(code):
+    print("sending code: %r" % (code,))
+    spacelock.write((code + '\n').encode())
+    return read_reply()
+
+def send_frame(frame):
+    print("sending frame: %s" % (frame.hex(),))
+    spacelock.write(frame)
+    return read_reply()
+
 class RequestHandler(BaseHTTPRequestHandler):
     def do_GET(self):
         result = ''
         try:
             if self.path.startswith('/send/'):
                 result = send_code(self.path[6:])
+            elif self.path.startswith('/frame/'):
+                result = send_frame(bytes.fromhex(self.path[7:]))
         except BaseException as exc:
             result = str(exc)
             self.send_response(503)
@@ -9,23 +9,87 @@ GPLv3 or later
 """
 
 import argparse
+import base64
+import binascii
+import struct
 import subprocess
 
 import serial
 
-cli = argparse.ArgumentParser()
-cli.add_argument('--device', default="/dev/ttyUSB0")
-args = cli.parse_args()
+# the binary framing of the door, see firmware/src/binary_frame.h
+FRAME_START = b'\xa5'
+FRAME_END = b'\x00'
+# HMAC signature and the smallest header
+MIN_MESSAGE_SIZE = 16 + 8 + 1
 
-print("launching serial bridge...")
 
-serial = serial.Serial(args.device, 9600)
+def cobs_encode(data):
+    """
+    consistent overhead byte stuffing: the result has no 0 byte.
+    each block is the number of bytes up to the next 0, plus one,
+    followed by those bytes; a block of 0xff has no 0 after it.
+    """
+    encoded = bytearray()
+    block = bytearray()
+    for byte in data:
+        if byte == 0:
+            encoded += bytes([len(block) + 1]) + block
+            block = bytearray()
+            continue
+        block.append(byte)
+        if len(block) == 254:
+            encoded += b'\xff' + block
+            block = bytearray()
+    encoded += bytes([len(block) + 1]) + block
+    return bytes(encoded)
 
-def send(text):
-    subprocess.call(['curl', 'http://localhost:8000/send/' + text])
 
-while True:
-    message = serial.readline()
-    message = message.decode().strip()
-    print(f"Message:\n{message!r}")
-    send(message)
+def encode_frame(message):
+    """
+    a binary frame for the message as it is signed, without base64:
+    its length, the message and the CRC-16/CCITT-FALSE of both
+    """
+    body = bytes([len(message)]) + message
+    body += struct.pack('<H', binascii.crc_hqx(body, 0xffff))
+    return FRAME_START + cobs_encode(body) + FRAME_END
+
+
+def decode_token(text):
+    """ the signed message of a base64 token, or None for other text """
+    try:
+        message = base64.b64decode(text.translate(str.maketrans('-_', '+/')), validate=True)
+    except binascii.Error:
+        return None
+    if len(message) < MIN_MESSAGE_SIZE:
+        return None
+    return message
+
+
+def main():
+    cli = argparse.ArgumentParser()
+    cli.add_argument('--device', default="/dev/ttyUSB0")
+    cli.add_argument('--binary', action='store_true',
+                     help="send tokens to the door in binary frames instead of base64 lines")
+    args = cli.parse_args()
+
+    print("launching serial bridge...")
+
+    port = serial.Serial(args.device, 9600)
+
+    def send(text):
+        message = decode_token(text) if args.binary else None
+        if message is None:
+            subprocess.call(['curl', 'http://localhost:8000/send/' + text])
+        else:
+            frame = encode_frame(message)
+            subprocess.call(['curl', 'http://localhost:8000/frame/' + frame.hex()])
+
+    while True:
+        message = port.readline()
+        message = message.decode().strip()
+        print(f"Message:\n{message!r}")
+        send(message)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+
+"""
+set the door's clock to the database time whenever it doesn't know
+the time well, e.g. after a reset, instead of waiting for DCF77
+
+GPLv3 or later
+"""
+
+import argparse
+import json
+import re
+import time
+import urllib.request
+
+cli = argparse.ArgumentParser()
+cli.add_argument('--door', default="http://localhost:8000",
+                 help="the hardware interface that talks to the door")
+cli.add_argument('--api', required=True,
+                 help="the web frontend, e.g. https://door.example.org")
+cli.add_argument('--key', required=True,
+                 help="a permission key with timeset access")
+cli.add_argument('--interval', type=float, default=60,
+                 help="seconds between the status queries")
+# the door only takes the time from a message once it may be off by
+# more than time_set::SET_UNCERTAINTY_US
+cli.add_argument('--max-uncertainty', type=float, default=4,
+                 help="the door's clock is set once it may be off by more seconds")
+args = cli.parse_args()
+
+
+def door(text):
+    with urllib.request.urlopen(f"{args.door}/send/{text}") as reply:
+        return reply.read().decode(errors='replace')
+
+
+def signed_time(sequence):
+    request = urllib.request.Request(
+        f"{args.api}/api/timeset",
+        data=json.dumps({'key': args.key, 'sequence': sequence}).encode(),
+        headers={'Content-Type': 'application/json'},
+    )
+    with urllib.request.urlopen(request) as reply:
+        return json.loads(reply.read())['token']
+
+
+def sync():
+    status = door('status')
+    sequence = re.search(r'time set sequence (\d+)', status)
+    if sequence is None:
+        print(f"no status: {status!r}")
+        return
+
+    uncertainty = re.search(r'off by up to ([0-9.]+) s', status)
+    if uncertainty is not None and float(uncertainty.group(1)) <= args.max_uncertainty:
+        return
+
+    token = signed_time(int(sequence.group(1)) + 1)
+    print(f"setting time: {door(token)!r}")
+
+
+while True:
+    try:
+        sync()
+    except Exception as exc:
+        print(f"time sync failed: {exc}")
+    time.sleep(args.interval)
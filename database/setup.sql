@@ -15,6 +15,9 @@
 -- * enable further users with `user_grant_access(admin_password, requestid, ...)
 -- * change a user's settings with `user_mod(admin_password, requestid, ...)`
 -- * generate an door-opening token with `gen_token(password)`
+-- * set the door's clock with `gen_timeset(password, sequence)`, which needs
+--   the timeset permission: give it only to the user of bridge/time_sync.py,
+--   with `update permissions set timeset = true where reqid = ...`
 --
 -- * to update the database's secret key
 
@@ -62,6 +65,12 @@ exception
 	when duplicate_table then null;
 end $$;
 
+-- sign door-opening tokens in the compact format. only turn this on
+-- once every door runs firmware that reads it; the firmware before
+-- it rejects all compact tokens.
+alter table signer add column if not exists
+	compact_tokens boolean not null default false;
+
 
 -- permission definitions for door users
 create table if not exists permissions(
@@ -79,6 +88,12 @@ create table if not exists permissions(
 	hidden boolean not null default false          -- hide the user from the user list
 );
 
+-- may this user set the door's clock. a time-set message can be held
+-- back and replayed after the door lost its time, which turns back the
+-- clock for old tokens, so this is only for the time sync bridge.
+alter table permissions add column if not exists
+	timeset boolean not null default false;
+
 
 -- token and access grant log
 create table if not exists log(
@@ -114,6 +129,52 @@ create or replace function sign_message(
 $$ language plpython3u;
 
 
+-- the same in the compact format: the validity window as seconds
+-- since 2020-01-01 and a duration in minutes, and the format version 2
+-- where the legacy format has the top byte of its start time
+create or replace function sign_message_v2(
+	signing_key text,
+	now_timestamp double precision,
+	validity_window_size int,
+	message_type int,
+	payload_b64 text
+) returns text as $$
+	import base64
+	import hmac
+	import struct
+
+	epoch = 1577836800
+	duration_minutes = -(-2 * validity_window_size // 60)
+
+	message_blob = struct.pack(
+		'<IHBB',
+		int(now_timestamp) - validity_window_size - epoch,
+		min(max(duration_minutes, 1), 65535),
+		message_type,
+		2
+	) + base64.b64decode(payload_b64.encode())
+	signing_key_blob = base64.b64decode(signing_key.encode())
+
+	signature = hmac.new(signing_key_blob, msg=message_blob, digestmod='sha256').digest()
+	combined_blob = signature[:16] + message_blob
+	return base64.b64encode(combined_blob).decode()
+$$ language plpython3u;
+
+
+-- payload of a compact door-opening message: the numeric user id,
+-- or null if it doesn't fit into 32 bits
+create or replace function uid_payload(
+	id bigint
+) returns text as $$
+	import base64
+	import struct
+
+	if not 0 <= id <= 0xffffffff:
+		return None
+	return base64.b64encode(struct.pack('<I', id)).decode()
+$$ language plpython3u;
+
+
 -- check message signature of a key-update message
 -- if signature is invalid, return null
 -- return the extracted payload as base64
@@ -172,10 +233,12 @@ $$ language plpython3u;
 
 
 do $$ begin
-	create type access_class as enum ('token', 'usermod', 'keyupdate');
+	create type access_class as enum ('token', 'usermod', 'keyupdate', 'timeset');
 exception
 	when duplicate_object then null;
 end $$;
+-- for databases from before the timeset permission (PostgreSQL 12 or later)
+alter type access_class add value if not exists 'timeset';
 
 
 -- permission verification is done here:
@@ -195,6 +258,7 @@ begin
 		valid_to >= now_time and (
 			(what = 'usermod' and usermod is true) or
 			(what = 'keyupdate' and keyupdate is true) or
+			(what = 'timeset' and timeset is true) or
 			(what = 'token')
 		);
 
@@ -221,6 +285,7 @@ declare now_time timestamp with time zone;
 declare signing_key text;
 declare token text;
 declare token_duration int;
+declare compact boolean;
 begin
 	select now() into now_time;
 
@@ -231,7 +296,7 @@ begin
 		return null;
 	end if;
 
-	select secret into signing_key from signer limit 1;
+	select secret, compact_tokens into signing_key, compact from signer limit 1;
 	if signing_key is null then
 		return null;
 	end if;
@@ -242,17 +307,29 @@ begin
 		0)
 	into token_duration;
 
-	select sign_message(
-		signing_key,
-		extract(epoch from now_time),
-		token_duration,
-		(case
-		 when msg_type = 'token' then 1        -- message type 1: open door
-		 when msg_type = 'keyupdate' then 2    -- message type 2: secret key update
-		 else -1
-		 end),
-		payload
-	) into token;
+	-- door-opening messages may use the compact format; key updates
+	-- stay in the legacy one, which extract_keyupdate() reads
+	if msg_type = 'token' and compact then
+		select sign_message_v2(
+			signing_key,
+			extract(epoch from now_time),
+			token_duration,
+			1,                                 -- message type 1: open door
+			payload
+		) into token;
+	else
+		select sign_message(
+			signing_key,
+			extract(epoch from now_time),
+			token_duration,
+			(case
+			 when msg_type = 'token' then 1        -- message type 1: open door
+			 when msg_type = 'keyupdate' then 2    -- message type 2: secret key update
+			 else -1
+			 end),
+			payload
+		) into token;
+	end if;
 
 	insert into log (who, what) values (
 		entry.id,
@@ -272,6 +349,7 @@ create or replace function gen_token(
 returns text as $$
 declare entry_id bigint;
 declare entry permissions%ROWTYPE;
+declare payload text;
 begin
 	select can_access(permission_key, 'token') into entry_id;
 	select * into entry from permissions where id = entry_id;
@@ -280,10 +358,20 @@ begin
 		return null;
 	end if;
 
+	-- the same format as gen_message() signs in
+	if (select compact_tokens from signer limit 1) then
+		select uid_payload(entry.id) into payload;
+	else
+		select encode(convert_to(entry.reqid, 'UTF8'), 'base64') into payload;
+	end if;
+	if payload is null then
+		return null;
+	end if;
+
 	return gen_message(
 		permission_key,
 		'token',
-		encode(convert_to(entry.reqid, 'UTF8'), 'base64')
+		payload
 	);
 end;
 $$ language plpgsql
@@ -309,6 +397,70 @@ $$ language plpgsql
 security definer;
 
 
+-- payload of a time-set message: the time in us and the sequence number
+create or replace function timeset_payload(
+	now_timestamp double precision,
+	sequence bigint
+) returns text as $$
+	import base64
+	import struct
+
+	return base64.b64encode(struct.pack(
+		'<QI',
+		int(now_timestamp * 1000000),
+		sequence
+	)).decode()
+$$ language plpython3u;
+
+
+-- create a message that sets the door's clock to the database time.
+-- the sequence number must be the one after the door's last one,
+-- which it reports on 'status'. only for users with the timeset
+-- permission, see the permissions table.
+create or replace function gen_timeset(
+	permission_key text,
+	sequence bigint
+)
+returns text as $$
+declare entry_id bigint;
+declare now_time timestamp with time zone;
+declare signing_key text;
+declare token text;
+begin
+	-- the time is taken when the message is signed, not at the
+	-- start of the transaction
+	select clock_timestamp() into now_time;
+
+	select can_access(permission_key, 'timeset') into entry_id;
+	if entry_id is null or sequence < 1 or sequence >= 4294967295 then
+		return null;
+	end if;
+
+	select secret into signing_key from signer limit 1;
+	if signing_key is null then
+		return null;
+	end if;
+
+	-- a window of two minutes, as the firmware allows at most 120 s
+	select sign_message_v2(
+		signing_key,
+		extract(epoch from now_time),
+		60,
+		4,                                     -- message type 4: set the time
+		timeset_payload(extract(epoch from now_time), sequence)
+	) into token;
+
+	insert into log (who, what) values (
+		entry_id,
+		format('emit timeset %s: %s', sequence, token)
+	);
+
+	return token;
+end;
+$$ language plpgsql
+security definer;
+
+
 -- update the key that is used for signing messages
 -- this function is called after the door key was updated
 create or replace function update_signingkey(
@@ -5,6 +5,7 @@ import datetime
 import struct
 
 HMAC_SIZE = 16
+EPOCH_V2 = 1577836800
 DT_FMT = '%Y-%m-%d %H:%M:%S %Z'
 
 
@@ -22,12 +23,34 @@ def main():
     hmac = binary[:HMAC_SIZE]
     print(f'HMAC:        {binascii.hexlify(hmac).decode("ascii")}')
 
-    valid_from, valid_until = struct.unpack_from('<QQ', binary, HMAC_SIZE)
+    # byte 7 is the top byte of valid_from in the legacy format,
+    # and the format version in the compact one
+    version = binary[HMAC_SIZE + 7]
+    if version == 0:
+        valid_from, valid_until, msg_type = struct.unpack_from('<QQB', binary, HMAC_SIZE)
+        payload = binary[HMAC_SIZE + struct.calcsize('<QQB'):]
+        version = 1
+    elif version == 1:
+        print('format:      unknown (byte 7 is 1)')
+        return
+    else:
+        offset, duration, msg_type, _ = struct.unpack_from('<IHBB', binary, HMAC_SIZE)
+        payload = binary[HMAC_SIZE + struct.calcsize('<IHBB'):]
+        valid_from = EPOCH_V2 + offset
+        valid_until = valid_from + 60 * duration - 1
+
+    print(f'format:      {version} ({len(binary)} bytes)')
     print(f'valid from:  {format_datetime(valid_from)} [{valid_from}]')
     print(f'valid until: {format_datetime(valid_until)} [{valid_until}]')
-
-    user_id = binary[HMAC_SIZE + 2 * 8:].decode('ascii', errors='replace')
-    print(f'User ID:     {user_id}')
+    print(f'type:        {msg_type}')
+
+    if msg_type != 1:
+        print(f'payload:     {binascii.hexlify(payload).decode("ascii")}')
+    elif version == 1:
+        print(f'User ID:     {payload.decode("ascii", errors="replace")}')
+    else:
+        user_id, = struct.unpack_from('<I', payload)
+        print(f'User ID:     {user_id}')
 
 if __name__ == '__main__':
     main()
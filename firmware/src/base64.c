@@ -1,63 +1,202 @@
 #include "base64.h"
 
+// maps characters to their 6-bit values.
+// characters that are not in the alphabet have the BASE64_INVALID bit set;
+// this includes the padding character '='.
+#define BASE64_INVALID 0x80
+
+// A-Z a-z 0-9 + /
+static const uint8_t BASE64_TABLE_STANDARD[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3e, 0x80, 0x80, 0x80, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+// A-Z a-z 0-9 - _
+static const uint8_t BASE64_TABLE_URLSAFE[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3e, 0x80, 0x80,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x3f,
+    0x80, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+// A-Z a-z 0-9 + / - _
+static const uint8_t BASE64_TABLE_ANY[256] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x3e, 0x80, 0x3e, 0x80, 0x3f,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+    0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x80, 0x80, 0x80, 0x80, 0x3f,
+    0x80, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+};
+
+static const uint8_t *base64_table(enum base64_alphabet alphabet) {
+    switch (alphabet) {
+    case BASE64_URLSAFE: return BASE64_TABLE_URLSAFE;
+    case BASE64_ANY:     return BASE64_TABLE_ANY;
+    default:             return BASE64_TABLE_STANDARD;
+    }
+}
+
 /**
- * buf[:(bufsize/4)*4+4] must be readable and writable,
- * and buf[:bufsize] must contain valid data,
- * otherwise the behavior is undefined.
- * the result will be written to buf, and the result size returned.
- * the remainder of buf will have undefined content.
+ * decodes the final 2 or 3 characters (value holds 12 or 18 bits).
+ * the unused low bits must be zero, otherwise the encoding is not canonical.
+ * returns the number of bytes written, or -1 if the input is invalid.
  */
-uint32_t base64_decode(uint8_t *buf, uint32_t bufsize) {
-    // fix the padding
-    while (bufsize % 4) { buf[bufsize++] = '='; }
-
-    uint8_t *result = buf;
-    uint32_t resultsize = 0;
-    uint8_t *end = &buf[bufsize];
-
-    while (buf != end) {
-        // decode one quadruplet, write one triplet to result
-        uint32_t word_value = 0;
-        uint32_t word_chars = 3;
-
-        for (uint32_t i = 0; i < 4; i++) {
-            uint32_t value = 0;
-
-            switch (buf[i]) {
-            case 'A' ... 'Z': value =  0 + buf[i] - 'A'; break;
-            case 'a' ... 'z': value = 26 + buf[i] - 'a'; break;
-            case '0' ... '9': value = 52 + buf[i] - '0'; break;
-            case '+':         value = 62;                break;
-            case '/':         value = 63;                break;
-            case '=':
-                {
-                    // '=' is only allowed as the padding in the last two bytes.
-                    if (i == 2) {
-                        if (buf[i + 1] != '=') { return 0; }
-                        word_chars = 1;
-                        i = 3;
-                    } else if (i == 3) {
-                        word_chars = 2;
-                    } else {
-                        return 0;
-                    }
-                }
-                break;
-            default:          return 0;
-            }
-
-            word_value |= (value << (6 * (3 - i)));
-        }
+static int32_t base64_decode_tail(uint32_t value, uint32_t chars, uint8_t *output) {
+    if (chars == 2) {
+        if (value & 0x0f) { return -1; }
+        output[0] = (uint8_t)(value >> 4);
+        return 1;
+    } else if (chars == 3) {
+        if (value & 0x03) { return -1; }
+        output[0] = (uint8_t)(value >> 10);
+        output[1] = (uint8_t)(value >> 2);
+        return 2;
+    } else {
+        return -1;
+    }
+}
 
-        result[resultsize++] = (uint8_t)(word_value >> 16);
-        if (word_chars > 1) {
-            result[resultsize++] = (uint8_t)(word_value >> 8);
-        }
-        if (word_chars > 2) {
-            result[resultsize++] = (uint8_t)(word_value);
+int32_t base64_decode(
+    const uint8_t *input,
+    uint32_t input_size,
+    uint8_t *output,
+    uint32_t output_capacity,
+    enum base64_alphabet alphabet
+) {
+    const uint8_t *table = base64_table(alphabet);
+
+    // strip the padding. it is optional, but if it is there,
+    // it must complete the last quadruplet.
+    uint32_t size = input_size;
+    if (size % 4 == 0 && size > 0 && input[size - 1] == '=') {
+        size -= 1;
+        if (input[size - 1] == '=') { size -= 1; }
+    }
+
+    uint32_t tail_chars = size % 4;
+    if (tail_chars == 1) { return -1; }
+
+    uint32_t quadruplets = size / 4;
+    uint32_t output_size = quadruplets * 3;
+    if (tail_chars) { output_size += tail_chars - 1; }
+    if (output_size > output_capacity) { return -1; }
+
+    // input and output may be the same buffer;
+    // each quadruplet is read before its triplet is written.
+    while (quadruplets--) {
+        uint32_t a = table[input[0]];
+        uint32_t b = table[input[1]];
+        uint32_t c = table[input[2]];
+        uint32_t d = table[input[3]];
+        if ((a | b | c | d) & BASE64_INVALID) { return -1; }
+
+        uint32_t word_value = (a << 18) | (b << 12) | (c << 6) | d;
+        output[0] = (uint8_t)(word_value >> 16);
+        output[1] = (uint8_t)(word_value >> 8);
+        output[2] = (uint8_t)(word_value);
+
+        input += 4;
+        output += 3;
+    }
+
+    if (tail_chars) {
+        uint32_t value = 0;
+        uint32_t invalid = 0;
+        for (uint32_t i = 0; i < tail_chars; i++) {
+            invalid |= table[input[i]];
+            value = (value << 6) | table[input[i]];
         }
-        buf += 4;
+        if (invalid & BASE64_INVALID) { return -1; }
+        if (base64_decode_tail(value, tail_chars, output) < 0) { return -1; }
     }
 
-    return resultsize;
+    return (int32_t)output_size;
+}
+
+void base64_stream_reset(struct base64_stream *stream, enum base64_alphabet alphabet) {
+    stream->table = base64_table(alphabet);
+    stream->word_value = 0;
+    stream->word_chars = 0;
+    stream->padding = 0;
+    stream->done = 0;
+}
+
+int32_t base64_stream_feed(struct base64_stream *stream, uint8_t c, uint8_t result[3]) {
+    // no data is allowed after the padding
+    if (stream->done) { return -1; }
+
+    if (c == '=') {
+        // '=' is only allowed as the padding in the last two bytes.
+        if (stream->padding == 0 && stream->word_chars < 2) { return -1; }
+        if (stream->padding == 1 && stream->word_chars != 2) { return -1; }
+
+        stream->padding += 1;
+        if (stream->word_chars + stream->padding < 4) { return 0; }
+
+        stream->done = 1;
+        return base64_decode_tail(stream->word_value, stream->word_chars, result);
+    }
+
+    uint32_t value = stream->table[c];
+    if (value & BASE64_INVALID) { return -1; }
+    if (stream->padding) { return -1; }
+
+    stream->word_value = (stream->word_value << 6) | value;
+    if (++stream->word_chars < 4) { return 0; }
+
+    uint32_t word_value = stream->word_value;
+    stream->word_value = 0;
+    stream->word_chars = 0;
+
+    result[0] = (uint8_t)(word_value >> 16);
+    result[1] = (uint8_t)(word_value >> 8);
+    result[2] = (uint8_t)(word_value);
+    return 3;
+}
+
+int32_t base64_stream_finish(struct base64_stream *stream, uint8_t result[3]) {
+    if (stream->done) { return 0; }
+    // incomplete padding
+    if (stream->padding) { return -1; }
+    if (stream->word_chars == 0) { return 0; }
+
+    stream->done = 1;
+    return base64_decode_tail(stream->word_value, stream->word_chars, result);
 }
@@ -6,8 +6,61 @@ extern "C" {
 
 #include "stdint.h"
 
-uint32_t base64_decode(uint8_t *buf, const uint32_t bufsize);
+enum base64_alphabet {
+    // A-Z a-z 0-9 + /
+    BASE64_STANDARD,
+    // A-Z a-z 0-9 - _, as used in URLs
+    BASE64_URLSAFE,
+    // accepts the characters of both alphabets
+    BASE64_ANY
+};
+
+/**
+ * Decodes input[:input_size] to output[:output_capacity].
+ * The padding is optional, but if present it must be correct.
+ * input and output may point to the same buffer.
+ * Returns the number of bytes that have been written to output,
+ * or -1 if the input is invalid or doesn't fit into output.
+ */
+int32_t base64_decode(
+    const uint8_t *input,
+    uint32_t input_size,
+    uint8_t *output,
+    uint32_t output_capacity,
+    enum base64_alphabet alphabet
+);
+
+/**
+ * State of an incremental base64 decoder, which is fed one character at a
+ * time. The result is identical to that of base64_decode().
+ */
+struct base64_stream {
+    const uint8_t *table;
+    uint32_t word_value;
+    // number of characters of the current quadruplet, without padding
+    uint8_t word_chars;
+    // number of '=' characters in the current quadruplet
+    uint8_t padding;
+    // whether the padding has completed the input
+    uint8_t done;
+};
+
+void base64_stream_reset(struct base64_stream *stream, enum base64_alphabet alphabet);
+
+/**
+ * Feeds one character to the decoder.
+ * Returns the number of bytes that have been written to result (0 to 3),
+ * or -1 if the input is invalid.
+ */
+int32_t base64_stream_feed(struct base64_stream *stream, uint8_t c, uint8_t result[3]);
+
+/**
+ * Completes the decoding at the end of the input.
+ * Returns the number of bytes that have been written to result (0 to 2),
+ * or -1 if the input is invalid.
+ */
+int32_t base64_stream_finish(struct base64_stream *stream, uint8_t result[3]);
 
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
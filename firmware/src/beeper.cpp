@@ -1,60 +1,120 @@
 #include "beeper.h"
 
-#include "time.h"
+#include "hardware.h"
+#include "interrupts.h"
 
-Beeper::Beeper(
-    OutputPin pin_speaker
-) :
-    pin_speaker{pin_speaker}
-{
-    this->pattern(1000000/200, 1000000/150, 100000, 5);
+static Beeper *beeper_timer_beeper = nullptr;
+
+Beeper::Beeper() {
+    beeper_timer_beeper = this;
+
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    GPIO_InitTypeDef gpio = {0};
+    gpio.Pin = GPIO_PIN_3;
+    gpio.Mode = GPIO_MODE_AF_PP;
+    gpio.Speed = GPIO_SPEED_FREQ_LOW;
+    HAL_GPIO_Init(GPIOA, &gpio);
+
+    // TIM2 counts us. channel 4 is high while the counter is below CCR4.
+    // ARR and CCR4 are preloaded, i.e. each period is set up during the
+    // one before it.
+    __HAL_RCC_TIM2_CLK_ENABLE();
+    TIM2->CR1 = TIM_CR1_ARPE | TIM_CR1_URS;
+    TIM2->PSC = (SystemCoreClock / 1000000) - 1;
+    TIM2->CCMR2 = TIM_CCMR2_OC4M_2 | TIM_CCMR2_OC4M_1 | TIM_CCMR2_OC4PE;
+    TIM2->CCR4 = 0;
+    TIM2->CCER = TIM_CCER_CC4E;
+    TIM2->DIER = TIM_DIER_UIE;
+
+    HAL_NVIC_SetPriority(TIM2_IRQn, 3, 0);
+    HAL_NVIC_EnableIRQ(TIM2_IRQn);
+
+    this->enqueue(tones::startup());
 }
 
+Beeper::~Beeper() {
+    TIM2->CR1 &= ~TIM_CR1_CEN;
+    TIM2->CCR4 = 0;
+    beeper_timer_beeper = nullptr;
+}
 
-void Beeper::beep(uint32_t period_us, uint32_t duration_us)
-{
-    uint32_t num_periods = duration_us / period_us;
-    
-    while (num_periods--) {
-        this->pin_speaker.high();
-        sleep_us(period_us/2);
-        this->pin_speaker.low();
-        sleep_us(period_us/2);
+void Beeper::load_next_period() {
+    uint32_t period_us;
+    uint32_t high_us;
+    if (this->sequencer.next_period(period_us, high_us)) {
+        TIM2->ARR = period_us - 1;
+        TIM2->CCR4 = high_us;
+        return;
     }
+
+    // a silent period, at the end of which the timer is stopped
+    TIM2->CCR4 = 0;
+    this->stopping = true;
 }
 
+void Beeper::enqueue(const TonePattern &pattern) {
+    this->sequencer.enqueue(pattern);
 
-void Beeper::pattern(uint32_t period_a_us, uint32_t period_b_us, uint32_t pause_us, uint32_t beeps)
-{
-    while (beeps--) {
-        this->beep(period_a_us, 10000);
+    CriticalSectionLock lk;
+    if (this->running || !this->sequencer.busy()) { return; }
 
-        uint32_t tmp = period_a_us;
-        period_a_us = period_b_us;
-        period_b_us = tmp;
+    // load the first period, and preload the second one
+    this->running = true;
+    this->stopping = false;
+    TIM2->CNT = 0;
+    this->load_next_period();
+    TIM2->EGR = TIM_EGR_UG;
+    this->load_next_period();
+    TIM2->CR1 |= TIM_CR1_CEN;
+}
 
-        if (beeps) {
-            sleep_us(pause_us);
+void Beeper::timer_update() {
+    // the preloaded period has just started
+    if (this->stopping) {
+        this->stopping = false;
+        // a pattern was enqueued during the last period; it follows
+        // after this silent period.
+        if (this->sequencer.busy()) {
+            this->load_next_period();
+            return;
         }
+        TIM2->CR1 &= ~TIM_CR1_CEN;
+        this->running = false;
+        return;
     }
+    this->load_next_period();
+}
+
+void Beeper::beep(uint32_t period_us, uint32_t duration_us)
+{
+    this->enqueue(tones::beep(period_us, duration_us));
+}
+
+
+void Beeper::pattern(uint32_t period_a_us, uint32_t period_b_us, uint32_t pause_us, uint32_t beeps)
+{
+    this->enqueue(tones::pattern(period_a_us, period_b_us, pause_us, beeps));
 }
 
 
 void Beeper::good(uint32_t length_us)
 {
-    this->beep(1000000/152, length_us);
+    this->enqueue(tones::good(length_us));
 }
 
 
 void Beeper::error(uint32_t code)
 {
-    while (code--) {
-        this->pattern(1000000/152, 1000000/900, 1000, 10);
-        sleep_us(200000);
-    }
+    this->enqueue(tones::error(code));
 }
 
 void Beeper::party(uint32_t duration)
 {
-    this->pattern(1000000/152, 1000000/900, 100000, duration);
+    this->enqueue(tones::party(duration));
+}
+
+void on_beeper_timer() {
+    TIM2->SR = ~TIM_SR_UIF;
+    if (beeper_timer_beeper == nullptr) { return; }
+    beeper_timer_beeper->timer_update();
 }
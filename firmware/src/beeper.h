@@ -1,19 +1,24 @@
 #pragma once
 
-#include <array>
-#include <cmath>
+#include <cstdint>
 
-#include "pin.h"
+#include "tone_sequencer.h"
 
 #ifndef __cplusplus
 #error lolnope
 #endif
 
+/**
+ * Plays beep patterns on the speaker at PA3, by PWM on TIM2 channel 4.
+ * The patterns are queued and played one after the other by the TIM2
+ * interrupt handler, on_beeper_timer(); all methods return immediately.
+ *
+ * Only one Beeper may exist.
+ */
 class Beeper {
 public:
-    Beeper(
-        OutputPin pin_speaker
-    );
+    Beeper();
+    ~Beeper();
 
     void beep(uint32_t period_us, uint32_t duration_us);
     void pattern(uint32_t period_a_us, uint32_t period_b_us, uint32_t pause_us, uint32_t beeps);
@@ -22,6 +27,19 @@ public:
     void error(uint32_t code);
     void party(uint32_t duration);
 
+    /** true while a pattern is queued or playing */
+    inline bool busy() const { return this->sequencer.busy(); }
+
+    /** called by the timer interrupt handler */
+    void timer_update();
+
 private:
-    OutputPin pin_speaker;
+    ToneSequencer sequencer;
+
+    // the timer is running; the last period stops it
+    volatile bool running = false;
+    bool stopping = false;
+
+    void enqueue(const TonePattern &pattern);
+    void load_next_period();
 };
@@ -0,0 +1,41 @@
+#include "binary_frame.h"
+
+using namespace binary_frame;
+
+// the CRC of each nibble, so that a byte takes two steps instead of eight
+static const uint16_t CRC16_NIBBLES[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+};
+
+uint16_t crc16(const uint8_t *data, uint32_t size, uint16_t crc) {
+    while (size--) {
+        uint8_t byte = *data++;
+        crc = static_cast<uint16_t>((crc << 4) ^ CRC16_NIBBLES[(crc >> 12) ^ (byte >> 4)]);
+        crc = static_cast<uint16_t>((crc << 4) ^ CRC16_NIBBLES[(crc >> 12) ^ (byte & 0x0f)]);
+    }
+    return crc;
+}
+
+bool binary_frame_decode(uint8_t *frame, uint32_t size, const uint8_t *&message, uint32_t &message_size) {
+    // COBS: each code byte is followed by code - 1 data bytes and stands
+    // for a 0 after them, except for 0xff and at the end.
+    // the decoded bytes never overtake the encoded ones.
+    uint32_t in = 0;
+    uint32_t out = 0;
+    while (in < size) {
+        uint8_t code = frame[in++];
+        if (code == END || code - 1u > size - in) { return false; }
+        for (uint32_t i = 1; i < code; i++) { frame[out++] = frame[in++]; }
+        if (code != 0xff && in < size) { frame[out++] = 0; }
+    }
+
+    // the length, the message and the CRC
+    if (out < 3 || frame[0] > MAX_MESSAGE_SIZE || frame[0] != out - 3) { return false; }
+    uint16_t crc = static_cast<uint16_t>(frame[out - 2] | (frame[out - 1] << 8));
+    if (crc16(frame, out - 2) != crc) { return false; }
+
+    message = frame + 1;
+    message_size = frame[0];
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * The binary framing on UART, which a client may use instead of
+ * base64 lines.
+ *
+ * A frame starts with START, which no text message starts with, and
+ * ends with END. In between, COBS encodes the following without any
+ * 0 byte:
+ *
+ *    uint8_t   length
+ *    uint8_t   message[length]
+ *    uint16_t  crc             (CRC-16/CCITT-FALSE of length and message)
+ *
+ * The message is the same as a base64-decoded text line. A frame that
+ * was corrupted on the wire is rejected by its CRC, before its HMAC is
+ * calculated.
+ */
+namespace binary_frame {
+
+static constexpr uint8_t START = 0xa5;
+static constexpr uint8_t END = 0x00;
+
+// the same as for a base64 line of 256 characters
+static constexpr uint32_t MAX_MESSAGE_SIZE = 192;
+
+}  // namespace binary_frame
+
+/** CRC-16/CCITT-FALSE; python's binascii.crc_hqx(data, 0xffff) */
+uint16_t crc16(const uint8_t *data, uint32_t size, uint16_t crc = 0xffff);
+
+/**
+ * Decodes a received frame in place; frame points after START, and size
+ * excludes END. False if the frame is malformed, or if its length or its
+ * CRC is wrong. Otherwise, message points into frame.
+ */
+bool binary_frame_decode(uint8_t *frame, uint32_t size, const uint8_t *&message, uint32_t &message_size);
@@ -0,0 +1,42 @@
+#include "calibration.h"
+
+uint32_t crc32(const uint8_t *data, uint32_t size, uint32_t crc) {
+    crc = ~crc;
+    while (size--) {
+        crc ^= *data++;
+        for (uint32_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+uint32_t calibration_crc(const MotorCalibration &calibration) {
+    return crc32(
+        reinterpret_cast<const uint8_t *>(&calibration),
+        sizeof(MotorCalibration) - sizeof(calibration.crc)
+    );
+}
+
+bool calibration_valid(const MotorCalibration &calibration) {
+    if (calibration.magic != MotorCalibration::MAGIC) { return false; }
+    if (calibration.entry_count > MotorCalibration::MAX_ENTRIES) { return false; }
+    return calibration.crc == calibration_crc(calibration);
+}
+
+bool calibration_door_travel(const MotorCalibration &calibration, DoorTravel &travel) {
+    if (!calibration_valid(calibration)) { return false; }
+
+    const MotorCalibration::Entry *best = nullptr;
+    for (uint32_t i = 0; i < calibration.entry_count; i++) {
+        const MotorCalibration::Entry &entry = calibration.entries[i];
+        if (!entry.ok) { continue; }
+        if (best == nullptr || entry.open_time_us < best->open_time_us) { best = &entry; }
+    }
+    if (best == nullptr) { return false; }
+
+    travel.microsteps_per_step = best->microsteps_per_step;
+    travel.open_urevs = best->open_urevs + best->open_urevs / 16;
+    travel.close_urevs = best->close_urevs + best->close_urevs / 16;
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * The result of a motor calibration: the travel between the end switches,
+ * measured in a number of microstep modes.
+ *
+ * The record is stored in its own flash page, next to the secret key,
+ * and is protected by a CRC-32.
+ */
+struct MotorCalibration {
+    static constexpr uint32_t MAGIC = 0x314c4143; // "CAL1"
+    static constexpr uint32_t MAX_ENTRIES = 6;
+
+    struct Entry {
+        uint8_t microsteps_per_step;
+        // both moves ended at the end switch
+        uint8_t ok;
+        uint16_t reserved;
+        // counterclockwise end to clockwise end
+        uint32_t open_urevs;
+        uint32_t open_time_us;
+        // clockwise end to counterclockwise end
+        uint32_t close_urevs;
+        uint32_t close_time_us;
+    };
+
+    uint32_t magic;
+    uint32_t entry_count;
+    Entry entries[MAX_ENTRIES];
+    uint32_t crc;
+};
+
+static_assert(sizeof(MotorCalibration) % 2 == 0, "flash is programmed in half-words");
+
+/** the travel that is used to open and to close the door */
+struct DoorTravel {
+    int8_t microsteps_per_step;
+    uint32_t open_urevs;
+    uint32_t close_urevs;
+};
+
+/** CRC-32 (IEEE 802.3) */
+uint32_t crc32(const uint8_t *data, uint32_t size, uint32_t crc = 0);
+
+/** the CRC of everything in the record but the CRC itself */
+uint32_t calibration_crc(const MotorCalibration &calibration);
+
+/** true if the record has been written completely */
+bool calibration_valid(const MotorCalibration &calibration);
+
+/**
+ * Picks the microstep mode with the fastest successful open from a valid
+ * record. The travels are the measured ones plus a margin of 1/16, so the
+ * end switch still stops the motor. Returns false if no mode worked.
+ */
+bool calibration_door_travel(const MotorCalibration &calibration, DoorTravel &travel);
@@ -0,0 +1,35 @@
+#include "calibration_storage.h"
+
+#include "stm32f1xx_hal.h"
+
+// by default, there is no valid calibration.
+__attribute__((section(".calibration_storage")))
+const MotorCalibration MOTOR_CALIBRATION = {};
+
+bool calibration_write(MotorCalibration &calibration) {
+    calibration.crc = calibration_crc(calibration);
+
+    HAL_FLASH_Unlock();
+
+    FLASH_EraseInitTypeDef erase_init;
+    erase_init.TypeErase = FLASH_TYPEERASE_PAGES;
+    erase_init.Banks = 0; /* only used for mass erase */
+    erase_init.PageAddress = reinterpret_cast<uint32_t>(&MOTOR_CALIBRATION);
+    erase_init.NbPages = 1;
+
+    uint32_t page_error;
+    bool ok = (HAL_FLASHEx_Erase(&erase_init, &page_error) == HAL_OK);
+
+    for (uint32_t i = 0; ok && i < sizeof(MotorCalibration) / 2; i++) {
+        ok = HAL_FLASH_Program(
+            FLASH_TYPEPROGRAM_HALFWORD,
+            reinterpret_cast<uint32_t>(&MOTOR_CALIBRATION) + i * 2,
+            reinterpret_cast<const uint16_t *>(&calibration)[i]
+        ) == HAL_OK;
+    }
+
+    HAL_FLASH_Lock();
+
+    // the CRC also catches a write that was interrupted by a reset
+    return ok && calibration_valid(MOTOR_CALIBRATION);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "calibration.h"
+
+/** the calibration record in flash; it is invalid until the first calibration */
+extern const MotorCalibration MOTOR_CALIBRATION;
+
+/** sets the CRC of the record and writes it to flash */
+bool calibration_write(MotorCalibration &calibration);
@@ -0,0 +1,136 @@
+#include "clock_discipline.h"
+
+#include "units.h"
+
+static constexpr uint64_t PPB = 1000000000;
+
+/** elapsed_us * ppb / 10^9, rounded down, for products below 2^63 */
+static uint64_t scale_ppb(uint64_t elapsed_us, uint64_t ppb) {
+    return units::ConstantDivisor<PPB, 63>::divide(elapsed_us * ppb);
+}
+
+static uint64_t difference(uint64_t a, uint64_t b) {
+    return (a > b) ? a - b : b - a;
+}
+
+void ClockDiscipline::synchronize(uint64_t monotonic_us, uint64_t unix_us, uint32_t uncertainty_us) {
+    Point measured = {monotonic_us, unix_us, uncertainty_us};
+    if (!this->time_set || monotonic_us < this->reference.monotonic_us) {
+        this->restart(measured);
+        return;
+    }
+
+    // a synchronization that contradicts the estimate
+    if (!this->agrees(measured)) {
+        this->restart(measured);
+        return;
+    }
+    uint64_t predicted_us = this->unix_us(monotonic_us);
+    uint64_t predicted_uncertainty_us = this->uncertainty_us(monotonic_us);
+
+    // until the rate is known, the prediction is worse than the mark
+    Point phase = measured;
+    if (this->rate_measured) {
+        // the truncation adds up to 1 us to the weighted uncertainty
+        if (unix_us > predicted_us) {
+            phase.unix_us = predicted_us + (unix_us - predicted_us) / PHASE_GAIN;
+        } else {
+            phase.unix_us = predicted_us - (predicted_us - unix_us) / PHASE_GAIN;
+        }
+        uint64_t weighted_us = ((PHASE_GAIN - 1) * predicted_uncertainty_us + uncertainty_us) / PHASE_GAIN + 2;
+        uint64_t from_mark_us = difference(unix_us, phase.unix_us) + uncertainty_us;
+        phase.uncertainty_us = (weighted_us < from_mark_us) ? weighted_us : from_mark_us;
+    }
+    this->reference = phase;
+
+    // the newest anchor becomes the oldest once it is far enough back
+    if (this->anchor_count == 0) {
+        this->anchors[this->anchor_count++] = phase;
+        return;
+    }
+    if (phase.unix_us - this->anchors[this->anchor_count - 1].unix_us >= ANCHOR_INTERVAL_US) {
+        if (this->anchor_count == 2) { this->anchors[0] = this->anchors[1]; }
+        this->anchors[1] = phase;
+        this->anchor_count = 2;
+    }
+    this->fit(phase);
+}
+
+void ClockDiscipline::set(uint64_t monotonic_us, uint64_t unix_us, uint64_t uncertainty_us) {
+    Point point = {monotonic_us, unix_us, uncertainty_us};
+    if (this->time_set && monotonic_us >= this->reference.monotonic_us && this->agrees(point)) {
+        // the anchors stay, they are better than the point
+        this->reference = point;
+        return;
+    }
+    this->restart(point);
+    this->anchor_count = 0;
+}
+
+bool ClockDiscipline::agrees(const Point &point) const {
+    uint64_t predicted_uncertainty_us = this->uncertainty_us(point.monotonic_us);
+    // an uncertainty this large agrees with anything
+    if (predicted_uncertainty_us >= UINT64_MAX - point.uncertainty_us) { return true; }
+    uint64_t difference_us = difference(point.unix_us, this->unix_us(point.monotonic_us));
+    return difference_us <= predicted_uncertainty_us + point.uncertainty_us;
+}
+
+void ClockDiscipline::restart(const Point &point) {
+    this->time_set = true;
+    this->reference = point;
+    this->rate_measured = false;
+    this->rate = 0;
+    this->fit_uncertainty_ppb = 0;
+    this->anchors[0] = point;
+    this->anchor_count = 1;
+}
+
+void ClockDiscipline::fit(const Point &point) {
+    const Point &anchor = this->anchors[0];
+    uint64_t monotonic_elapsed_us = point.monotonic_us - anchor.monotonic_us;
+    if (point.unix_us <= anchor.unix_us || monotonic_elapsed_us < MIN_FIT_US) { return; }
+    uint64_t real_elapsed_us = point.unix_us - anchor.unix_us;
+
+    // this happens once per synchronization, so the 64-bit divisions don't matter
+    uint64_t uncertainty_ppb = (anchor.uncertainty_us + point.uncertainty_us) * PPB / monotonic_elapsed_us + 1;
+    int64_t rate = (
+        (static_cast<int64_t>(monotonic_elapsed_us) - static_cast<int64_t>(real_elapsed_us)) *
+        static_cast<int64_t>(PPB) / static_cast<int64_t>(monotonic_elapsed_us)
+    );
+    // a crystal that far off is broken, or the anchor is wrong
+    if (rate > 2 * UNKNOWN_RATE_PPB || rate < -2 * static_cast<int64_t>(UNKNOWN_RATE_PPB)) { return; }
+
+    // a fit from an anchor that has just moved on is worse, but newer
+    bool better = this->rate_measured
+        ? uncertainty_ppb <= this->fit_uncertainty_ppb
+        : uncertainty_ppb + TEMPERATURE_DRIFT_PPB < UNKNOWN_RATE_PPB;
+    if (!better && monotonic_elapsed_us < ANCHOR_INTERVAL_US) { return; }
+
+    this->rate = static_cast<int32_t>(rate);
+    this->fit_uncertainty_ppb = static_cast<uint32_t>(uncertainty_ppb);
+    this->rate_measured = true;
+}
+
+uint64_t ClockDiscipline::real_us(uint64_t elapsed_us) const {
+    uint64_t correction_us = scale_ppb(elapsed_us, static_cast<uint64_t>(this->rate < 0 ? -this->rate : this->rate));
+    return (this->rate < 0) ? elapsed_us + correction_us : elapsed_us - correction_us;
+}
+
+uint64_t ClockDiscipline::unix_us(uint64_t monotonic_us) const {
+    const Point &reference = this->reference;
+    if (monotonic_us >= reference.monotonic_us) {
+        return reference.unix_us + this->real_us(monotonic_us - reference.monotonic_us);
+    }
+    return reference.unix_us - this->real_us(reference.monotonic_us - monotonic_us);
+}
+
+uint32_t ClockDiscipline::rate_uncertainty_ppb() const {
+    return this->rate_measured ? this->fit_uncertainty_ppb + TEMPERATURE_DRIFT_PPB : UNKNOWN_RATE_PPB;
+}
+
+uint64_t ClockDiscipline::uncertainty_us(uint64_t monotonic_us) const {
+    if (!this->time_set) { return UINT64_MAX; }
+    uint64_t elapsed_us = difference(monotonic_us, this->reference.monotonic_us);
+    // the conversions round down by up to 1 us each
+    return this->reference.uncertainty_us + scale_ppb(elapsed_us, this->rate_uncertainty_ppb()) + 2;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Disciplines the monotonic time, which is counted from the HSE crystal,
+ * to the minute marks of an external time source, and says how far the
+ * UNIX time that it gives may be off.
+ *
+ * The rate of the crystal is measured by a frequency-locked loop: every
+ * synchronization fits it to an anchor that is 12 to 24 hours back, so
+ * that the jitter of the minute marks adds about 1 ppm; until then,
+ * to the first synchronization, as long as that is better than the
+ * tolerance of the crystal. From there on, the rate may be off by the
+ * fit and by the temperature drift of the crystal.
+ *
+ * The phase is pulled towards each minute mark by a quarter of the
+ * difference, which smoothes the jitter of the marks. A synchronization
+ * that contradicts the estimate starts over with an unknown rate.
+ */
+class ClockDiscipline {
+public:
+    // the tolerance of the HSE crystal, before its rate has been measured
+    static constexpr uint32_t UNKNOWN_RATE_PPB = 50000;
+    // how far the rate may drift from its mean over the fit with the
+    // temperature
+    static constexpr uint32_t TEMPERATURE_DRIFT_PPB = 2000;
+    // the anchor moves on after this long
+    static constexpr uint64_t ANCHOR_INTERVAL_US = 12 * 3600ULL * 1000000;
+
+    /**
+     * Adds a synchronization: unix_us was the UNIX time at monotonic_us,
+     * off by up to uncertainty_us.
+     */
+    void synchronize(uint64_t monotonic_us, uint64_t unix_us, uint32_t uncertainty_us);
+
+    /**
+     * sets the time without measuring the rate, e.g. from the RTC; a rate
+     * that has been measured is kept, unless the time contradicts it.
+     */
+    void set(uint64_t monotonic_us, uint64_t unix_us, uint64_t uncertainty_us);
+
+    /**
+     * The UNIX time at monotonic_us, for up to two years from the last
+     * synchronization; the monotonic time itself before the first one.
+     */
+    uint64_t unix_us(uint64_t monotonic_us) const;
+
+    /** how far unix_us() may be off; UINT64_MAX before the first synchronization */
+    uint64_t uncertainty_us(uint64_t monotonic_us) const;
+
+    /** false until the rate of the crystal has been measured */
+    bool rate_known() const { return this->rate_measured; }
+
+    /** how much faster than real time the crystal runs, in ppb */
+    int32_t rate_ppb() const { return this->rate; }
+
+    /** how far rate_ppb() may be off from the current rate */
+    uint32_t rate_uncertainty_ppb() const;
+
+private:
+    /** a UNIX time at a monotonic time, and how far it may be off */
+    struct Point {
+        uint64_t monotonic_us;
+        uint64_t unix_us;
+        uint64_t uncertainty_us;
+    };
+
+    /** forgets the rate and the anchors, and takes over the point */
+    void restart(const Point &point);
+
+    /** true if the point may be right, as far as the estimate knows */
+    bool agrees(const Point &point) const;
+
+    /** fits the rate from the oldest anchor to the point, if that is better */
+    void fit(const Point &point);
+
+    /** the real time that passes while the crystal counts elapsed_us */
+    uint64_t real_us(uint64_t elapsed_us) const;
+
+    // the phase of the last minute mark is pulled towards it by 1 / PHASE_GAIN
+    static constexpr uint64_t PHASE_GAIN = 4;
+    // shorter fits aren't better than the tolerance anyway
+    static constexpr uint64_t MIN_FIT_US = 600ULL * 1000000;
+
+    bool time_set = false;
+    // the estimate at the last synchronization
+    Point reference = {0, 0, UINT64_MAX};
+
+    // the part of the monotonic time that the crystal counts too much,
+    // in ppb, as measured from anchors[0]
+    bool rate_measured = false;
+    int32_t rate = 0;
+    uint32_t fit_uncertainty_ppb = 0;
+
+    // the estimates that the rate is fitted from, the oldest first
+    Point anchors[2];
+    uint32_t anchor_count = 0;
+};
@@ -1,28 +1,53 @@
 #include "stm32f1xx_hal.h"
 
-#include "base64.h"
 #include "dcf77.h"
 #include "deserialize.h"
 #include "hardware.h"
+#include "binary_frame.h"
 #include "hmac.h"
+#include "message_format.h"
+#include "message_stream.h"
 #include "motor.h"
 #include "beeper.h"
+#include "calibration_storage.h"
+#include "scheduler.h"
 #include "secret_key.h"
 #include "sha256.h"
 #include "time.h"
+#include "time_set_storage.h"
+#include "units.h"
+
+#if UNITS_BENCHMARK
+#include "units_benchmark.h"
+#endif
 
 static void cpp_main_in_cpp();
-static void open_door(StepperMotor &motor);
 
-static void open_door(StepperMotor &motor) {
-    motor.set_mode(1);
-    // TODO: find the correct number which does a full rotation
-    motor.rotate(3000000, 1000000 * 4);
-    sleep_us(3000000);
-    motor.set_mode(-1);
-    // TODO: find the correct number which does a quarter or so backrotation
-    motor.rotate(2000000, 1000000 * 4);
-    motor.set_mode(0);
+/** which bytes of which UARTRxBuffer have been fed to the MessageStream */
+struct StreamPosition {
+    const UARTRxBuffer *buf;
+    uint32_t generation;
+    uint32_t consumed;
+};
+
+static void stream_feed(
+    MessageStream &stream,
+    StreamPosition &position,
+    const UARTRxBuffer *buf,
+    uint32_t generation,
+    uint32_t length
+) {
+    if (position.buf != buf || position.generation != generation) {
+        // this is a different message
+        stream.reset();
+        position.buf = buf;
+        position.generation = generation;
+        position.consumed = 0;
+    }
+
+    while (position.consumed < length) {
+        stream.feed(buf->buf[position.consumed++]);
+    }
 }
 
 static bool check_info(const uint8_t *info, uint32_t info_size) {
@@ -42,190 +67,726 @@ static bool check_info(const uint8_t *info, uint32_t info_size) {
     return true;
 }
 
-static void cpp_main_in_cpp() {
-    StepperMotor motor(
-        OutputPin(GPIOA, GPIO_PIN_5),          // step
-        OutputPin(GPIOA, GPIO_PIN_6),          // sleep
-        OutputPin(GPIOA, GPIO_PIN_4),          // direction
-        {
-            OutputPin(GPIOB, GPIO_PIN_10),     // microstep modesel 0
-            OutputPin(GPIOB, GPIO_PIN_1),      // microstep modesel 1
-            OutputPin(GPIOB, GPIO_PIN_0)       // microstep modesel 2
-        },
-        InputPin(GPIOB, GPIO_PIN_5),           // clockwise end switch
-        InputPin(GPIOB, GPIO_PIN_6)            // counterclockwise end switch
-    );
+/** appends the decimal representation of value to text */
+static char *append_u32(char *text, uint32_t value) {
+    char digits[10];
+    uint32_t count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (count) { *text++ = digits[--count]; }
+    *text = '\0';
+    return text;
+}
 
-    Beeper beeper(OutputPin(GPIOA, GPIO_PIN_3));
+static char *append_str(char *text, const char *str) {
+    while (*str) { *text++ = *str++; }
+    *text = '\0';
+    return text;
+}
 
-    OutputPin led0_b(GPIOA, GPIO_PIN_0);
-    OutputPin led0_g(GPIOA, GPIO_PIN_1);
-    OutputPin led0_r(GPIOA, GPIO_PIN_2);
+/** appends the last count decimal digits of value, with leading zeros */
+static char *append_digits(char *text, uint32_t value, uint32_t count) {
+    for (uint32_t i = count; i > 0; i--) {
+        text[i - 1] = '0' + value % 10;
+        value /= 10;
+    }
+    text += count;
+    *text = '\0';
+    return text;
+}
 
-    // led1.green is the power indicator, it is always on.
-    OutputPin led1_b(GPIOC, GPIO_PIN_15);
-    led1_b.set();
-    // led1.green is connected directly to the DCF77 signal,
-    // it doesn't exist here
-    // led1.red is the DCF77 error indicator.
-    // it is on if no good signal was received in the last hour
-    OutputPin led1_r(GPIOC, GPIO_PIN_14);
+/** appends a value in thousandths, e.g. 12.345 */
+static char *append_milli(char *text, uint32_t value) {
+    text = append_u32(text, value / 1000);
+    *text++ = '.';
+    return append_digits(text, value % 1000, 3);
+}
 
-    InputPin dcf77_pin(GPIOA, GPIO_PIN_8);
-    dcf77_init(&dcf77_pin, &led1_r);
+/** appends a time in us as seconds, e.g. 1558000000.123456 */
+static char *append_us(char *text, uint64_t us) {
+    uint64_t s = units::us_to_s(us);
+    text = append_u32(text, static_cast<uint32_t>(s));
+    *text++ = '.';
+    return append_digits(text, static_cast<uint32_t>(us - units::s_to_us(s)), 6);
+}
 
-    while (1)
+/**
+ * Opens the door: rotates the motor forward, keeps the door open for
+ * a while, then rotates the motor backward.
+ *
+ * The travel comes from the motor calibration in flash, if there is one.
+ */
+class Door : public Task {
+public:
+    Door(StepperMotor &motor);
+
+    /** starts opening the door; if it is open already, it stays open longer */
+    void open();
+
+    /**
+     * Measures the travel between the end switches in the given microstep
+     * modes, and stores the result in flash. Returns false if the door is
+     * not closed.
+     */
+    bool calibrate(const uint8_t *modes, uint32_t mode_count);
+
+    /**
+     * true while the motor is still, so that flash may be written: an
+     * erase stalls the CPU for about 20 ms, and the steps with it
+     */
+    inline bool closed() const { return this->state == State::CLOSED; }
+
+    void run(uint64_t now) override;
+
+private:
+    static constexpr uint32_t hold_time_us = 3000000;
+    // how often the motor is checked while it rotates
+    static constexpr uint32_t poll_interval_us = 1000;
+    static constexpr uint32_t speed_urev_per_second = 1000000 * 4;
+    // the calibration moves are stopped by the end switches
+    static constexpr uint32_t calibration_max_urevs = 5000000;
+
+    StepperMotor &motor;
+    DoorTravel travel;
+
+    enum class State { CLOSED, OPENING, OPEN, CLOSING, CALIBRATING };
+    State state = State::CLOSED;
+    // open() was called while closing
+    bool reopen = false;
+
+    // the calibration moves of each mode
+    enum class CalibrationPhase { HOMING, OPENING, CLOSING };
+    CalibrationPhase calibration_phase;
+    uint32_t calibration_index;
+    uint64_t calibration_move_start;
+    MotorCalibration calibration;
+
+    void start_opening();
+    void start_calibration_move(CalibrationPhase phase, uint64_t now);
+    void calibration_step(uint64_t now);
+    void finish_calibration();
+};
+
+Door::Door(StepperMotor &motor) : motor{motor} {
+    if (!calibration_door_travel(MOTOR_CALIBRATION, this->travel)) {
+        // the door has not been calibrated yet
+        this->travel.microsteps_per_step = 1;
+        this->travel.open_urevs = 3000000;
+        this->travel.close_urevs = 2000000;
+    }
+}
+
+void Door::start_opening() {
+    this->motor.set_mode(this->travel.microsteps_per_step);
+    this->motor.rotate(this->travel.open_urevs, speed_urev_per_second);
+    this->state = State::OPENING;
+    this->deadline = 0;
+}
+
+void Door::open() {
+    switch (this->state) {
+    case State::CLOSED:
+        this->start_opening();
+        break;
+    case State::OPENING:
+        break;
+    case State::OPEN:
+        this->deadline = time_get_64() + hold_time_us;
+        break;
+    case State::CLOSING:
+        this->reopen = true;
+        break;
+    case State::CALIBRATING:
+        break;
+    }
+}
+
+bool Door::calibrate(const uint8_t *modes, uint32_t mode_count) {
+    if (this->state != State::CLOSED) { return false; }
+    // there is nothing to calibrate, and mode 0 would be sleep mode
+    if (mode_count == 0) { return false; }
+    if (mode_count > MotorCalibration::MAX_ENTRIES) { mode_count = MotorCalibration::MAX_ENTRIES; }
+
+    this->calibration = {};
+    this->calibration.magic = MotorCalibration::MAGIC;
+    this->calibration.entry_count = mode_count;
+    for (uint32_t i = 0; i < mode_count; i++) {
+        this->calibration.entries[i].microsteps_per_step = modes[i];
+    }
+
+    this->state = State::CALIBRATING;
+    this->calibration_index = 0;
+    this->start_calibration_move(CalibrationPhase::HOMING, time_get_64());
+    this->deadline = 0;
+    return true;
+}
+
+void Door::start_calibration_move(CalibrationPhase phase, uint64_t now) {
+    int8_t mode = this->calibration.entries[this->calibration_index].microsteps_per_step;
+    // homing and closing go to the counterclockwise end
+    this->motor.set_mode((phase == CalibrationPhase::OPENING) ? mode : -mode);
+    this->motor.rotate(calibration_max_urevs, speed_urev_per_second);
+    this->calibration_phase = phase;
+    this->calibration_move_start = now;
+}
+
+void Door::calibration_step(uint64_t now) {
+    MotorCalibration::Entry &entry = this->calibration.entries[this->calibration_index];
+    uint32_t urevs = this->motor.steps_to_urevs(this->motor.steps_done());
+    uint32_t time_us = static_cast<uint32_t>(now - this->calibration_move_start);
+
+    // every move must end at the end switch
+    bool ok = this->motor.at_end();
+    if (ok) {
+        switch (this->calibration_phase) {
+        case CalibrationPhase::HOMING:
+            this->start_calibration_move(CalibrationPhase::OPENING, now);
+            return;
+        case CalibrationPhase::OPENING:
+            entry.open_urevs = urevs;
+            entry.open_time_us = time_us;
+            this->start_calibration_move(CalibrationPhase::CLOSING, now);
+            return;
+        case CalibrationPhase::CLOSING:
+            entry.close_urevs = urevs;
+            entry.close_time_us = time_us;
+            entry.ok = 1;
+            break;
+        }
+    }
+
+    char line[128];
+    char *text = append_str(line, "calibration mode ");
+    text = append_u32(text, entry.microsteps_per_step);
+    if (entry.ok) {
+        text = append_str(text, ": open ");
+        text = append_u32(text, entry.open_urevs);
+        text = append_str(text, " urev ");
+        text = append_u32(text, entry.open_time_us);
+        text = append_str(text, " us, close ");
+        text = append_u32(text, entry.close_urevs);
+        text = append_str(text, " urev ");
+        text = append_u32(text, entry.close_time_us);
+        text = append_str(text, " us");
+    } else {
+        text = append_str(text, ": end switch not reached");
+    }
+    uart_writeline(line);
+
+    this->calibration_index += 1;
+    if (this->calibration_index < this->calibration.entry_count) {
+        this->start_calibration_move(CalibrationPhase::HOMING, now);
+        return;
+    }
+    this->finish_calibration();
+}
+
+void Door::finish_calibration() {
+    this->motor.set_mode(0);
+    this->state = State::CLOSED;
+    this->deadline = NEVER;
+
+    // if no mode worked, the old travel and the old record are kept
+    this->calibration.crc = calibration_crc(this->calibration);
+    if (!calibration_door_travel(this->calibration, this->travel)) {
+        uart_writeline("calibration failed");
+        return;
+    }
+    if (!calibration_write(this->calibration)) {
+        uart_writeline("calibration could not be written");
+        return;
+    }
+    uart_writeline("calibration written");
+}
+
+void Door::run(uint64_t now) {
+    if (this->motor.busy()) {
+        this->deadline = now + poll_interval_us;
+        return;
+    }
+
+    switch (this->state) {
+    case State::CLOSED:
+        this->deadline = NEVER;
+        break;
+    case State::CALIBRATING:
+        this->calibration_step(now);
+        break;
+    case State::OPENING:
+        this->state = State::OPEN;
+        this->deadline = now + hold_time_us;
+        break;
+    case State::OPEN:
+        this->motor.set_mode(-this->travel.microsteps_per_step);
+        this->motor.rotate(this->travel.close_urevs, speed_urev_per_second);
+        this->state = State::CLOSING;
+        this->deadline = now + poll_interval_us;
+        break;
+    case State::CLOSING:
+        this->motor.set_mode(0);
+        this->state = State::CLOSED;
+        this->deadline = NEVER;
+        if (this->reopen) {
+            this->reopen = false;
+            this->start_opening();
+        }
+        break;
+    }
+}
+
+/**
+ * Receives, authenticates and executes the messages from UART.
+ */
+class MessageHandler : public Task {
+public:
+    inline MessageHandler(Door &door, Beeper &beeper, HMACContext &hmac_context)
+        :
+        door{door},
+        beeper{beeper},
+        hmac_context{hmac_context},
+        // messages are decoded and authenticated while they are being received.
+        stream{hmac_context},
+        stream_position{nullptr, 0, 0}
     {
-        UARTRxBuffer *message = uart_poll_message();
-        if (message == nullptr) {
-            // no new message is ready
-            continue;
-        }
-        if (message->buf_pos == 0) {
-            // the received message is empty
-            beeper.error(1);
-            continue;
-        }
-
-        // super-secret backdoor. don't tell anybody.
-        if (
-            (message->buf[0] == 'b') &&
-            (message->buf[1] == 'a') &&
-            (message->buf[2] == 'c') &&
-            (message->buf[3] == 'k') &&
-            (message->buf[4] == 'd') &&
-            (message->buf[5] == 'o') &&
-            (message->buf[6] == 'o') &&
-            (message->buf[7] == 'r')
-        ) {
-            // nothing to see here
+        this->deadline = 0;
+    }
+
+    void run(uint64_t now) override;
+
+private:
+    // at 9600 baud, this is about 5 characters
+    static constexpr uint32_t poll_interval_us = 5000;
+    // messages are only checked against a time that is at most this far off;
+    // the RTC keeps the time within that for a month without DCF77, even
+    // before it has measured its rate
+    static constexpr uint64_t max_time_uncertainty_us = 300000000;
+
+    Door &door;
+    Beeper &beeper;
+    HMACContext &hmac_context;
+
+    MessageStream stream;
+    StreamPosition stream_position;
+
+    void handle(UARTRxBuffer *message);
+
+    /** writes the time, the rate of the crystal and how far they may be off */
+    void report_status();
+};
+
+void MessageHandler::run(uint64_t now) {
+    this->deadline = now + poll_interval_us;
+
+    {
+        uint32_t generation;
+        uint32_t length;
+        const UARTRxBuffer *receiving = uart_peek_receiving(generation, length);
+        // binary frames are checked and authenticated once they are complete
+        if (length == 0 || receiving->buf[0] != binary_frame::START) {
+            stream_feed(this->stream, this->stream_position, receiving, generation, length);
+        }
+        if (receiving->generation != generation) {
+            // the buffer was reset while we were reading it.
+            this->stream_position.buf = nullptr;
+        }
+    }
+
+    while (UARTRxBuffer *message = uart_poll_message()) {
+        this->handle(message);
+    }
+}
+
+void MessageHandler::report_status() {
+    char line[64];
+    char *text = append_str(line, "time ");
+    uint64_t time_us = get_time_us();
+    uint64_t uncertainty_us = get_timestamp_uncertainty_us();
+    if (uncertainty_us == UINT64_MAX) {
+        text = append_str(text, "not set");
+    } else {
+        text = append_us(text, time_us);
+        text = append_str(text, " s, off by up to ");
+        text = append_us(text, uncertainty_us);
+        text = append_str(text, " s");
+    }
+    uart_writeline(line);
+
+    int32_t rate_ppb;
+    uint32_t rate_uncertainty_ppb;
+    bool rate_known = get_clock_rate(rate_ppb, rate_uncertainty_ppb);
+    text = append_str(line, "clock ");
+    if (rate_known) {
+        text = append_str(text, rate_ppb < 0 ? "-" : "+");
+        text = append_milli(text, static_cast<uint32_t>(rate_ppb < 0 ? -rate_ppb : rate_ppb));
+        text = append_str(text, " ppm");
+    } else {
+        text = append_str(text, "rate not measured");
+    }
+    text = append_str(text, ", off by up to ");
+    text = append_milli(text, rate_uncertainty_ppb);
+    text = append_str(text, " ppm");
+    uart_writeline(line);
+
+    // the next time-set message must have the sequence number after this
+    text = append_str(line, "time set sequence ");
+    text = append_u32(text, time_set_last_sequence(TIME_SET_SEQUENCES));
+    uart_writeline(line);
+}
+
+void MessageHandler::handle(UARTRxBuffer *message) {
+    if (message->buf_pos == 0) {
+        // the received message is empty
+        this->beeper.error(1);
+        return;
+    }
+
+    // super-secret backdoor. don't tell anybody.
+    if (
+        (message->buf[0] == 'b') &&
+        (message->buf[1] == 'a') &&
+        (message->buf[2] == 'c') &&
+        (message->buf[3] == 'k') &&
+        (message->buf[4] == 'd') &&
+        (message->buf[5] == 'o') &&
+        (message->buf[6] == 'o') &&
+        (message->buf[7] == 'r')
+    ) {
+        // nothing to see here
 #if WITH_BACKDOOR
-            uart_writeline("you used the \x1b[32;1;5msuper-secret\x1b[m backdoor!");
+        uart_writeline("you used the \x1b[32;1;5msuper-secret\x1b[m backdoor!");
 #else
-            uart_writeline("lol noob");
+        uart_writeline("lol noob");
 #endif
-            beeper.party(10);
+        this->beeper.party(10);
 #if WITH_BACKDOOR
-            open_door(motor);
+        this->door.open();
 #endif
-            continue;
-        }
+        return;
+    }
+
+    // the state of the clock; it's no secret
+    if (
+        (message->buf_pos == 6) &&
+        (message->buf[0] == 's') &&
+        (message->buf[1] == 't') &&
+        (message->buf[2] == 'a') &&
+        (message->buf[3] == 't') &&
+        (message->buf[4] == 'u') &&
+        (message->buf[5] == 's')
+    ) {
+        this->report_status();
+        return;
+    }
 
-        // base64-decode the message.
-        uint32_t size = base64_decode(message->buf.data(), message->buf_pos);
+    uint8_t digest[32];
+    uint32_t size;
+    const uint8_t *data;
+    if (message->buf[0] == binary_frame::START) {
+        // a binary frame carries the message as it is. a corrupted frame
+        // is rejected by its CRC, before the HMAC is calculated.
+        if (!binary_frame_decode(&message->buf[1], message->buf_pos - 1, data, size)) {
+            uart_writeline("binary frame is corrupted");
+            this->beeper.error(13);
+            return;
+        }
+        if (size > HMAC_SIZE) {
+            this->hmac_context.calculate(data + HMAC_SIZE, size - HMAC_SIZE, digest);
+        }
+    } else {
+        // base64-decode the rest of the message, and calculate its HMAC.
+        // if the stream has lost track of the message, this starts over.
+        stream_feed(this->stream, this->stream_position, message, message->generation, message->buf_pos);
+        this->stream_position.buf = nullptr;
+        size = this->stream.finish(digest);
+        data = this->stream.data();
         if (size == 0) {
             // the base64-decoded message is empty
             uart_writeline("base64-decoded message is empty");
-            beeper.error(2);
-            continue;
+            this->beeper.error(2);
+            return;
         }
+    }
 
-        // all messages have the following format:
-        //    uint8_t   hmac_signature[HMAC_SIZE]
-        //    uint64_t  valid_from
-        //    uint64_t  valid_until
-        //    uint8_t   type
-        //    uint8_t   payload[]       (variable length)
-
-        if (size <= HMAC_SIZE + 17) {
-            // the message is too small
-            uart_writeline("message is too small");
-            beeper.error(3);
-            continue;
-        }
+    // all messages start with the HMAC signature, followed by a header
+    // with the validity window and the message type in one of two
+    // formats, and the payload; see message_format.h.
+    MessageHeader header;
+    if (!message_parse(data, size, header)) {
+        // the message is too small
+        uart_writeline("message is too small");
+        this->beeper.error(3);
+        return;
+    }
 
-        // calculate the message HMAC
-        uint8_t digest[32];
-        hmac(message->buf.data() + HMAC_SIZE, size - HMAC_SIZE, digest);
-    
-        // prevent timing side-channel attacks through the use of 'volatile'
-        volatile bool signature_ok = true;
-        for (uint32_t i = 0; i < HMAC_SIZE; i++) {
-            signature_ok &= (digest[i] == message->buf[i]);
-        }
-        if (!signature_ok) {
-            uart_writeline("HMAC fail");
-            beeper.error(4);
-            continue;
-        }
+    // prevent timing side-channel attacks through the use of 'volatile'
+    volatile bool signature_ok = true;
+    for (uint32_t i = 0; i < HMAC_SIZE; i++) {
+        signature_ok &= (digest[i] == data[i]);
+    }
+    if (!signature_ok) {
+        uart_writeline("HMAC fail");
+        this->beeper.error(4);
+        return;
+    }
 
-        // see if the timestamp is valid.
-        uint64_t valid_from = deserialize_u64(&message->buf[HMAC_SIZE]);
-        uint64_t valid_until = deserialize_u64(&message->buf[HMAC_SIZE + 8]);
+    if (header.version == message_format::VERSION_UNKNOWN || header.version > 2) {
+        uart_writeline("unknown message version");
+        this->beeper.error(8);
+        return;
+    }
 
-        uint64_t current_timestamp = get_timestamp();
+    // see if the timestamp is valid.
+    uint64_t valid_from = header.valid_from;
+    uint64_t valid_until = header.valid_until;
+
+    const uint8_t message_type = header.type;
+    const uint8_t *payload = header.payload;
+    uint8_t payload_size = header.payload_size;
+
+    // the message counts as valid if it may be valid at the true time,
+    // as long as the time is known well enough. it is valid from the
+    // start of second valid_from to the end of second valid_until.
+    // a time-set message is checked against its sequence number instead,
+    // since it is meant for when the time isn't known.
+    uint64_t current_us = get_time_us();
+    uint64_t uncertainty_us = get_timestamp_uncertainty_us();
+    if (message_type != time_set::MESSAGE_TYPE) {
+        if (uncertainty_us > max_time_uncertainty_us) {
+            uart_writeline("the time is not known");
+            this->beeper.error(5);
+            return;
+        }
+        uint64_t latest = units::us_to_s(current_us + uncertainty_us);
+        uint64_t earliest = (current_us > uncertainty_us) ? units::us_to_s(current_us - uncertainty_us) : 0;
 
-        if (valid_from > current_timestamp) {
+        if (valid_from > latest) {
             // message is not yet valid
             uart_writeline("message is not yet valid");
-            beeper.error(5);
-            continue;
+            this->beeper.error(5);
+            return;
         }
-        if (valid_until < current_timestamp) {
+        if (valid_until < earliest) {
             // mesage is no longer valid
             uart_writeline("message is no longer valid");
-            beeper.error(6);
-            continue;
-        }
-
-        const uint8_t message_type = message->buf[HMAC_SIZE + 16];
-        const uint8_t *payload = &(message->buf[HMAC_SIZE + 17]);
-        uint8_t payload_size = size - HMAC_SIZE - 17;
-
-        // the message is valid, do its bidding.
-        switch (message_type) {
-        case 0x01: {
-            // an 'open the door' message.
-            // payload:
-            //    char *    uid             (variable length)
-
-            if (!check_info(payload, payload_size)) {
-                // info is not valid
-                uart_writeline("message info is not valid");
-                beeper.error(7);
-                continue;
-            }
-
-            // it seems like you're in luck.
-            uart_writeline("opening door");
-            beeper.good(10000);
-            open_door(motor);
-            break;
+            this->beeper.error(6);
+            return;
         }
-        case 0x02: {
-            // an 'new SECRET_KEY' message.
-            // payload:
-            //    uint8_t *    new_key_seed            (variable length)
+    }
 
-            if (payload_size < 1) {
-                beeper.error(7);
-                uart_writeline("payload is not valid");
-                continue;
-            }
+    // the message is valid, do its bidding.
+    switch (message_type) {
+    case 0x01: {
+        // an 'open the door' message.
+        // payload:
+        //    char *    uid             (variable length)
+        // or, in the compact format:
+        //    uint32_t  user_id
+
+        bool info_ok = (header.version == 1)
+            ? check_info(payload, payload_size)
+            : (payload_size == 4);
+        if (!info_ok) {
+            // info is not valid
+            uart_writeline("message info is not valid");
+            this->beeper.error(7);
+            return;
+        }
 
-            // calculate the new secret key
-            SHA256 hash;
-            hash.update(SECRET_KEY, sizeof(SECRET_KEY));
-            hash.update(payload, payload_size);
-            uint8_t digest[32];
-            hash.calculate_digest(digest);
+        // it seems like you're in luck.
+        uart_writeline("opening door");
+        this->beeper.good(10000);
+        this->door.open();
+        break;
+    }
+    case 0x02: {
+        // an 'new SECRET_KEY' message.
+        // payload:
+        //    uint8_t *    new_key_seed            (variable length)
+
+        if (payload_size < 1) {
+            this->beeper.error(7);
+            uart_writeline("payload is not valid");
+            return;
+        }
 
-            uart_writeline("writing new secret key");
+        // calculate the new secret key
+        SHA256 hash;
+        hash.update(SECRET_KEY, sizeof(SECRET_KEY));
+        hash.update(payload, payload_size);
+        uint8_t digest[32];
+        hash.calculate_digest(digest);
 
-            // write the new secret key
-            secret_key_write(digest);
-            beeper.good(1000000);
+        uart_writeline("writing new secret key");
 
-            break;
+        // write the new secret key
+        secret_key_write(digest);
+        this->hmac_context.set_key(SECRET_KEY);
+        // a message that is already being received needs to start over
+        this->stream_position.buf = nullptr;
+        this->beeper.good(1000000);
+
+        break;
+    }
+    case 0x03: {
+        // a 'calibrate the motor' message.
+        // payload:
+        //    uint8_t *    microsteps_per_step     (one byte per mode)
+
+        bool payload_ok = (payload_size >= 1 && payload_size <= MotorCalibration::MAX_ENTRIES);
+        for (uint32_t i = 0; i < payload_size; i++) {
+            uint8_t mode = payload[i];
+            payload_ok &= (mode >= 1 && mode <= 32 && (mode & (mode - 1)) == 0);
+        }
+        if (!payload_ok) {
+            this->beeper.error(7);
+            uart_writeline("payload is not valid");
+            return;
+        }
+
+        if (!this->door.calibrate(payload, payload_size)) {
+            this->beeper.error(9);
+            uart_writeline("door is busy");
+            return;
+        }
+
+        uart_writeline("calibrating motor");
+        this->beeper.good(1000000);
+        break;
+    }
+    case time_set::MESSAGE_TYPE: {
+        // a 'set the time' message.
+        // payload:
+        //    uint64_t     unix_us
+        //    uint32_t     sequence
+
+        TimeSetMessage time_message;
+        if (!time_set_parse(valid_from, valid_until, payload, payload_size, time_message)) {
+            this->beeper.error(7);
+            uart_writeline("payload is not valid");
+            return;
+        }
+
+        // the sequence number is written to flash
+        if (!this->door.closed()) {
+            this->beeper.error(9);
+            uart_writeline("door is busy");
+            return;
+        }
+
+        uint32_t last_sequence = time_set_last_sequence(TIME_SET_SEQUENCES);
+        TimeSetResult result = time_set_check(
+            time_message, last_sequence, current_us, uncertainty_us, max_time_uncertainty_us
+        );
+        if (result == TimeSetResult::WRONG_SEQUENCE) {
+            uart_writeline("wrong sequence number");
+            this->beeper.error(10);
+            return;
+        }
+        if (result == TimeSetResult::CONTRADICTS) {
+            uart_writeline("time contradicts the known time");
+            this->beeper.error(11);
+            return;
         }
-        default: {
-            // unknown message type
-            uart_writeline("unknown message type");
-            beeper.error(8);
-            continue;
 
+        // the sequence number is used up before the time is set
+        if (!time_set_write_sequence(time_message.sequence)) {
+            uart_writeline("sequence number could not be written");
+            this->beeper.error(12);
+            return;
+        }
+        if (result == TimeSetResult::KEPT) {
+            uart_writeline("time is known better");
             break;
         }
+
+        set_time_us(time_get_64(), time_message.unix_us, time_set::UNCERTAINTY_US);
+        uart_writeline("setting time");
+        this->beeper.good(100000);
+        break;
+    }
+    default: {
+        // unknown message type
+        uart_writeline("unknown message type");
+        this->beeper.error(8);
+        return;
+
+        break;
+    }
+    }
+}
+
+static void cpp_main_in_cpp() {
+    StepperMotor motor(
+        OutputPin(GPIOA, GPIO_PIN_5),          // step
+        OutputPin(GPIOA, GPIO_PIN_6),          // sleep
+        OutputPin(GPIOA, GPIO_PIN_4),          // direction
+        {
+            OutputPin(GPIOB, GPIO_PIN_10),     // microstep modesel 0
+            OutputPin(GPIOB, GPIO_PIN_1),      // microstep modesel 1
+            OutputPin(GPIOB, GPIO_PIN_0)       // microstep modesel 2
+        },
+        InputPin(GPIOB, GPIO_PIN_5),           // clockwise end switch
+        InputPin(GPIOB, GPIO_PIN_6)            // counterclockwise end switch
+    );
+
+    // the speaker is on PA3
+    Beeper beeper;
+
+    OutputPin led0_b(GPIOA, GPIO_PIN_0);
+    OutputPin led0_g(GPIOA, GPIO_PIN_1);
+    OutputPin led0_r(GPIOA, GPIO_PIN_2);
+
+    // led1.green is the power indicator, it is always on.
+    OutputPin led1_b(GPIOC, GPIO_PIN_15);
+    led1_b.set();
+    // led1.green is connected directly to the DCF77 signal,
+    // it doesn't exist here
+    // led1.red is the DCF77 error indicator.
+    // it is on if no good signal was received in the last hour
+    OutputPin led1_r(GPIOC, GPIO_PIN_14);
+
+    // the time that the RTC has kept through the reset, until DCF77 has a minute
+    restore_timestamp();
+
+    // the DCF77 signal is on PA8
+    DCF77Receiver dcf77(led1_r);
+
+    // the HMAC key pads are hashed only once, and again on key change.
+    HMACContext hmac_context(SECRET_KEY);
+
+    Door door(motor);
+    MessageHandler handler(door, beeper, hmac_context);
+
+#if UNITS_BENCHMARK
+    UnitsBenchmark results[4];
+    uint32_t result_count = units_benchmark_run(results, 4);
+    for (uint32_t i = 0; i < result_count; i++) {
+        char line[64];
+        char *text = append_str(line, results[i].name);
+        text = append_str(text, ": ");
+        text = append_u32(text, results[i].division_cycles);
+        text = append_str(text, " cycles divided, ");
+        text = append_u32(text, results[i].units_cycles);
+        text = append_str(text, " cycles with units.h");
+        uart_writeline(line);
+    }
+#endif
+
+    Scheduler scheduler;
+    scheduler.add(door);
+    scheduler.add(handler);
+    scheduler.add(dcf77);
+
+    while (1)
+    {
+        uint64_t next = scheduler.run_due(time_get_64());
+
+        // SysTick wakes the CPU up at least every ms, so it may sleep
+        // if nothing is due before then.
+        if (next > time_get_64() + 1000) {
+            __WFI();
         }
     }
 }
@@ -1,102 +1,83 @@
 #include "dcf77.h"
 
-#include <bitset>
-
-#include "dcf77_analyze.h"
-#include "gregorian_calendar.h"
+#include "dcf77_edges.h"
 #include "hardware.h"
 #include "interrupts.h"
 #include "time.h"
 
-static void dcf77_update();
+static DCF77EdgeRing edge_ring;
 
-// the bits that were received this minute
-// a normal minute has 59 bits, but minutes where a leap second is inserted
-// have 60 bits.
-static std::bitset<60> rx_bits;
-static uint8_t rx_bitcount = 0;
-static InputPin *input_pin;
-static OutputPin *error_pin;
-static bool last_input = false;
-static uint32_t last_input_time;
-static uint64_t last_good_minute_timestamp = 0x8000000000000000ULL;
+// the decoder runs at this interval; the ring holds the edges of 8 s
+static constexpr uint64_t poll_interval_us = 100000;
 
-void dcf77_init(InputPin *pin, OutputPin *error_led) {
-    input_pin = pin;
-    error_pin = error_led;
-    last_input_time = time_get_64();
-    add_systick_callback(dcf77_update);
-}
+DCF77Receiver::DCF77Receiver(OutputPin error_led)
+    :
+    error_led{error_led}
+{
+    // PA8 stays a floating input, which TIM1 samples as TI1.
+    // IC1 captures the rising edges of TI1, and IC2 the falling ones;
+    // the F1 timers can't capture both edges on one channel.
+    // both filter for 8 samples at 72 MHz / 32, i.e. 3.5 us.
+    TIM1->CCER = 0;
+    TIM1->CCMR1 = (
+        TIM_CCMR1_CC1S_0 | TIM_CCMR1_IC1F |
+        TIM_CCMR1_CC2S_1 | TIM_CCMR1_IC2F
+    );
+    TIM1->CCER = TIM_CCER_CC1E | TIM_CCER_CC2E | TIM_CCER_CC2P;
+    TIM1->SR = ~(TIM_SR_CC1IF | TIM_SR_CC2IF | TIM_SR_CC1OF | TIM_SR_CC2OF);
+    TIM1->DIER |= TIM_DIER_CC1IE | TIM_DIER_CC2IE;
 
-static void dcf77_update() {
-    uint64_t monotonic_time = time_get_64_isr();
-    if (static_cast<uint64_t>(monotonic_time - last_good_minute_timestamp) > 3600000000) {
-        error_pin->set();
-    } else {
-        error_pin->reset();
-    }
+    // the edges may wait for up to 65 ms
+    HAL_NVIC_SetPriority(TIM1_CC_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(TIM1_CC_IRQn);
 
-    bool input = input_pin->get();
-    if (input == last_input) { return; }
-    last_input = input;
+    this->deadline = 0;
+}
 
-    uint32_t time_delta = static_cast<uint32_t>(monotonic_time) - last_input_time;
-    last_input_time = static_cast<uint32_t>(monotonic_time);
+void on_dcf77_capture() {
+    // reading a capture register clears its flag; the time is read after
+    // the captures, so that it is never older than them
+    uint32_t status = TIM1->SR;
+    uint16_t rising = (status & TIM_SR_CC1IF) ? TIM1->CCR1 : 0;
+    uint16_t falling = (status & TIM_SR_CC2IF) ? TIM1->CCR2 : 0;
+    uint64_t now = time_get_64_isr();
 
-    if (input) {
-        // Rising edge; analyze length of the negative duty cycle:
-        //
-        //  0.7s - 1.0s: regular second
-        //  1.7s - 2.0s: start of new minute
+    if (status & (TIM_SR_CC1OF | TIM_SR_CC2OF)) {
+        // an edge was lost; the decoder notices the repeated level
+        TIM1->SR = ~(TIM_SR_CC1OF | TIM_SR_CC2OF);
+    }
 
-        if ((time_delta > 700000) && (time_delta <= 1000000)) {
-            // It was just a regular second; everything is alright.
-        } else if ((time_delta >= 1700000) && (time_delta <= 2000000)) {
-            // Alright; this minute is done.
-            // Time to pass the accumulated bits on for analyzing.
-            // (this includes checking whether there are any/the
-            //  right number of bits and whether they make the
-            //  tiniest bit of sense).
-            uint64_t unix_timestamp;
-            if (dcf77_analyze(rx_bits, rx_bitcount, unix_timestamp)) {
-                set_timestamp(monotonic_time, unix_timestamp);
-                last_good_minute_timestamp = monotonic_time;
-            }
-            rx_bitcount = 0;
-        } else {
-            // This is an illegal duty cycle; the signal has
-            // been corrupted.
+    DCF77Edge rising_edge = {capture_time(now, rising), true};
+    DCF77Edge falling_edge = {capture_time(now, falling), false};
 
-            // Better luck next minute.
-            rx_bitcount = 0;
-        }
+    if (!(status & TIM_SR_CC2IF)) {
+        edge_ring.push(rising_edge);
+    } else if (!(status & TIM_SR_CC1IF)) {
+        edge_ring.push(falling_edge);
+    } else if (rising_edge.time_us <= falling_edge.time_us) {
+        edge_ring.push(rising_edge);
+        edge_ring.push(falling_edge);
     } else {
-        // Falling edge (bit has been received).
-        if (rx_bitcount > 60) {
-            // Something is awfully wrong here. Maybe we missed
-            // the minute-end marker.
+        edge_ring.push(falling_edge);
+        edge_ring.push(rising_edge);
+    }
+}
 
-            // discard the received bits.
-            rx_bitcount = 0;
+void DCF77Receiver::run(uint64_t now) {
+    DCF77Edge edge;
+    while (edge_ring.pop(edge)) {
+        uint64_t minute_start_us, unix_timestamp;
+        if (this->decoder.edge(edge, minute_start_us, unix_timestamp)) {
+            set_timestamp(minute_start_us, unix_timestamp, minute_start_uncertainty_us);
+            this->last_good_minute_timestamp = minute_start_us;
         }
+    }
 
-        // Analyze length of the positive duty cycle:
-        //
-        //  0.07s - 0.13s: bit 0
-        //  0.17s - 0.23s: bit 1
-
-        if ((time_delta >= 30000) && (time_delta <= 135000)) {
-            // We have received a "0" bit.
-            rx_bits[rx_bitcount++] = 0;
-        } else if ((time_delta >= 140000) && (time_delta <= 260000)) {
-            // We have received a "1" bit.
-            rx_bits[rx_bitcount++] = 1;
-        } else {
-            // Illegal positive duty cycle length; the signal is
-            // corrupted.
-            //
-            // Better luck next minute.
-            rx_bitcount = 0;
-        }
+    if (static_cast<uint64_t>(now - this->last_good_minute_timestamp) > 3600000000) {
+        this->error_led.set();
+    } else {
+        this->error_led.reset();
     }
+
+    this->deadline = now + poll_interval_us;
 }
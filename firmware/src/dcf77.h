@@ -2,6 +2,32 @@
 
 #include <cstdint>
 
+#include "dcf77_decoder.h"
 #include "pin.h"
+#include "scheduler.h"
 
-void dcf77_init(InputPin *pin, OutputPin *error_led);
\ No newline at end of file
+/**
+ * Receives the DCF77 time signal on PA8, which is TIM1_CH1.
+ *
+ * TIM1 is the us clock; its channels 1 and 2 capture the rising and
+ * the falling edges of the signal, and the capture interrupt puts them
+ * into a ring. run() decodes the edges, sets the time at the start of
+ * each valid minute, and switches the error LED on if there hasn't
+ * been one for an hour. Until the first minute, the time is the one
+ * that the RTC has kept through the reset, if any.
+ */
+class DCF77Receiver : public Task {
+public:
+    /** starts capturing */
+    explicit DCF77Receiver(OutputPin error_led);
+
+    void run(uint64_t now) override;
+
+private:
+    // the receiver delays the edges by a few ms, and by more or less
+    static constexpr uint32_t minute_start_uncertainty_us = 20000;
+
+    DCF77Decoder decoder;
+    OutputPin error_led;
+    uint64_t last_good_minute_timestamp = 0x8000000000000000ULL;
+};
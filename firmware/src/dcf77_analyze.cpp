@@ -11,99 +11,81 @@ static constexpr const uint32_t BASE_CENTURY = (BASE_YEAR / 100) * 100;
 static constexpr const uint32_t BASE_YEAR_IN_CENTURY = BASE_YEAR % 100;
 
 
-uint8_t parity(const std::bitset<60> &bits, uint8_t start, uint8_t end) {
-    uint8_t result = 0;
-    while (start <= end) {
-        if (bits[start++]) { result = !result; }
-    }
-    return result;
+/** the bits first to last, inclusive */
+static constexpr DCF77Frame bit_range(uint32_t first, uint32_t last) {
+    return ((DCF77Frame(1) << (last - first + 1)) - 1) << first;
+}
+
+static constexpr DCF77Frame bit(uint32_t index) {
+    return DCF77Frame(1) << index;
+}
+
+static constexpr DCF77Frame MINUTE_PARITY_GROUP = bit_range(21, 28);
+static constexpr DCF77Frame HOUR_PARITY_GROUP = bit_range(29, 35);
+static constexpr DCF77Frame DATE_PARITY_GROUP = bit_range(36, 58);
+static constexpr DCF77Frame CEST = bit(17);
+static constexpr DCF77Frame CET = bit(18);
+
+static inline bool odd_parity(DCF77Frame bits) {
+    return __builtin_popcountll(bits) & 1;
 }
 
-bool dcf77_analyze(const std::bitset<60> &bits, uint8_t bitcount, uint64_t &minute_timestamp) {
+/** a BCD field: the units in the lower four bits, the tens above */
+struct BCDField {
+    uint8_t start;
+    uint8_t length;
+    uint8_t min;
+    uint8_t max;
+};
+
+enum Field : uint8_t { MINUTE, HOUR, DAY_OF_MONTH, DAY_OF_WEEK, MONTH, YEAR_OF_CENTURY, FIELD_COUNT };
+
+static constexpr BCDField FIELDS[FIELD_COUNT] = {
+    {21, 7, 0, 59},
+    {29, 6, 0, 23},
+    {36, 6, 1, 31},
+    {42, 3, 1, 7},
+    {45, 5, 1, 12},
+    {50, 8, 0, 99}
+};
+
+bool dcf77_analyze(DCF77Frame bits, uint8_t bitcount, uint64_t &minute_timestamp) {
     // complete minute received
     if (bitcount < 59) { return false; }
     // on leap second: last bit always 0
-    if (bitcount == 60 && bits[59] != 0) { return false; }
-
-    // minute marker, always 0
-    if (bits[0] != 0) { return false; }
-    // time marker, always 1
-    if (bits[20] != 1) { return false; }
-    // even parity on minutes
-    if (parity(bits, 21, 28) != 0) { return false; }
-    // even parity on hours
-    if (parity(bits, 29, 35) != 0) { return false; }
-    // even parity on date
-    if (parity(bits, 36, 58) != 0) { return false; }
-
-    uint8_t utc_offset = bits[17] * 2 + bits[18];
-
-    uint8_t minute = 0;
-    if (bits[21]) { minute += 1; }
-    if (bits[22]) { minute += 2; }
-    if (bits[23]) { minute += 4; }
-    if (bits[24]) { minute += 8; }
-    if (minute >= 10) { return false; }
-    if (bits[25]) { minute += 10; }
-    if (bits[26]) { minute += 20; }
-    if (bits[27]) { minute += 40; }
-    if (minute >= 60) { return false; }
-
-    uint8_t hour = 0;
-    if (bits[29]) { hour += 1; }
-    if (bits[30]) { hour += 2; }
-    if (bits[31]) { hour += 4; }
-    if (bits[32]) { hour += 8; }
-    if (hour >= 10) { return false; }
-    if (bits[33]) { hour += 10; }
-    if (bits[34]) { hour += 20; }
-    if (hour >= 24) { return false; }
-
-    uint8_t day_of_month = 0;
-    if (bits[36]) { day_of_month += 1; }
-    if (bits[37]) { day_of_month += 2; }
-    if (bits[38]) { day_of_month += 4; }
-    if (bits[39]) { day_of_month += 8; }
-    if (day_of_month >= 10) { return false; }
-    if (bits[40]) { day_of_month += 10; }
-    if (bits[41]) { day_of_month += 20; }
-    if (day_of_month == 0) { return false; }
-
-    uint8_t day_of_week = 0;
-    if (bits[42]) { day_of_week += 1; }
-    if (bits[43]) { day_of_week += 2; }
-    if (bits[44]) { day_of_week += 4; }
-    if (day_of_week > 7) { return false; }
-    if (day_of_week == 0) { return false; }
-
-    uint8_t month = 0;
-    if (bits[45]) { month += 1; }
-    if (bits[46]) { month += 2; }
-    if (bits[47]) { month += 4; }
-    if (bits[48]) { month += 8; }
-    if (month >= 10) { return false; }
-    if (bits[49]) { month += 10; }
-    if (month > 12) { return false; }
-    if (month == 0) { return false; }
-
-    uint8_t year_of_century = 0;
-    if (bits[50]) { year_of_century += 1; }
-    if (bits[51]) { year_of_century += 2; }
-    if (bits[52]) { year_of_century += 4; }
-    if (bits[53]) { year_of_century += 8; }
-    if (year_of_century >= 10) { return false; }
-    if (bits[54]) { year_of_century += 10; }
-    if (bits[55]) { year_of_century += 20; }
-    if (bits[56]) { year_of_century += 40; }
-    if (bits[57]) { year_of_century += 80; }
-    if (year_of_century >= 100) { return false; }
-
-    uint32_t year = BASE_CENTURY + year_of_century;
-    if (year_of_century < BASE_YEAR_IN_CENTURY) { year += 100; }
+    if (bitcount == 60 && (bits & bit(59))) { return false; }
+
+    // minute marker, always 0; time marker, always 1
+    if ((bits & (bit(0) | bit(20))) != bit(20)) { return false; }
+    // even parity on minutes, hours and date
+    if (odd_parity(bits & MINUTE_PARITY_GROUP)) { return false; }
+    if (odd_parity(bits & HOUR_PARITY_GROUP)) { return false; }
+    if (odd_parity(bits & DATE_PARITY_GROUP)) { return false; }
+
+    // exactly one of CEST and CET
+    DCF77Frame zone = bits & (CEST | CET);
+    if (zone != CEST && zone != CET) { return false; }
+    uint8_t utc_offset = (zone == CEST) ? 2 : 1;
+
+    uint8_t values[FIELD_COUNT];
+    for (uint8_t i = 0; i < FIELD_COUNT; i++) {
+        const BCDField &field = FIELDS[i];
+        uint32_t code = static_cast<uint32_t>(bits >> field.start) & ((1u << field.length) - 1);
+        uint32_t units = code & 0xf;
+        if (units >= 10) { return false; }
+        uint32_t value = (code >> 4) * 10 + units;
+        if (value < field.min || value > field.max) { return false; }
+        values[i] = static_cast<uint8_t>(value);
+    }
+
+    uint32_t year = BASE_CENTURY + values[YEAR_OF_CENTURY];
+    if (values[YEAR_OF_CENTURY] < BASE_YEAR_IN_CENTURY) { year += 100; }
 
+    uint8_t month = values[MONTH];
+    uint8_t day_of_month = values[DAY_OF_MONTH];
     GregorianYear gregorian_year(year);
     for (uint8_t centuries_incremented = 0;;) {
-        if (gregorian_year.day_of_week(month, day_of_month) == day_of_week) { break; }
+        if (gregorian_year.day_of_week(month, day_of_month) == values[DAY_OF_WEEK]) { break; }
         if (++centuries_incremented == 4) {
             // day of week doesn't match for any century
             return false;
@@ -112,7 +94,34 @@ bool dcf77_analyze(const std::bitset<60> &bits, uint8_t bitcount, uint64_t &minu
     }
 
     minute_timestamp = gregorian_year.timestamp(month, day_of_month);
-    minute_timestamp += 3600 * hour + 60 * minute;
+    minute_timestamp += 3600 * values[HOUR] + 60 * values[MINUTE];
     minute_timestamp -= 3600 * utc_offset;
     return true;
 }
+
+bool dcf77_resolve_erasures(DCF77Frame &bits, DCF77Frame erasures, uint8_t bitcount) {
+    // minute marker, always 0; time marker, always 1; leap second, always 0
+    DCF77Frame zeros = bit(0);
+    if (bitcount == 60) { zeros |= bit(59); }
+    // weather, call bit and announcements don't affect the time
+    zeros |= bit_range(1, 16) | bit(19);
+    bits &= ~(erasures & zeros);
+    bits |= erasures & bit(20);
+
+    // exactly one of CEST and CET is set
+    if ((erasures & CEST) && (erasures & CET)) { return false; }
+    if (erasures & CEST) { bits = (bits & ~CEST) | ((bits & CET) ? 0 : CEST); }
+    if (erasures & CET) { bits = (bits & ~CET) | ((bits & CEST) ? 0 : CET); }
+
+    // even parity on minutes, hours and date
+    static constexpr DCF77Frame parity_groups[3] = {MINUTE_PARITY_GROUP, HOUR_PARITY_GROUP, DATE_PARITY_GROUP};
+    for (DCF77Frame group : parity_groups) {
+        DCF77Frame erased = erasures & group;
+        if (erased == 0) { continue; }
+        // more than one bit
+        if (erased & (erased - 1)) { return false; }
+        bits &= ~erased;
+        if (odd_parity(bits & group)) { bits |= erased; }
+    }
+    return true;
+}
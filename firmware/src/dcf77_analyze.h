@@ -1,6 +1,17 @@
 #pragma once
 
-#include <bitset>
 #include <cstdint>
 
-bool dcf77_analyze(const std::bitset<60> &bits, uint8_t bitcount, uint64_t &minute_timestamp);
\ No newline at end of file
+/**
+ * The bits of one minute, packed: second i of the minute in bit i.
+ */
+using DCF77Frame = uint64_t;
+
+bool dcf77_analyze(DCF77Frame bits, uint8_t bitcount, uint64_t &minute_timestamp);
+
+/**
+ * Fills in the bits that weren't received, where possible: the fixed
+ * bits, the bits that don't affect the time, and one bit per parity
+ * group. Returns false if an erased bit can't be known.
+ */
+bool dcf77_resolve_erasures(DCF77Frame &bits, DCF77Frame erasures, uint8_t bitcount);
@@ -0,0 +1,196 @@
+#include "dcf77_combiner.h"
+
+#include "dcf77_analyze.h"
+
+/** BCD of value in the lower bits, and the even parity above them */
+static uint8_t bcd_with_parity(uint32_t value, uint32_t length) {
+    uint8_t code = static_cast<uint8_t>((value / 10) << 4 | (value % 10));
+    uint8_t parity = 0;
+    for (uint32_t i = 0; i < length; i++) { parity ^= (code >> i) & 1; }
+    return code | static_cast<uint8_t>(parity << length);
+}
+
+/** how well the soft bits agree with the code; its bits are +1 or -1 */
+static int32_t agreement(const int8_t *bits, uint8_t code, uint32_t length) {
+    int32_t result = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        result += ((code >> i) & 1) ? bits[i] : -bits[i];
+    }
+    return result;
+}
+
+
+void DCF77MinuteCombiner::reset() {
+    for (bool &valid : this->frame_valid) { valid = false; }
+    this->minute = 0;
+    this->started = false;
+    this->have_last_time = false;
+    this->streak = 0;
+}
+
+
+bool DCF77MinuteCombiner::frame_age(uint32_t slot, uint32_t &age) const {
+    if (!this->frame_valid[slot]) { return false; }
+    age = this->minute - this->frame_minutes[slot];
+    return age < WINDOW;
+}
+
+
+bool DCF77MinuteCombiner::add(const DCF77SoftFrame &frame, uint64_t minute_start_us, uint64_t &unix_timestamp) {
+    // the frames must be a whole number of minutes apart
+    uint64_t delta_us = minute_start_us - this->last_start_us;
+    bool continues = this->started && delta_us < (WINDOW + 1) * 60000000ULL;
+    uint32_t gap = 0;
+    if (continues) {
+        gap = (static_cast<uint32_t>(delta_us) + 30000000) / 60000000;
+        int32_t offset_us = static_cast<int32_t>(static_cast<uint32_t>(delta_us) - gap * 60000000);
+        continues = (gap > 0 && offset_us > -1000000 && offset_us < 1000000);
+    }
+    if (!continues) { this->reset(); }
+
+    this->started = true;
+    this->minute += gap;
+    this->last_start_us = minute_start_us;
+    uint32_t slot = this->minute % WINDOW;
+    this->frames[slot] = frame;
+    this->frame_minutes[slot] = this->minute;
+    this->frame_valid[slot] = true;
+
+    uint64_t timestamp;
+    Agreement window, newest;
+    if (!this->combine(timestamp, window, newest)) { return false; }
+
+    if (newest.disagreements >= MIN_STALE_DISAGREEMENTS && newest.disagreements * 4 > newest.compared) {
+        for (uint32_t i = 0; i < WINDOW; i++) { this->frame_valid[i] = (i == slot); }
+        this->have_last_time = false;
+        this->streak = 0;
+        return false;
+    }
+
+    bool consistent = (
+        this->have_last_time &&
+        timestamp == this->last_timestamp + 60 * static_cast<uint64_t>(this->minute - this->last_time_minute)
+    );
+    this->streak = consistent ? this->streak + 1 : 0;
+    this->have_last_time = true;
+    this->last_timestamp = timestamp;
+    this->last_time_minute = this->minute;
+
+    // the noisier the frames, the more combinations in a row must give
+    // the same time: one below 2 % wrong bits, two below 5 %, else three
+    uint32_t required = 1;
+    if (window.disagreements * 50 > window.compared) { required += 1; }
+    if (window.disagreements * 20 > window.compared) { required += 1; }
+    if (this->streak < required) { return false; }
+
+    unix_timestamp = timestamp;
+    return true;
+}
+
+
+bool DCF77MinuteCombiner::combine(uint64_t &unix_timestamp, Agreement &window, Agreement &newest) const {
+    uint32_t age;
+
+    uint32_t frame_count = 0;
+    for (uint32_t slot = 0; slot < WINDOW; slot++) {
+        if (this->frame_age(slot, age)) { frame_count += 1; }
+    }
+    if (frame_count < MIN_FRAMES) { return false; }
+
+    // the minute, of which the older frames carry the predecessors
+    int32_t best_score = INT32_MIN, second_score = INT32_MIN;
+    uint32_t best_minute = 0;
+    for (uint32_t candidate = 0; candidate < 60; candidate++) {
+        int32_t score = 0;
+        for (uint32_t slot = 0; slot < WINDOW; slot++) {
+            if (!this->frame_age(slot, age)) { continue; }
+            uint8_t code = bcd_with_parity((candidate + 60 - age) % 60, 7);
+            score += agreement(&this->frames[slot].bits[21], code, 8);
+        }
+        if (score > best_score) {
+            second_score = best_score;
+            best_score = score;
+            best_minute = candidate;
+        } else if (score > second_score) {
+            second_score = score;
+        }
+    }
+    if (best_score - second_score < MIN_MARGIN) { return false; }
+
+    // the hour, which changes where the minutes of older frames wrap around
+    best_score = INT32_MIN;
+    second_score = INT32_MIN;
+    uint32_t best_hour = 0;
+    for (uint32_t candidate = 0; candidate < 24; candidate++) {
+        int32_t score = 0;
+        for (uint32_t slot = 0; slot < WINDOW; slot++) {
+            if (!this->frame_age(slot, age)) { continue; }
+            uint32_t minute_of_day = (candidate * 60 + best_minute + 1440 - age) % 1440;
+            uint8_t code = bcd_with_parity(minute_of_day / 60, 6);
+            score += agreement(&this->frames[slot].bits[29], code, 7);
+        }
+        if (score > best_score) {
+            second_score = best_score;
+            best_score = score;
+            best_hour = candidate;
+        } else if (score > second_score) {
+            second_score = score;
+        }
+    }
+    if (best_score - second_score < MIN_MARGIN) { return false; }
+
+    // the time zone, and the date of the frames since midnight
+    int32_t votes[60] = {};
+    uint8_t bitcount = 59;
+    for (uint32_t slot = 0; slot < WINDOW; slot++) {
+        if (!this->frame_age(slot, age)) { continue; }
+        const DCF77SoftFrame &frame = this->frames[slot];
+        votes[17] += frame.bits[17];
+        votes[18] += frame.bits[18];
+        if (best_hour * 60 + best_minute < age) { continue; }
+        for (uint32_t i = 36; i <= 58; i++) { votes[i] += frame.bits[i]; }
+        if (age == 0) { bitcount = frame.bitcount; }
+    }
+
+    DCF77Frame bits = 0;
+    DCF77Frame erasures = 0;
+    for (uint32_t i = 0; i < 60; i++) {
+        if (votes[i] > 0) { bits |= DCF77Frame(1) << i; }
+        if (votes[i] == 0) { erasures |= DCF77Frame(1) << i; }
+    }
+    // the minute with its parity in bits 21 to 28, the hour in 29 to 35
+    DCF77Frame time_code = bcd_with_parity(best_minute, 7) | bcd_with_parity(best_hour, 6) << 8;
+    bits = (bits & ~(DCF77Frame(0x7fff) << 21)) | time_code << 21;
+    erasures &= ~(DCF77Frame(0x7fff) << 21);
+
+    if (!dcf77_resolve_erasures(bits, erasures, bitcount)) { return false; }
+    if (!dcf77_analyze(bits, bitcount, unix_timestamp)) { return false; }
+
+    // the known bits of the frames that contradict the time
+    window = Agreement();
+    newest = Agreement();
+    for (uint32_t slot = 0; slot < WINDOW; slot++) {
+        if (!this->frame_age(slot, age)) { continue; }
+        auto compare = [&window, &newest, age](int8_t received, bool expected) {
+            if (received == 0) { return; }
+            bool wrong = (received > 0) != expected;
+            window.compared += 1;
+            window.disagreements += wrong;
+            if (age == 0) {
+                newest.compared += 1;
+                newest.disagreements += wrong;
+            }
+        };
+        const DCF77SoftFrame &frame = this->frames[slot];
+        uint32_t minute_of_day = (best_hour * 60 + best_minute + 1440 - age) % 1440;
+        uint8_t frame_minute_code = bcd_with_parity(minute_of_day % 60, 7);
+        uint8_t frame_hour_code = bcd_with_parity(minute_of_day / 60, 6);
+        for (uint32_t i = 0; i < 8; i++) { compare(frame.bits[21 + i], (frame_minute_code >> i) & 1); }
+        for (uint32_t i = 0; i < 7; i++) { compare(frame.bits[29 + i], (frame_hour_code >> i) & 1); }
+        compare(frame.bits[17], (bits >> 17) & 1);
+        compare(frame.bits[18], (bits >> 18) & 1);
+        if (best_hour * 60 + best_minute < age) { continue; }
+        for (uint32_t i = 36; i <= 58; i++) { compare(frame.bits[i], (bits >> i) & 1); }
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * The bits of one minute as received: positive for 1 and negative for
+ * 0, the more confident the larger; 0 if the bit is unknown.
+ */
+struct DCF77SoftFrame {
+    int8_t bits[60];
+    uint8_t bitcount;
+};
+
+/**
+ * Decodes the time from the frames of several minutes, so that it
+ * doesn't need a single minute without bit errors.
+ *
+ * The minute and the hour are the values that agree best with all
+ * frames in the window, counting back one minute per frame. The other
+ * bits are voted by the frames since midnight, weighted by their
+ * confidence; one unknown bit per parity group is filled in as by
+ * dcf77_resolve_erasures(). A time is only trusted if the previous
+ * combinations gave the same time; the more bits of the frames
+ * contradict it, the more of them.
+ *
+ * If the newest frame contradicts the combined time in a quarter of its
+ * bits, the older frames are dropped; they belong to another signal.
+ *
+ * Around a change of daylight saving time, the frames disagree on the
+ * hour for a window's length.
+ */
+class DCF77MinuteCombiner {
+public:
+    static constexpr uint32_t WINDOW = 8;
+
+    /**
+     * Adds the frame of the minute that starts at minute_start_us.
+     * Returns true if the time of that minute is trusted, in
+     * unix_timestamp.
+     */
+    bool add(const DCF77SoftFrame &frame, uint64_t minute_start_us, uint64_t &unix_timestamp);
+
+    /** forgets all frames */
+    void reset();
+
+private:
+    /** how many of the known time bits of some frames contradict a time */
+    struct Agreement {
+        uint32_t disagreements = 0;
+        uint32_t compared = 0;
+    };
+
+    /**
+     * The time of the newest frame, if the window gives a valid one,
+     * and how well all frames and the newest one agree with it.
+     */
+    bool combine(uint64_t &unix_timestamp, Agreement &window, Agreement &newest) const;
+
+    /** true if the frame of that slot is in the window; its age in minutes */
+    bool frame_age(uint32_t slot, uint32_t &age) const;
+
+    // a single frame can't outvote its own errors
+    static constexpr uint32_t MIN_FRAMES = 2;
+    // a field value must be ahead of the next best by this much; this
+    // is one bit of full confidence
+    static constexpr int32_t MIN_MARGIN = 4;
+    // a frame with fewer wrong bits may just be noisy
+    static constexpr uint32_t MIN_STALE_DISAGREEMENTS = 4;
+
+    DCF77SoftFrame frames[WINDOW];
+    // the minute number of the frame in each slot, counted from the
+    // first frame after a reset
+    uint32_t frame_minutes[WINDOW];
+    bool frame_valid[WINDOW] = {};
+    uint32_t minute = 0;
+    bool started = false;
+    uint64_t last_start_us = 0;
+
+    // the last combined time, which the next one must continue, and
+    // how many combinations in a row have continued the one before
+    bool have_last_time = false;
+    uint32_t streak = 0;
+    uint64_t last_timestamp = 0;
+    uint32_t last_time_minute = 0;
+};
@@ -0,0 +1,184 @@
+#include "dcf77_decoder.h"
+
+int8_t DCF77PulseClassifier::classify(uint32_t width_us) {
+    this->add(width_us);
+    this->estimate();
+
+    int32_t separation = static_cast<int32_t>(this->one_us - this->zero_us);
+    int32_t middle = static_cast<int32_t>(this->zero_us) + separation / 2;
+
+    // in eighths of the separation from the middle; a quarter of the
+    // separation around the middle is ambiguous, as is more than half
+    // the separation beyond either mean
+    int32_t eighths = (static_cast<int32_t>(width_us) - middle) * 8 / separation;
+    if (eighths > 8 || eighths < -8) { return 0; }
+    if (eighths > MAX_CONFIDENCE) { return MAX_CONFIDENCE; }
+    if (eighths < -MAX_CONFIDENCE) { return -MAX_CONFIDENCE; }
+    return static_cast<int8_t>(eighths);
+}
+
+
+void DCF77PulseClassifier::add(uint32_t width_us) {
+    if (width_us >= BINS * BIN_US) { return; }
+
+    if (this->count >= MAX_COUNT) {
+        this->count = 0;
+        for (uint16_t &bin : this->histogram) {
+            bin /= 2;
+            this->count += bin;
+        }
+    }
+    this->histogram[width_us / BIN_US] += 1;
+    this->count += 1;
+}
+
+
+void DCF77PulseClassifier::estimate() {
+    if (this->count < MIN_COUNT) { return; }
+
+    // the mean of all widths lies between the two clusters
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < BINS; i++) {
+        sum += this->histogram[i] * (i * BIN_US + BIN_US / 2);
+    }
+    uint32_t split = sum / this->count;
+
+    for (uint32_t iteration = 0; iteration < 3; iteration++) {
+        uint32_t zero_count = 0, zero_sum = 0, one_count = 0, one_sum = 0;
+        for (uint32_t i = 0; i < BINS; i++) {
+            uint32_t width = i * BIN_US + BIN_US / 2;
+            if (width < split) {
+                zero_count += this->histogram[i];
+                zero_sum += this->histogram[i] * width;
+            } else {
+                one_count += this->histogram[i];
+                one_sum += this->histogram[i] * width;
+            }
+        }
+        if (zero_count < MIN_CLUSTER_COUNT || one_count < MIN_CLUSTER_COUNT) { return; }
+
+        uint32_t zero = zero_sum / zero_count;
+        uint32_t one = one_sum / one_count;
+        if (one - zero < MIN_SEPARATION_US) { return; }
+
+        this->zero_us = zero;
+        this->one_us = one;
+        split = zero + (one - zero) / 2;
+    }
+}
+
+
+bool DCF77Deglitcher::edge(const DCF77Edge &edge, DCF77Edge &output) {
+    if (this->have_pending && edge.time_us - this->pending.time_us < GLITCH_US) {
+        // the pending edge started a glitch, which this edge ends
+        this->have_pending = false;
+        return false;
+    }
+
+    bool done = this->have_pending;
+    output = this->pending;
+    this->pending = edge;
+    this->have_pending = true;
+    return done;
+}
+
+
+bool DCF77Decoder::edge(const DCF77Edge &input, uint64_t &minute_start_us, uint64_t &unix_timestamp) {
+    DCF77Edge edge;
+    if (!this->deglitcher.edge(input, edge)) { return false; }
+
+    if (!edge.level) {
+        // a falling edge while low follows a lost rising edge; it has no meaning
+        if (this->level) { this->falling_edge(edge.time_us); }
+        this->level = false;
+        return false;
+    }
+
+    // a rising edge while high follows a lost falling edge; it may still
+    // start a second
+    this->level = true;
+    return this->rising_edge(edge.time_us, minute_start_us, unix_timestamp);
+}
+
+
+bool DCF77Decoder::rising_edge(uint64_t time_us, uint64_t &minute_start_us, uint64_t &unix_timestamp) {
+    uint64_t period_us = time_us - this->second_start_us;
+
+    if (!this->synced || period_us > (MAX_SECONDS_SKIPPED + 1) * 1000000ULL) {
+        // start counting seconds from here; this might be the start of
+        // a minute, but the next marker is certain to be
+        this->synced = true;
+        this->in_minute = true;
+        this->tentative_minute = true;
+        this->rx_bitcount = 0;
+        this->second_start_us = time_us;
+        this->pulse_open = true;
+        this->second_bit = 0;
+        return false;
+    }
+
+    uint32_t seconds = (static_cast<uint32_t>(period_us) + 500000) / 1000000;
+    int32_t offset_us = static_cast<int32_t>(static_cast<uint32_t>(period_us) - seconds * 1000000);
+    if (seconds == 0 || offset_us > static_cast<int32_t>(SECOND_TOLERANCE_US) || -offset_us > static_cast<int32_t>(SECOND_TOLERANCE_US)) {
+        // not the start of a second
+        return false;
+    }
+
+    // the second that started at second_start_us is over
+    this->append(this->pulse_open ? 0 : this->second_bit);
+
+    bool valid = false;
+    if (seconds == 2 && (!this->in_minute || (this->tentative_minute && this->rx_bitcount < 59))) {
+        // the first minute marker
+        this->in_minute = true;
+        this->tentative_minute = false;
+        this->rx_bitcount = 0;
+    } else if (seconds == 2 && (this->rx_bitcount == 59 || this->rx_bitcount == 60)) {
+        // Alright; this minute is done.
+        // Time to pass the accumulated bits on for analyzing,
+        // along with those of the minutes before.
+        this->rx_frame.bitcount = this->rx_bitcount;
+        valid = this->combiner.add(this->rx_frame, time_us, unix_timestamp);
+        if (valid) { minute_start_us = time_us; }
+        this->tentative_minute = false;
+        this->rx_bitcount = 0;
+    } else {
+        // the pulses of the seconds in between are missing
+        for (uint32_t second = 1; second < seconds; second++) {
+            this->append(0);
+        }
+    }
+
+    this->second_start_us = time_us;
+    this->pulse_open = true;
+    this->second_bit = 0;
+    return valid;
+}
+
+
+void DCF77Decoder::falling_edge(uint64_t time_us) {
+    if (!this->pulse_open) { return; }
+    this->pulse_open = false;
+
+    uint64_t width_us = time_us - this->second_start_us;
+    if (width_us <= MAX_PULSE_US) {
+        this->second_bit = this->pulses.classify(static_cast<uint32_t>(width_us));
+    }
+}
+
+
+void DCF77Decoder::append(int8_t bit) {
+    if (!this->in_minute) { return; }
+    if (this->rx_bitcount >= 60) {
+        // Something is awfully wrong here. Maybe we missed
+        // the minute-end marker.
+
+        // discard the received bits, and wait for the next marker.
+        this->in_minute = false;
+        return;
+    }
+
+    this->rx_frame.bits[this->rx_bitcount] = bit;
+    this->rx_bitcount += 1;
+    if (bit == 0) { this->erasure_count += 1; }
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+
+#include "dcf77_combiner.h"
+#include "dcf77_edges.h"
+
+/**
+ * Classifies pulse widths as 0 or 1 bits, by thresholds that it learns
+ * from a histogram of the recent widths.
+ *
+ * The widths of the 0 and 1 pulses are the means of the two clusters of
+ * the histogram (2-means). Until there are enough pulses of both kinds,
+ * they are the nominal 100 ms and 200 ms. Widths close to the middle
+ * between the two, and widths far outside, are erasures.
+ */
+class DCF77PulseClassifier {
+public:
+    // the confidence of a width at the mean of its cluster
+    static constexpr int8_t MAX_CONFIDENCE = 4;
+
+    /**
+     * Adds the width to the histogram, and classifies it as a soft bit:
+     * positive for 1 and negative for 0, from 1 at an eighth of the
+     * separation from the middle to MAX_CONFIDENCE at the means; 0 for
+     * erasures.
+     */
+    int8_t classify(uint32_t width_us);
+
+    /** the current estimates of the 0 and 1 pulse widths */
+    inline uint32_t zero_width_us() const { return this->zero_us; }
+    inline uint32_t one_width_us() const { return this->one_us; }
+
+    static constexpr uint32_t BIN_US = 8000;
+    static constexpr uint32_t BINS = 40;
+
+private:
+    void add(uint32_t width_us);
+    void estimate();
+
+    // the histogram is halved when it holds this many pulses, so that it
+    // follows changes of the receiver within a few minutes
+    static constexpr uint32_t MAX_COUNT = 240;
+    static constexpr uint32_t MIN_COUNT = 20;
+    static constexpr uint32_t MIN_CLUSTER_COUNT = 4;
+    static constexpr uint32_t MIN_SEPARATION_US = 50000;
+
+    uint16_t histogram[BINS] = {};
+    uint32_t count = 0;
+    uint32_t zero_us = 100000;
+    uint32_t one_us = 200000;
+};
+
+/**
+ * Removes pulses and gaps shorter than GLITCH_US from the edges, e.g.
+ * spikes induced by the motor driver. Each edge is held back until the
+ * next one shows that it wasn't the start of a glitch.
+ */
+class DCF77Deglitcher {
+public:
+    static constexpr uint32_t GLITCH_US = 30000;
+
+    /** processes the next edge; returns true if an earlier edge is done */
+    bool edge(const DCF77Edge &edge, DCF77Edge &output);
+
+private:
+    DCF77Edge pending;
+    bool have_pending = false;
+};
+
+/**
+ * Decodes the DCF77 signal from its edges.
+ *
+ * The seconds start with the rising edges, which are 1 s apart, or 2 s
+ * before the start of a minute. Rising edges that aren't a whole number
+ * of seconds after the last one are ignored; seconds without a
+ * valid pulse are erasures. The soft bits of each minute go to a
+ * DCF77MinuteCombiner.
+ */
+class DCF77Decoder {
+public:
+    /**
+     * Processes the next edge. Returns true at the start of a minute
+     * whose time is trusted; minute_start_us is then the time of the
+     * edge, and unix_timestamp the time it stands for.
+     */
+    bool edge(const DCF77Edge &edge, uint64_t &minute_start_us, uint64_t &unix_timestamp);
+
+    /** the number of erasures in the minutes so far */
+    inline uint32_t erasures() const { return this->erasure_count; }
+
+private:
+    bool rising_edge(uint64_t time_us, uint64_t &minute_start_us, uint64_t &unix_timestamp);
+    void falling_edge(uint64_t time_us);
+    void append(int8_t bit);
+
+    // the rising edges may be this far off a whole number of seconds
+    static constexpr uint32_t SECOND_TOLERANCE_US = 100000;
+    // pulses end within this time after the start of the second
+    static constexpr uint32_t MAX_PULSE_US = 400000;
+    // after this many seconds without a rising edge, the decoder syncs anew
+    static constexpr uint32_t MAX_SECONDS_SKIPPED = 10;
+
+    DCF77Deglitcher deglitcher;
+    DCF77PulseClassifier pulses;
+    DCF77MinuteCombiner combiner;
+
+    bool level = false;
+    bool synced = false;
+    bool in_minute = false;
+    // the minute was started at the first second after syncing, not by
+    // a marker; the next marker starts it anew
+    bool tentative_minute = false;
+    uint64_t second_start_us = 0;
+    bool pulse_open = false;
+    int8_t second_bit = 0;
+
+    // the bits that were received this minute
+    // a normal minute has 59 bits, but minutes where a leap second is inserted
+    // have 60 bits.
+    DCF77SoftFrame rx_frame;
+    uint8_t rx_bitcount = 0;
+    uint32_t erasure_count = 0;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/** a level change of the DCF77 signal; level is true while the carrier is reduced */
+struct DCF77Edge {
+    uint64_t time_us;
+    bool level;
+};
+
+/**
+ * The time of a 16-bit capture of the us counter, which is the lower 16
+ * bits of the 64-bit time. The capture must be less than 65 ms older
+ * than now.
+ */
+constexpr uint64_t capture_time(uint64_t now, uint16_t capture) {
+    return now - static_cast<uint16_t>(static_cast<uint16_t>(now) - capture);
+}
+
+/**
+ * The captured edges, from the capture interrupt to the main loop.
+ * Lock-free for one producer and one consumer.
+ */
+class DCF77EdgeRing {
+public:
+    static constexpr uint32_t SIZE = 16;
+
+    /** called by the producer; returns false, and counts it, if the ring is full */
+    bool push(const DCF77Edge &edge) {
+        uint32_t head = this->head.load(std::memory_order_relaxed);
+        if (head - this->tail.load(std::memory_order_acquire) >= SIZE) {
+            this->dropped.store(this->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        this->edges[head % SIZE] = edge;
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** called by the consumer; returns false if the ring is empty */
+    bool pop(DCF77Edge &edge) {
+        uint32_t tail = this->tail.load(std::memory_order_relaxed);
+        if (tail == this->head.load(std::memory_order_acquire)) { return false; }
+        edge = this->edges[tail % SIZE];
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** how many edges didn't fit into the ring */
+    inline uint32_t drops() const { return this->dropped.load(std::memory_order_relaxed); }
+
+private:
+    DCF77Edge edges[SIZE];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint32_t> dropped{0};
+};
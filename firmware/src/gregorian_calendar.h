@@ -2,74 +2,135 @@
 
 #include <cstdint>
 
+#include "units.h"
+
+/** a day of the proleptic Gregorian calendar */
+struct CivilDate {
+    uint32_t year;
+    uint8_t month;
+    uint8_t day;
+};
+
+namespace gregorian {
+
+// the days from 0000-03-01, the start of the first 400-year period
+// counted from March, to 2000-01-01
+static constexpr uint32_t EPOCH_DAYS = 730425;
+
+// the days from March 1st to the first of each month, counted from March
+static constexpr uint16_t DAYS_FROM_MARCH[12] = {0, 31, 61, 92, 122, 153, 184, 214, 245, 275, 306, 337};
+
+// the length of each month; February is 29 days long in leap years
+static constexpr uint8_t MONTH_LENGTH[13] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+// the days before the first of each month in a year without February 29th
+static constexpr uint16_t DAYS_BEFORE_MONTH[13] = {0, 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+
+}  // namespace gregorian
+
+constexpr bool is_leap_year(uint32_t year) {
+    return (year % 4 == 0) & ((year % 100 != 0) | (year % 400 == 0));
+}
+
+/**
+ * The number of days from 2000-01-01 to the date, which must not be
+ * before 2000-01-01 and have a month from 1 to 12.
+ *
+ * The year is counted from March, so that the leap day is the last
+ * day of a year; the days before a month are then the same every year.
+ */
+constexpr uint32_t days_from_civil(uint32_t year, uint8_t month, uint8_t day) {
+    uint32_t march_year = year - (month <= 2);
+    uint32_t era = march_year / 400;
+    uint32_t year_of_era = march_year - era * 400;
+    uint32_t day_of_year = gregorian::DAYS_FROM_MARCH[(month + 9) % 12] + day - 1;
+    uint32_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - gregorian::EPOCH_DAYS;
+}
+
+/** the date of the day that is days after 2000-01-01; the inverse of days_from_civil() */
+constexpr CivilDate civil_from_days(uint32_t days) {
+    uint32_t days_from_march = days + gregorian::EPOCH_DAYS;
+    uint32_t era = days_from_march / 146097;
+    uint32_t day_of_era = days_from_march - era * 146097;
+    // the leap days so far are subtracted; the last day of the era is a 366th day
+    uint32_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    uint32_t day_of_year = day_of_era - (year_of_era * 365 + year_of_era / 4 - year_of_era / 100);
+    // the months from March have 153 days every five months
+    uint32_t month_from_march = (5 * day_of_year + 2) / 153;
+    uint32_t day = day_of_year - (153 * month_from_march + 2) / 5 + 1;
+    uint32_t month = (month_from_march + 2) % 12 + 1;
+    uint32_t year = era * 400 + year_of_era + (month <= 2);
+    return CivilDate{year, static_cast<uint8_t>(month), static_cast<uint8_t>(day)};
+}
+
+/** the day of week (1 = monday, 7 = sunday) of the day that is days after 2000-01-01 */
+constexpr uint8_t day_of_week_from_days(uint32_t days) {
+    // 2000-01-01 was a saturday
+    return static_cast<uint8_t>((days + 5) % 7 + 1);
+}
+
+/** the date of a unix timestamp, which must not be before 2000-01-01 */
+constexpr CivilDate civil_from_timestamp(uint64_t timestamp) {
+    return civil_from_days(static_cast<uint32_t>(units::ConstantDivisor<86400>::divide(timestamp - 946684800)));
+}
+
+static_assert(days_from_civil(2000, 1, 1) == 0, "");
+static_assert(days_from_civil(2000, 3, 1) == 60, "");
+static_assert(days_from_civil(2001, 1, 1) == 366, "");
+static_assert(days_from_civil(2400, 12, 31) == 146462, "");
+static_assert(civil_from_days(59).month == 2 && civil_from_days(59).day == 29, "");
+static_assert(civil_from_days(146462).year == 2400, "");
+static_assert(day_of_week_from_days(days_from_civil(2019, 5, 17)) == 5, "");
+
 class GregorianYear {
 public:
-    inline GregorianYear(uint32_t year) {
-        this->set(year);
-    }
+    constexpr GregorianYear(uint32_t year) : year(year), is_leap_year(::is_leap_year(year)) {}
 
     void set(uint32_t year);
 
-    inline uint32_t get() { return this->year; }
+    constexpr uint32_t get() const { return this->year; }
 
-    inline uint32_t length_days() {
-        if (this->is_leap_year) { return 366; } else { return 365; }
+    constexpr uint32_t length_days() const {
+        return 365 + this->is_leap_year;
     }
 
-    inline uint8_t month_length(uint8_t month) {
-        switch (month) {
-        case  1: return 31;
-        case  2: return this->is_leap_year ? 29 : 28;
-        case  3: return 31;
-        case  4: return 30;
-        case  5: return 31;
-        case  6: return 30;
-        case  7: return 31;
-        case  8: return 31;
-        case  9: return 30;
-        case 10: return 31;
-        case 11: return 30;
-        case 12: return 31;
-        default: return 0;
-        }
+    constexpr uint8_t month_length(uint8_t month) const {
+        if (month > 12) { return 0; }
+        return gregorian::MONTH_LENGTH[month] + (month == 2 && this->is_leap_year);
     }
 
-    inline uint32_t days_before_month(uint8_t month) {
-        switch (month) {
-        case  1: return 0;
-        case  2: return 31;
-        case  3: return this->is_leap_year ?  60 :  59;
-        case  4: return this->is_leap_year ?  91 :  90;
-        case  5: return this->is_leap_year ? 121 : 120;
-        case  6: return this->is_leap_year ? 152 : 151;
-        case  7: return this->is_leap_year ? 182 : 181;
-        case  8: return this->is_leap_year ? 213 : 212;
-        case  9: return this->is_leap_year ? 244 : 243;
-        case 10: return this->is_leap_year ? 274 : 273;
-        case 11: return this->is_leap_year ? 305 : 304;
-        case 12: return this->is_leap_year ? 335 : 334;
-        default: return 0;
-        }
+    constexpr uint32_t days_before_month(uint8_t month) const {
+        if (month > 12) { return 0; }
+        return gregorian::DAYS_BEFORE_MONTH[month] + (month > 2 && this->is_leap_year);
     }
 
     // note that this counts from 1, not from 0
-    inline uint32_t day_of_year(uint8_t month, uint8_t day) {
+    constexpr uint32_t day_of_year(uint8_t month, uint8_t day) const {
         return days_before_month(month) + day;
     }
 
     // calculates the number of complete days between epoch and start of
     // January 1st of this year.
-    uint32_t days_since_epoch();
+    constexpr uint32_t days_since_epoch() const {
+        return days_from_civil(this->year, 1, 1);
+    }
 
     // calculates the number of complete days between epoch and start of
     // this day
-    uint32_t days_since_epoch(uint8_t month, uint8_t day);
+    constexpr uint32_t days_since_epoch(uint8_t month, uint8_t day) const {
+        return days_from_civil(this->year, month, day);
+    }
 
     // calculates the day of week (1 = monday, 7 = sunday)
-    uint8_t day_of_week(uint8_t month, uint8_t day);
+    constexpr uint8_t day_of_week(uint8_t month, uint8_t day) const {
+        return day_of_week_from_days(this->days_since_epoch(month, day));
+    }
 
     // calculates the unix timestamp
-    uint64_t timestamp(uint8_t month, uint8_t day);
+    constexpr uint64_t timestamp(uint8_t month, uint8_t day) const {
+        return static_cast<uint64_t>(this->days_since_epoch(month, day)) * 3600 * 24 + EPOCH_TIMESTAMP;
+    }
 
 private:
     uint32_t year;
@@ -77,4 +138,4 @@ private:
 
     // the timestamp of the epoch
     static constexpr const uint64_t EPOCH_TIMESTAMP = 946684800;
-};
\ No newline at end of file
+};
@@ -1,157 +1,160 @@
 #include "hardware.h"
 
 #include <array>
+#include <cstring>
 
 #include "main.h"
+#include "monotonic_clock.h"
 
-static uint64_t timer_extended_bits = 0;
+/** TIM1 counts us */
+struct TIM1Counter {
+    static inline uint16_t read() { return time_get_16(); }
+};
+
+static MonotonicClock<TIM1Counter> monotonic_clock;
 
 uint64_t time_get_64() {
-    CriticalSectionLock lk;
-    return time_get_64_isr();
+    return monotonic_clock.now();
 }
 
-static uint64_t prev_result = 0;
-
-
-// extended bits                      timer
-// 00000000000000000000000000         00000000
-// 00000000000000000000000000         01111111
-// 00000000000000000000000001         10000000       inc
-// 00000000000000000000000001         10000000
-// 00000000000000000000000001         11111111
-// 00000000000000000000000010         00000000       inc
-// 00000000000000000000000010         00000010
-
-
 uint64_t time_get_64_isr() {
-    uint16_t timer_val = time_get_16();
+    return monotonic_clock.now();
+}
+
+void timer_update_extended_bits() {
+    monotonic_clock.update();
+}
 
-    bool timer_msb = timer_val & 0x8000;
+volatile struct isr_latency_statistics isr_latency_stats = {0, 0};
 
-    if ((timer_extended_bits & 1) != timer_msb) {
-        timer_extended_bits += 1;
+void isr_latency_measure_systick() {
+    // SysTick counts down from LOAD, and the interrupt is pending since
+    // it has been reloaded.
+    uint32_t cycles = SysTick->LOAD - SysTick->VAL;
+    isr_latency_stats.systick_interrupts += 1;
+    if (cycles > isr_latency_stats.systick_max_cycles) {
+        isr_latency_stats.systick_max_cycles = cycles;
     }
+}
 
-    uint64_t result = (
-        static_cast<uint64_t>(timer_extended_bits << 15) |
-        static_cast<uint64_t>(timer_val)
+UARTRxFramer rx_framer;
+DMARxRing rx_ring;
+
+volatile struct uart_rx_statistics uart_rx_stats = {0, 0};
+
+void uart_rx_dma_start() {
+    // count CPU cycles for the interrupt statistics
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    // USART1_RX is on DMA1 channel 5
+    DMA1_Channel5->CCR = 0;
+    DMA1_Channel5->CPAR = reinterpret_cast<uint32_t>(&huart1.Instance->DR);
+    DMA1_Channel5->CMAR = reinterpret_cast<uint32_t>(rx_ring.buf.data());
+    DMA1_Channel5->CNDTR = rx_ring.buf.size();
+    DMA1_Channel5->CCR = (
+        DMA_CCR_MINC |
+        DMA_CCR_CIRC |
+        DMA_CCR_HTIE |
+        DMA_CCR_TCIE |
+        DMA_CCR_EN
     );
 
-    if (result < prev_result) {
-        // wtf this is supposed to be monotonic
-        // this can happen if interrupts were blocked for > 30ms
-
-        // let's try to restore monotonoty...
-        result += 0x10000;
-        timer_extended_bits += 2;
-    }
-    prev_result = result;
+    HAL_NVIC_SetPriority(DMA1_Channel5_IRQn, 4, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel5_IRQn);
 
-    return result;
+    huart1.Instance->CR3 |= USART_CR3_DMAR;
+    huart1.Instance->CR1 |= USART_CR1_IDLEIE;
 }
 
-void timer_update_extended_bits() {
-    /**
-    bool timer_msb = time_get_16() & 0x8000;
+void uart_rx_dma_update() {
+    uint32_t start = DWT->CYCCNT;
 
-    if ((timer_extended_bits & 1) != timer_msb) {
-        timer_extended_bits += 1;
+    bool idle = huart1.Instance->SR & USART_SR_IDLE;
+    if (idle) {
+        // reading SR, then DR clears the idle flag
+        (void) huart1.Instance->DR;
     }
-    */
-    time_get_64_isr();
-}
+    DMA1->IFCR = DMA_IFCR_CHTIF5 | DMA_IFCR_CTCIF5 | DMA_IFCR_CGIF5;
 
-// the UART rx buffers are double-buffered.
-UARTRxBuffer rxbuf_a;
-UARTRxBuffer rxbuf_b;
-
-// this is the buffer to which newly-received bytes are stored
-UARTRxBuffer *current_rxbuf = &rxbuf_a;
-// this is the buffer which is being processed
-UARTRxBuffer *current_procbuf = &rxbuf_b;
-
-void uart_data_received(uint8_t byte) {
-    if (byte == '\0' || byte == '\r' || byte == '\n') {
-        current_rxbuf->finish();
-    } else {
-        current_rxbuf->add(byte);
+    rx_ring.update(DMA1_Channel5->CNDTR, rx_framer);
+    if (idle) {
+        rx_framer.idle();
     }
+
+    uart_rx_stats.interrupts = uart_rx_stats.interrupts + 1;
+    uart_rx_stats.isr_cycles = uart_rx_stats.isr_cycles + (DWT->CYCCNT - start);
 }
 
 UARTTxBuffer txbuf;
 
-void uart_transmit_next() {
-    if (!(huart1.Instance->SR & USART_SR_TXE)) {
-        // currently transmitting
+/** starts the DMA transfer of the next chunk; interrupts must be disabled */
+static void uart_transmit_next() {
+    const uint8_t *data;
+    uint32_t length = txbuf.start_chunk(data);
+    if (length == 0) {
+        // idle, or a chunk is being transmitted
         return;
     }
 
-    int byte = txbuf.get_next();
-    if (byte < 0) {
-        // we're done. manually reset the TC bit,
-        // otherwise we'll get an infinite interrupt loop.
-        huart1.Instance->SR &= ~USART_SR_TC;
-    } else {
-        // send the next byte
-        huart1.Instance->DR = byte;
-    }
+    // USART1_TX is on DMA1 channel 4
+    DMA1_Channel4->CCR = 0;
+    DMA1_Channel4->CMAR = reinterpret_cast<uint32_t>(data);
+    DMA1_Channel4->CNDTR = length;
+    DMA1_Channel4->CCR = DMA_CCR_MINC | DMA_CCR_DIR | DMA_CCR_TCIE | DMA_CCR_EN;
 }
 
-void uart_writeline(const char *text) {
-    txbuf.add(text);
-    txbuf.add('\r');
-    txbuf.add('\n');
-    uart_transmit_next();
-}
+void uart_tx_dma_start() {
+    __HAL_RCC_DMA1_CLK_ENABLE();
 
-UARTRxBuffer *uart_poll_message() {
-    CriticalSectionLock lk;
+    DMA1_Channel4->CCR = 0;
+    DMA1_Channel4->CPAR = reinterpret_cast<uint32_t>(&huart1.Instance->DR);
 
-    if (!current_rxbuf->finished) { return nullptr; }
+    HAL_NVIC_SetPriority(DMA1_Channel4_IRQn, 4, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel4_IRQn);
 
-    UARTRxBuffer *tmp = current_rxbuf;
-
-    current_rxbuf = current_procbuf;
-    current_rxbuf->reset();
+    huart1.Instance->CR3 |= USART_CR3_DMAT;
+}
 
-    current_procbuf = tmp;
+void uart_tx_dma_complete() {
+    CriticalSectionLock lk;
 
-    return tmp;
+    DMA1->IFCR = DMA_IFCR_CTCIF4 | DMA_IFCR_CGIF4;
+    txbuf.finish_chunk();
+    // the data may have wrapped around, or more has been added
+    uart_transmit_next();
 }
 
-int UARTTxBuffer::get_next() {
-    if (this->start_pos == this->end_pos) { return -1; }
-    uint8_t result = this->buf[this->start_pos];
-    start_pos = (start_pos + 1) % this->buf.size();
-    return result;
-}
+bool uart_writeline(const char *text) {
+    uint32_t length = strlen(text);
 
-bool UARTTxBuffer::add(uint8_t byte) {
     CriticalSectionLock lk;
-
-    uint32_t new_end_pos = (this->end_pos + 1) % this->buf.size();
-    if (new_end_pos == this->start_pos) {
-        // the tx buffer is full
+    if (length + 2 > txbuf.space()) {
         return false;
     }
-
-    this->buf[this->end_pos] = byte;
-    this->end_pos = new_end_pos;
+    txbuf.add(reinterpret_cast<const uint8_t *>(text), length);
+    txbuf.add(reinterpret_cast<const uint8_t *>("\r\n"), 2);
+    uart_transmit_next();
     return true;
 }
 
-bool UARTTxBuffer::add(const char *buf) {
-    while (*buf) {
-        if (!this->add(static_cast<uint8_t>(*(buf++)))) { return false; }
-    }
-    return true;
+UARTRxBuffer *uart_poll_message() {
+    // the message queue is lock-free
+    return rx_framer.poll_message();
+}
 
+void uart_rx_dropped(uint32_t &queue_full, uint32_t &too_long) {
+    queue_full = rx_framer.dropped_queue_full;
+    too_long = rx_framer.dropped_too_long;
 }
 
-bool UARTTxBuffer::add(const uint8_t *buf, uint32_t len) {
-    while (len-- > 0) {
-        if (!this->add(*(buf++))) { return false; }
-    }
-    return true;
-}
\ No newline at end of file
+UARTRxBuffer *uart_peek_receiving(uint32_t &generation, uint32_t &length) {
+    CriticalSectionLock lk;
+    // pick up the bytes that have arrived since the last RX interrupt,
+    // so the main loop can process them before the line goes idle.
+    rx_ring.update(DMA1_Channel5->CNDTR, rx_framer);
+    return rx_framer.peek_receiving(generation, length);
+}
@@ -6,6 +6,9 @@
 
 #include <array>
 
+#include "uart_rx.h"
+#include "uart_tx.h"
+
 class CriticalSectionLock {
 public:
     CriticalSectionLock() {
@@ -17,52 +20,35 @@ public:
     }
 };
 
-class UARTRxBuffer {
-public:
-    std::array<uint8_t, 256> buf;
-    uint32_t buf_pos;
-    bool finished;
-
-    inline UARTRxBuffer() { this->reset(); }
-
-    inline void reset() {
-        this->buf_pos = 0;
-        this->finished = false;
-    }
-
-    inline void finish() {
-        this->finished = true;
-    }
-
-    inline void add(uint8_t data) {
-        if (this->finished) {
-            this->reset();
-        }
-        if (this->buf_pos >= this->buf.size()) { return; }
-        this->buf[this->buf_pos++] = data;
-    }
-};
-
-class UARTTxBuffer {
-public:
-    std::array<uint8_t, 256> buf;
-    uint32_t start_pos = 0;
-    uint32_t end_pos = 0;
-
-    int get_next();
-    bool add(uint8_t byte);
-    bool add(const char *buf);
-    bool add(const uint8_t *buf, uint32_t len);
-};
-
 /**
  * Returns nullptr if no new message has been received.
  * Returns UARTRxBuffer containing a message if a new message has been
- * received. The return value is invalidated upon the next call to this
- * function.
+ * received. Up to UARTRxFramer::SLOTS messages are queued.
+ * The return value is invalidated upon the next call to this function.
  */
 UARTRxBuffer *uart_poll_message();
 
+/**
+ * The number of received messages that were dropped because the
+ * message queue was full, or because they were too long.
+ */
+void uart_rx_dropped(uint32_t &queue_full, uint32_t &too_long);
+
+/**
+ * Returns the UARTRxBuffer to which bytes are currently being received,
+ * after collecting the bytes that the DMA controller has received so far,
+ * along with its generation and the number of bytes received so far.
+ * buf[:length] won't change as long as the generation stays the same.
+ */
+UARTRxBuffer *uart_peek_receiving(uint32_t &generation, uint32_t &length);
+
+/**
+ * Transmits a line on UART, without waiting for it to be sent.
+ * Returns false, and transmits nothing, if the line doesn't fit into
+ * the TX buffer.
+ */
+bool uart_writeline(const char *text);
+
 #endif
 
 #ifdef __cplusplus
@@ -79,37 +65,68 @@ inline uint16_t time_get_16() {
 
 /**
  * Gets a 64-bit timer value in us since boot.
- * Must be called form an ISR, otherwise the
- * behavior is undefined.
+ * The same as time_get_64(); both may be called from any context.
  */
 uint64_t time_get_64_isr();
 
 /**
  * Gets a 64-bit timer value in us since boot.
- * Overflowsn't.
+ * Overflowsn't. It doesn't disable interrupts; see monotonic_clock.h.
  */
 uint64_t time_get_64();
 
 /**
  * Must be called from the systick handler
- * at least once every 32ms.
+ * at least once every 65ms.
  */
 void timer_update_extended_bits();
 
+/** interrupt latency statistics, to be read with the debugger */
+struct isr_latency_statistics {
+    uint32_t systick_interrupts;
+    // the longest time from the SysTick reload until the SysTick
+    // handler has started, in CPU cycles. SysTick has the highest
+    // priority, so this is mostly the longest time with interrupts
+    // disabled.
+    uint32_t systick_max_cycles;
+};
+
+extern volatile struct isr_latency_statistics isr_latency_stats;
+
+/** to be called first thing in the SysTick handler */
+void isr_latency_measure_systick();
+
+/**
+ * Starts receiving to the circular DMA buffer.
+ * To be called after the UART has been initialized.
+ */
+void uart_rx_dma_start();
+
 /**
- * To be called from the UART RX interrupt handler
+ * To be called from the UART idle-line interrupt handler and the
+ * DMA half-transfer and transfer-complete interrupt handlers.
  */
-void uart_data_received(uint8_t byte);
+void uart_rx_dma_update();
+
+/** UART RX interrupt statistics */
+struct uart_rx_statistics {
+    uint32_t interrupts;
+    // time spent in the RX interrupt handlers, in CPU cycles
+    uint32_t isr_cycles;
+};
+
+extern volatile struct uart_rx_statistics uart_rx_stats;
 
 /**
- * To be called from the UART TX interrupt handler
+ * Sets up transmitting from the TX buffer by DMA.
+ * To be called after the UART has been initialized.
  */
-void uart_transmit_next();
+void uart_tx_dma_start();
 
 /**
- * Transmits a line on UART.
+ * To be called from the UART TX DMA transfer-complete interrupt handler
  */
-void uart_writeline(const char *text);
+void uart_tx_dma_complete();
 
 #ifdef __cplusplus
 }
@@ -1,40 +1,64 @@
 #include "hmac.h"
 
 #include "secret_key.h"
-#include "sha256.h"
 
 #define OPAD 0x5c
 #define IPAD 0x36
 
 #define BLOCK_SIZE 64
+#define KEY_SIZE 32
 
-void get_padded_key(uint8_t padding, uint8_t result[BLOCK_SIZE]);
+static void get_padded_key(const uint8_t key[KEY_SIZE], uint8_t padding, uint8_t result[BLOCK_SIZE]);
 
-void get_padded_key(uint8_t padding, uint8_t result[BLOCK_SIZE]) {
+static void get_padded_key(const uint8_t key[KEY_SIZE], uint8_t padding, uint8_t result[BLOCK_SIZE]) {
     uint32_t i = 0;
-    for (; i < sizeof(SECRET_KEY); i++) {
-        result[i] = SECRET_KEY[i] ^ padding;
+    for (; i < KEY_SIZE; i++) {
+        result[i] = key[i] ^ padding;
     }
     for (; i < BLOCK_SIZE; i++) {
         result[i] = padding;
     }
 }
 
-void hmac(const uint8_t *data, uint32_t len, uint8_t result[32])
-{
-    uint8_t key_padded[64];
-
-    // calculate the inner hash
-    get_padded_key(IPAD, key_padded);
+void HMACContext::set_key(const uint8_t key[KEY_SIZE]) {
+    uint8_t key_padded[BLOCK_SIZE];
     SHA256 hash;
+
+    // the inner hash always starts with the ipad block
+    get_padded_key(key, IPAD, key_padded);
     hash.update(key_padded, sizeof(key_padded));
+    hash.export_state(this->inner_state);
+    hash.reset();
+
+    // the outer hash always starts with the opad block
+    get_padded_key(key, OPAD, key_padded);
+    hash.update(key_padded, sizeof(key_padded));
+    hash.export_state(this->outer_state);
+}
+
+void HMACContext::calculate(const uint8_t *data, uint32_t len, uint8_t result[32]) const {
+    SHA256 hash;
+    this->start(hash);
     hash.update(data, len);
+    this->finish(hash, result);
+}
+
+void HMACContext::start(SHA256 &hash) const {
+    hash.import_state(this->inner_state);
+}
+
+void HMACContext::finish(SHA256 &hash, uint8_t result[32]) const {
+    // calculate the inner hash
     hash.calculate_digest(result);
-    hash.reset();
 
     // calculate the outer hash
-    get_padded_key(OPAD, key_padded);
-    hash.update(key_padded, sizeof(key_padded));
+    hash.import_state(this->outer_state);
     hash.update(result, 32);
     hash.calculate_digest(result);
 }
+
+void hmac(const uint8_t *data, uint32_t len, uint8_t result[32])
+{
+    HMACContext context(SECRET_KEY);
+    context.calculate(data, len, result);
+}
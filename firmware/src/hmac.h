@@ -6,6 +6,37 @@
 #error "this header file cannot be included in C mode"
 #endif
 
+#include "sha256.h"
+
 #define HMAC_SIZE 16
 
-void hmac(const uint8_t *data, uint32_t len, uint8_t result[32]);
\ No newline at end of file
+/**
+ * HMAC-SHA256 with a fixed key.
+ * The hash states after the inner and outer padded key blocks are
+ * precomputed in set_key(), so calculate() only needs to hash the data.
+ */
+class HMACContext {
+public:
+    HMACContext() = default;
+    inline HMACContext(const uint8_t key[32]) { this->set_key(key); }
+
+    /** must be called again whenever the key changes */
+    void set_key(const uint8_t key[32]);
+
+    void calculate(const uint8_t *data, uint32_t len, uint8_t result[32]) const;
+
+    /**
+     * For calculating the HMAC incrementally:
+     * start() prepares hash, then the data is fed to hash.update(),
+     * then finish() calculates the result.
+     */
+    void start(SHA256 &hash) const;
+    void finish(SHA256 &hash, uint8_t result[32]) const;
+
+private:
+    SHA256State inner_state;
+    SHA256State outer_state;
+};
+
+/** calculates the HMAC with SECRET_KEY, without a cached context. */
+void hmac(const uint8_t *data, uint32_t len, uint8_t result[32]);
@@ -9,6 +9,18 @@ void add_systick_callback(callback_type cb);
 
 void on_systick();
 
+/** to be called from the TIM3 interrupt handler; implemented in motor.cpp */
+void on_step_timer();
+
+/** to be called from the TIM2 interrupt handler; implemented in beeper.cpp */
+void on_beeper_timer();
+
+/** to be called from the TIM1 capture/compare interrupt handler; implemented in dcf77.cpp */
+void on_dcf77_capture();
+
+/** to be called from the DMA1 channel 1 interrupt handler; implemented in motor_current.cpp */
+void on_motor_current_dma();
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
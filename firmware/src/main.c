@@ -181,13 +181,12 @@ static void MX_USART1_UART_Init(void)
   }
   /* USER CODE BEGIN USART1_Init 2 */
 
-  huart1.Instance->CR1 |= (
-    USART_CR1_RXNEIE |
-    USART_CR1_TCIE
-  );
   HAL_NVIC_SetPriority(USART1_IRQn, 4, 0);
   HAL_NVIC_EnableIRQ(USART1_IRQn);
 
+  uart_rx_dma_start();
+  uart_tx_dma_start();
+
   /* USER CODE END USART1_Init 2 */
 
 }
@@ -0,0 +1,43 @@
+#include "message_format.h"
+
+#include "deserialize.h"
+
+using namespace message_format;
+
+bool message_parse(const uint8_t *data, uint32_t size, MessageHeader &header) {
+    // both formats need at least one payload byte, or the version byte
+    if (size <= HMAC_SIZE + HEADER_SIZE_V2) { return false; }
+    const uint8_t *signed_data = data + HMAC_SIZE;
+
+    header.version = signed_data[7];
+    if (header.version == 0) {
+        if (size <= HMAC_SIZE + HEADER_SIZE_V1) { return false; }
+        header.version = 1;
+        header.valid_from = deserialize_u64(signed_data);
+        header.valid_until = deserialize_u64(signed_data + 8);
+        header.type = signed_data[16];
+        header.payload = signed_data + HEADER_SIZE_V1;
+        header.payload_size = size - HMAC_SIZE - HEADER_SIZE_V1;
+        return true;
+    }
+
+    if (header.version == 1) {
+        // the legacy format says 0 here, and the compact one 2 or more
+        header.version = VERSION_UNKNOWN;
+        header.valid_from = 0;
+        header.valid_until = 0;
+        header.type = 0;
+        header.payload = signed_data + HEADER_SIZE_V2;
+        header.payload_size = size - HMAC_SIZE - HEADER_SIZE_V2;
+        return true;
+    }
+
+    uint32_t duration_s = 60 * static_cast<uint32_t>(signed_data[4] | (signed_data[5] << 8));
+    if (duration_s == 0) { return false; }
+    header.valid_from = EPOCH_V2 + deserialize_u32(signed_data);
+    header.valid_until = header.valid_from + duration_s - 1;
+    header.type = signed_data[6];
+    header.payload = signed_data + HEADER_SIZE_V2;
+    header.payload_size = size - HMAC_SIZE - HEADER_SIZE_V2;
+    return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+#include "hmac.h"
+
+/**
+ * The signed header of a message, in either format.
+ *
+ * Version 1, the legacy format, after the HMAC signature:
+ *
+ *    uint64_t  valid_from      (UNIX time)
+ *    uint64_t  valid_until     (UNIX time, inclusive)
+ *    uint8_t   type
+ *    uint8_t   payload[]
+ *
+ * Version 2, the compact format:
+ *
+ *    uint32_t  valid_from      (seconds since 2020-01-01 00:00 UTC)
+ *    uint16_t  duration        (minutes)
+ *    uint8_t   type
+ *    uint8_t   version         (2)
+ *    uint8_t   payload[]
+ *
+ * Byte 7 of the signed part tells them apart: in version 1, it is the
+ * top byte of valid_from, which is 0 for any time before 2106.
+ */
+struct MessageHeader {
+    uint8_t version;
+    uint64_t valid_from;
+    uint64_t valid_until;
+    uint8_t type;
+    const uint8_t *payload;
+    uint32_t payload_size;
+};
+
+namespace message_format {
+
+// the UNIX time of 2020-01-01 00:00 UTC
+static constexpr uint64_t EPOCH_V2 = 1577836800;
+
+static constexpr uint32_t HEADER_SIZE_V1 = 17;
+static constexpr uint32_t HEADER_SIZE_V2 = 8;
+
+// the version of a message whose byte 7 is 1, which is neither format
+static constexpr uint8_t VERSION_UNKNOWN = 0;
+
+}  // namespace message_format
+
+/**
+ * Reads the header of a base64-decoded message, which must be longer
+ * than the HMAC signature and the header. False if it is too small or
+ * has no duration. Versions after 2 are read in the compact layout; the
+ * caller must reject them, and VERSION_UNKNOWN, which has no layout.
+ */
+bool message_parse(const uint8_t *data, uint32_t size, MessageHeader &header);
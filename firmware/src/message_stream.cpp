@@ -0,0 +1,49 @@
+#include "message_stream.h"
+
+void MessageStream::reset() {
+    // QR scanners and web clients may produce the URL-safe variant.
+    base64_stream_reset(&this->decoder, BASE64_ANY);
+    this->hmac_context.start(this->hash);
+    this->size = 0;
+    this->error = false;
+}
+
+void MessageStream::feed(uint8_t c) {
+    uint8_t decoded[3];
+    this->add(decoded, base64_stream_feed(&this->decoder, c, decoded));
+}
+
+uint32_t MessageStream::finish(uint8_t digest[32]) {
+    uint8_t decoded[3];
+    this->add(decoded, base64_stream_finish(&this->decoder, decoded));
+
+    this->hmac_context.finish(this->hash, digest);
+
+    if (this->error) { return 0; }
+    return this->size;
+}
+
+void MessageStream::add(const uint8_t *data, int32_t count) {
+    if (this->error) { return; }
+    if (count < 0) {
+        // invalid base64
+        this->error = true;
+        return;
+    }
+    if (this->size + count > this->buf.size()) {
+        // can't happen for messages from UARTRxBuffer
+        this->error = true;
+        return;
+    }
+
+    uint32_t start = this->size;
+    for (int32_t i = 0; i < count; i++) {
+        this->buf[this->size++] = data[i];
+    }
+
+    // the HMAC signature itself is not part of the signed data
+    if (start < HMAC_SIZE) {
+        start = (this->size < HMAC_SIZE) ? this->size : HMAC_SIZE;
+    }
+    this->hash.update(&this->buf[start], this->size - start);
+}
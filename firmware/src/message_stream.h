@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "base64.h"
+#include "hmac.h"
+#include "sha256.h"
+
+/**
+ * Decodes a base64-encoded message and calculates its HMAC while it is
+ * being received, so only the last HMAC block and the outer hash remain
+ * to be calculated once the message is complete.
+ *
+ * The HMAC covers everything after the first HMAC_SIZE decoded bytes,
+ * just like in the message format that is described in cpp_main.cpp.
+ */
+class MessageStream {
+public:
+    inline MessageStream(const HMACContext &hmac_context)
+        :
+        hmac_context{hmac_context}
+    {
+        this->reset();
+    }
+
+    /** starts a new message */
+    void reset();
+
+    /** feeds one base64 character */
+    void feed(uint8_t c);
+
+    /**
+     * Completes the message and calculates the HMAC digest.
+     * Returns the decoded size, or 0 if the input was invalid.
+     */
+    uint32_t finish(uint8_t digest[32]);
+
+    /** the decoded message */
+    inline const uint8_t *data() const { return this->buf.data(); }
+
+private:
+    const HMACContext &hmac_context;
+
+    struct base64_stream decoder;
+    SHA256 hash;
+    // 256 base64 characters decode to at most 192 bytes
+    std::array<uint8_t, 192> buf;
+    uint32_t size;
+    bool error;
+
+    void add(const uint8_t *data, int32_t count);
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Extends a free-running 16-bit us counter to 64 bits, without a lock.
+ *
+ * update() anchors a 64-bit time to a counter value. It must be called
+ * at least every 65 ms, from an interrupt that can't be interrupted by
+ * any caller of now(); on the target, this is SysTick, which has the
+ * highest priority.
+ *
+ * now() may be called from any context. It reads the anchor and the
+ * counter between two reads of a sequence number, which update()
+ * increments before and after it changes the anchor; if update() ran
+ * in between, the read is repeated.
+ *
+ * Counter::read() returns the counter value.
+ */
+template <typename Counter>
+class MonotonicClock {
+public:
+    void update() {
+        uint16_t counter = Counter::read();
+        uint32_t sequence = this->sequence.load(std::memory_order_relaxed);
+        this->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_signal_fence(std::memory_order_release);
+
+        this->anchor_time += static_cast<uint16_t>(counter - this->anchor_counter);
+        this->anchor_counter = counter;
+
+        std::atomic_signal_fence(std::memory_order_release);
+        this->sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    uint64_t now() const {
+        while (true) {
+            uint32_t sequence = this->sequence.load(std::memory_order_acquire);
+            std::atomic_signal_fence(std::memory_order_acquire);
+
+            uint64_t time = this->anchor_time;
+            uint16_t anchor_counter = this->anchor_counter;
+            uint16_t counter = Counter::read();
+
+            std::atomic_signal_fence(std::memory_order_acquire);
+            if (this->sequence.load(std::memory_order_acquire) == sequence && !(sequence & 1)) {
+                return time + static_cast<uint16_t>(counter - anchor_counter);
+            }
+        }
+    }
+
+    /** how often the anchor has been updated */
+    inline uint32_t updates() const { return this->sequence.load(std::memory_order_relaxed) / 2; }
+
+private:
+    std::atomic<uint32_t> sequence{0};
+    volatile uint64_t anchor_time = 0;
+    volatile uint16_t anchor_counter = 0;
+};
@@ -1,6 +1,15 @@
 #include "motor.h"
 
-#include "time.h"
+#include "hardware.h"
+#include "interrupts.h"
+#include "motor_ramp.h"
+#include "units.h"
+
+#if MOTOR_CURRENT_SENSE
+#include "motor_current.h"
+#endif
+
+static StepperMotor *step_timer_motor = nullptr;
 
 StepperMotor::StepperMotor(
     OutputPin pin_step,
@@ -16,15 +25,47 @@ StepperMotor::StepperMotor(
     pins_modesel{pins_modesel},
     pin_clockwise_end{pin_clockwise_end},
     pin_counterclockwise_end{pin_counterclockwise_end},
-    current_mode{0}
+    // valid until set_mode() is called
+    endstop_pin{&this->pin_clockwise_end},
+    current_mode{0},
+    microsteps_per_step{1},
+    mode_index{0}
 {
     this->pin_step.low();
     this->pin_sleep.low();
+
+    step_timer_motor = this;
+
+    // TIM3 counts us; each update event starts a step pulse, which ends
+    // at the compare event of channel 1.
+    __HAL_RCC_TIM3_CLK_ENABLE();
+    TIM3->CR1 = TIM_CR1_ARPE | TIM_CR1_URS;
+    TIM3->PSC = (SystemCoreClock / 1000000) - 1;
+    TIM3->CCR1 = this->pin_hold_time_us;
+    TIM3->DIER = TIM_DIER_UIE | TIM_DIER_CC1IE;
+
+    // the step timing is more important than everything but SysTick
+    HAL_NVIC_SetPriority(TIM3_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(TIM3_IRQn);
+
+#if MOTOR_CURRENT_SENSE
+    motor_current_init();
+#endif
 }
 
 StepperMotor::~StepperMotor()
 {
+    this->stop();
     this->pin_sleep.low();
+    step_timer_motor = nullptr;
+}
+
+void StepperMotor::stop()
+{
+    TIM3->CR1 &= ~TIM_CR1_CEN;
+    TIM3->SR = 0;
+    this->pin_step.low();
+    this->rotating = false;
 }
 
 void StepperMotor::microstep_modesel(uint8_t microstep_mode)
@@ -36,6 +77,8 @@ void StepperMotor::microstep_modesel(uint8_t microstep_mode)
 
 void StepperMotor::set_mode(int8_t mode)
 {
+    this->stop();
+
     if (mode == 0) {
         this->current_mode = 0;
         this->pin_sleep.low();
@@ -45,7 +88,7 @@ void StepperMotor::set_mode(int8_t mode)
     if (current_mode == 0) {
         // leave sleep mode
         this->pin_sleep.high();
-        sleep_us(this->sleep_wakeup_time_us);
+        this->ready_time = time_get_64() + this->sleep_wakeup_time_us;
     }
 
     if (mode < 0) {
@@ -60,55 +103,108 @@ void StepperMotor::set_mode(int8_t mode)
     this->microsteps_per_step = mode;
 
     switch (mode) {
-    case 1:  this->microstep_modesel(0); break;
-    case 2:  this->microstep_modesel(1); break;
-    case 4:  this->microstep_modesel(2); break;
-    case 8:  this->microstep_modesel(3); break;
-    case 16: this->microstep_modesel(4); break;
-    case 32: this->microstep_modesel(5); break;
-    default: this->microstep_modesel(0); this->microsteps_per_step = 1; break; // you suck
+    case 1:  this->mode_index = 0; break;
+    case 2:  this->mode_index = 1; break;
+    case 4:  this->mode_index = 2; break;
+    case 8:  this->mode_index = 3; break;
+    case 16: this->mode_index = 4; break;
+    case 32: this->mode_index = 5; break;
+    default: this->mode_index = 0; this->microsteps_per_step = 1; break; // you suck
     }
+    this->microstep_modesel(this->mode_index);
 }
 
 void StepperMotor::rotate(uint32_t urevs, uint32_t urev_per_second) {
-    uint32_t microsteps = (
-        static_cast<uint64_t>(
-            static_cast<uint64_t>(this->microsteps_per_step)
-            *
-            static_cast<uint64_t>(urevs)
-        )
-        /
-        static_cast<uint64_t>(this->urev_per_step)
-    );
+    // the driver is asleep
+    if (this->current_mode == 0) { return; }
+
+    uint32_t microsteps = units::urevs_to_microsteps(urevs, this->mode_index);
 
     if (microsteps == 0) { return; }
 
-    uint32_t microstep_period_us = (
-        static_cast<uint64_t>(
-            static_cast<uint64_t>(1000000)
-            *
-            static_cast<uint64_t>(this->urev_per_step)
-        )
-        /
-        static_cast<uint64_t>(
-            static_cast<uint64_t>(this->microsteps_per_step)
-            *
-            static_cast<uint64_t>(urev_per_second)
-        )
-    );
-
-    if (microstep_period_us < 1) { microstep_period_us = 1; }
-
-    Period period_timer(microstep_period_us);
-
-    while (!this->endstop_pin->get())
-    {
-        this->pin_step.high();
-        sleep_us(this->pin_hold_time_us);
-        this->pin_step.low();
-        sleep_us(this->pin_hold_time_us);
-
-        if (--microsteps == 0) { return; }
-        period_timer.wait_next();
+    uint64_t microstep_period_us = units::microstep_period_us(urev_per_second, this->mode_index);
+
+    // the step pulse must end before the next one starts, and ARR must
+    // hold the period; the ramp periods are shorter than that
+    if (microstep_period_us < 2 * this->pin_hold_time_us) {
+        microstep_period_us = 2 * this->pin_hold_time_us;
     }
-}
\ No newline at end of file
+    if (microstep_period_us > this->max_period_us) {
+        microstep_period_us = this->max_period_us;
+    }
+
+    this->stop();
+    this->step_index = 0;
+    this->step_count = microsteps;
+    this->min_period_us = static_cast<uint32_t>(microstep_period_us);
+    this->end_reached = false;
+    this->rotating = true;
+
+#if MOTOR_CURRENT_SENSE
+    motor_current_start();
+#endif
+
+    // the first step is made once the driver has left sleep mode
+    uint64_t now = time_get_64();
+    uint32_t delay_us = 2;
+    if (this->ready_time > now + delay_us) {
+        delay_us = static_cast<uint32_t>(this->ready_time - now);
+    }
+    if (delay_us > this->max_period_us) { delay_us = this->max_period_us; }
+
+    // ARR is preloaded, i.e. a new value takes effect with the next update
+    // event. the UG event loads the delay, and the period from the first
+    // to the second step follows it.
+    TIM3->CNT = 0;
+    TIM3->ARR = delay_us - 1;
+    TIM3->EGR = TIM_EGR_UG;
+    TIM3->ARR = this->gap_period_us(0) - 1;
+    TIM3->CR1 |= TIM_CR1_CEN;
+}
+
+uint32_t StepperMotor::gap_period_us(uint32_t gap) const {
+    // there are step_count - 1 gaps between the steps
+    if (gap + 1 >= this->step_count) { return this->min_period_us; }
+    return motor_ramp::step_period_us(gap, this->step_count - 1, this->min_period_us, this->mode_index);
+}
+
+void StepperMotor::timer_update() {
+    if (this->step_index >= this->step_count) {
+        this->stop();
+        return;
+    }
+
+    if (this->endstop_pin->get()) {
+        this->end_reached = true;
+        this->stop();
+        return;
+    }
+
+#if MOTOR_CURRENT_SENSE
+    // the bolt has hit the mechanical stop before the end switch
+    if (motor_current_stalled()) {
+        this->end_reached = true;
+        this->stop();
+        return;
+    }
+#endif
+
+    this->pin_step.high();
+    this->step_index += 1;
+
+    // the period that follows the next step
+    TIM3->ARR = this->gap_period_us(this->step_index) - 1;
+}
+
+void StepperMotor::timer_compare() {
+    this->pin_step.low();
+}
+
+void on_step_timer() {
+    uint32_t sr = TIM3->SR;
+    TIM3->SR = ~sr;
+
+    if (step_timer_motor == nullptr) { return; }
+    if (sr & TIM_SR_UIF) { step_timer_motor->timer_update(); }
+    if (sr & TIM_SR_CC1IF) { step_timer_motor->timer_compare(); }
+}
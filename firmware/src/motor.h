@@ -4,11 +4,19 @@
 #include <cmath>
 
 #include "pin.h"
+#include "units.h"
 
 #ifndef __cplusplus
 #error lolnope
 #endif
 
+/**
+ * Drives the stepper motor without blocking; the steps are made by the
+ * TIM3 interrupt handler, on_step_timer(), with the acceleration and
+ * deceleration ramps from motor_ramp.h.
+ *
+ * Only one StepperMotor may exist.
+ */
 class StepperMotor {
 public:
     StepperMotor(
@@ -22,13 +30,45 @@ public:
 
     ~StepperMotor();
 
-    static constexpr uint32_t urev_per_step = (uint32_t)(1000000 / 200);
+    static constexpr uint32_t urev_per_step = units::UREV_PER_STEP;
     static constexpr uint32_t sleep_wakeup_time_us = 1700;
     static constexpr uint32_t pin_hold_time_us = 2;
+    // the longest period that the 16-bit TIM3->ARR can hold
+    static constexpr uint32_t max_period_us = 0x10000;
 
+    /**
+     * Sets the direction and microstep mode, or enters sleep mode if
+     * mode is 0. Stops the current rotation.
+     */
     void set_mode(int8_t mode);
+
+    /**
+     * Starts rotating in the current mode; returns immediately.
+     * urev_per_second is the cruise speed, which is reached if the
+     * rotation is long enough, but no slower than one microstep per
+     * max_period_us. The rotation stops early at the end switch.
+     * Does nothing in sleep mode.
+     */
     void rotate(uint32_t urevs, uint32_t urev_per_second);
 
+    /** true while rotating */
+    inline bool busy() const { return this->rotating; }
+
+    /** the number of microsteps made by the last rotation */
+    inline uint32_t steps_done() const { return this->step_index; }
+
+    /** true if the last rotation was stopped at the end switch */
+    inline bool at_end() const { return this->end_reached; }
+
+    /** the length of a number of microsteps in the current mode */
+    inline uint32_t steps_to_urevs(uint32_t microsteps) const {
+        return units::microsteps_to_urevs(microsteps, this->mode_index);
+    }
+
+    /** called by the timer interrupt handler */
+    void timer_update();
+    void timer_compare();
+
 private:
     OutputPin pin_step;
     OutputPin pin_sleep;
@@ -37,11 +77,25 @@ private:
     InputPin pin_clockwise_end;
     InputPin pin_counterclockwise_end;
 
-    InputPin *endstop_pin = nullptr;
+    InputPin *endstop_pin;
 
     void microstep_modesel(uint8_t microstep_mode);
+    void stop();
+    uint32_t gap_period_us(uint32_t gap) const;
 
     int8_t current_mode;
 
     uint8_t microsteps_per_step;
+    // log2(microsteps_per_step)
+    uint8_t mode_index;
+
+    // no steps may be made before this time, after leaving sleep mode
+    uint64_t ready_time = 0;
+
+    // the rotation, used by the timer interrupt handler
+    volatile bool rotating = false;
+    volatile bool end_reached = false;
+    uint32_t step_index;
+    uint32_t step_count;
+    uint32_t min_period_us;
 };
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "motor_current.h"
+
+#include <array>
+
+#include "hardware.h"
+#include "interrupts.h"
+#include "stall_detector.h"
+
+// at an ADC clock of 12 MHz and a sample time of 239.5 cycles, a
+// conversion takes 21 us, so each half of the buffer takes 1.008 ms.
+static std::array<uint16_t, 2 * 48> adc_buf;
+static StallDetector stall_detector;
+
+void motor_current_init() {
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+    GPIO_InitTypeDef gpio = {0};
+    gpio.Pin = GPIO_PIN_7;
+    gpio.Mode = GPIO_MODE_ANALOG;
+    HAL_GPIO_Init(GPIOA, &gpio);
+
+    __HAL_RCC_ADC_CONFIG(RCC_ADCPCLK2_DIV6);
+    __HAL_RCC_ADC1_CLK_ENABLE();
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    // ADC1 is on DMA1 channel 1
+    DMA1_Channel1->CCR = 0;
+    DMA1_Channel1->CPAR = reinterpret_cast<uint32_t>(&ADC1->DR);
+    DMA1_Channel1->CMAR = reinterpret_cast<uint32_t>(adc_buf.data());
+    DMA1_Channel1->CNDTR = adc_buf.size();
+    DMA1_Channel1->CCR = (
+        DMA_CCR_MINC |
+        DMA_CCR_CIRC |
+        DMA_CCR_PSIZE_0 |
+        DMA_CCR_MSIZE_0 |
+        DMA_CCR_HTIE |
+        DMA_CCR_TCIE |
+        DMA_CCR_EN
+    );
+    HAL_NVIC_SetPriority(DMA1_Channel1_IRQn, 2, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+
+    // channel 7, 239.5 cycles sample time, continuous conversion
+    ADC1->SMPR2 = 7 << ADC_SMPR2_SMP7_Pos;
+    ADC1->SQR1 = 0;
+    ADC1->SQR3 = 7;
+    ADC1->CR2 = ADC_CR2_ADON;
+    // the ADC needs 1 us to power up before it can be calibrated
+    uint16_t start = time_get_16();
+    while (static_cast<uint16_t>(time_get_16() - start) < 2) {}
+    ADC1->CR2 |= ADC_CR2_RSTCAL;
+    while (ADC1->CR2 & ADC_CR2_RSTCAL) {}
+    ADC1->CR2 |= ADC_CR2_CAL;
+    while (ADC1->CR2 & ADC_CR2_CAL) {}
+
+    ADC1->CR2 |= ADC_CR2_CONT | ADC_CR2_DMA | ADC_CR2_EXTSEL | ADC_CR2_EXTTRIG;
+    ADC1->CR2 |= ADC_CR2_SWSTART;
+}
+
+void motor_current_start() {
+    CriticalSectionLock lk;
+    stall_detector.reset();
+}
+
+bool motor_current_stalled() {
+    return stall_detector.stalled();
+}
+
+int16_t motor_current_ma() {
+    return stall_detector.filtered_ma();
+}
+
+void on_motor_current_dma() {
+    uint32_t isr = DMA1->ISR;
+    DMA1->IFCR = DMA_IFCR_CHTIF1 | DMA_IFCR_CTCIF1 | DMA_IFCR_CGIF1;
+
+    const uint32_t half = adc_buf.size() / 2;
+    const uint16_t *samples = (isr & DMA_ISR_TCIF1) ? &adc_buf[half] : &adc_buf[0];
+
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < half; i++) { sum += samples[i]; }
+
+    // 3.3 V full scale, 1 V/A
+    int16_t current_ma = static_cast<int16_t>((sum * 3300) / (4096 * half));
+    stall_detector.process(&current_ma, 1);
+}
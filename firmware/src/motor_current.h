@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Continuous motor current measurement on PA7 (ADC1 channel 7), for an
+ * INA240A1 with a 50 mOhm shunt, i.e. 1 V/A, as on the debug adapter.
+ *
+ * ADC1 samples continuously into a circular DMA buffer. Each half of the
+ * buffer is averaged into one sample of about 1 kHz, which is passed to
+ * a StallDetector.
+ */
+
+/** sets up the ADC and the DMA channel, and starts sampling */
+void motor_current_init();
+
+/** resets the stall detection; to be called when the motor starts moving */
+void motor_current_start();
+
+/** true once the mechanical stop has been detected since the start */
+bool motor_current_stalled();
+
+/** the filtered motor current in mA */
+int16_t motor_current_ma();
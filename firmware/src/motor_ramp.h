@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Acceleration ramp for the stepper motor, computed at compile time.
+ *
+ * For a constant acceleration of a microsteps/s^2 from standstill,
+ * microstep k is made at t_k = sqrt(2 k / a), so the period between
+ * microstep k and k + 1 is
+ *
+ *   c_k = sqrt(2 / a) * (sqrt(k + 1) - sqrt(k))
+ *
+ * The table holds c_k for an acceleration of RAMP_ACCELERATION full
+ * steps/s^2 in full-step mode. In microstep mode m, the acceleration in
+ * microsteps/s^2 is m times as high, which divides all periods by
+ * sqrt(m); see RAMP_MODE_SCALE.
+ */
+namespace motor_ramp {
+
+/** the acceleration, in full steps/s^2 */
+constexpr double RAMP_ACCELERATION = 16000;
+/** the number of microsteps with a table entry; the ramp ends after that */
+constexpr uint32_t RAMP_LENGTH = 512;
+
+constexpr double sqrt(double x) {
+    if (x <= 0) { return 0; }
+    double result = x > 1 ? x : 1;
+    // Newton's method converges quadratically from above
+    for (uint32_t i = 0; i < 64; i++) {
+        result = (result + x / result) / 2;
+    }
+    return result;
+}
+
+struct RampTable {
+    uint16_t period_us[RAMP_LENGTH];
+};
+
+constexpr RampTable make_ramp_table(double acceleration) {
+    RampTable result{};
+    for (uint32_t k = 0; k < RAMP_LENGTH; k++) {
+        double period_s = sqrt(2 / acceleration) * (sqrt(k + 1) - sqrt(k));
+        result.period_us[k] = static_cast<uint16_t>(period_s * 1e6 + 0.5);
+    }
+    return result;
+}
+
+constexpr RampTable RAMP = make_ramp_table(RAMP_ACCELERATION);
+
+/** 65536 / sqrt(m) for microstep mode m = 1 << index */
+struct ModeScale {
+    uint32_t scale[6];
+};
+
+constexpr ModeScale make_mode_scale() {
+    ModeScale result{};
+    for (uint32_t i = 0; i < 6; i++) {
+        result.scale[i] = static_cast<uint32_t>(65536 / sqrt(1 << i) + 0.5);
+    }
+    return result;
+}
+
+constexpr ModeScale RAMP_MODE_SCALE = make_mode_scale();
+
+static_assert(RAMP.period_us[0] == 11180, "sqrt(2 / 16000) s");
+static_assert(RAMP_MODE_SCALE.scale[0] == 65536, "1 / sqrt(1)");
+static_assert(RAMP_MODE_SCALE.scale[2] == 32768, "1 / sqrt(4)");
+
+/**
+ * The period in us between microstep 'index' and the next one, in a
+ * sequence of 'count' such periods, which accelerates along the ramp,
+ * cruises at no less than min_period_us and decelerates along the ramp
+ * at the end. mode_index is log2 of the microstep mode.
+ */
+inline uint32_t step_period_us(
+    uint32_t index, uint32_t count, uint32_t min_period_us, uint32_t mode_index
+) {
+    // the distance to the nearer end of the rotation
+    uint32_t k = count - 1 - index;
+    if (index < k) { k = index; }
+    if (k >= RAMP_LENGTH) { k = RAMP_LENGTH - 1; }
+
+    uint32_t period_us = (RAMP.period_us[k] * RAMP_MODE_SCALE.scale[mode_index]) >> 16;
+    return (period_us > min_period_us) ? period_us : min_period_us;
+}
+
+}
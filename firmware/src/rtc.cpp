@@ -0,0 +1,76 @@
+#include "rtc.h"
+
+#include "stm32f1xx_hal.h"
+
+static bool running = false;
+
+/** waits until the last write to the RTC registers has been done */
+static void rtc_wait_write() {
+    while (!(RTC->CRL & RTC_CRL_RTOFF)) {}
+}
+
+bool rtc_init() {
+    RCC->APB1ENR |= RCC_APB1ENR_PWREN | RCC_APB1ENR_BKPEN;
+    (void)RCC->APB1ENR;
+    // the backup domain is write protected after reset
+    PWR->CR |= PWR_CR_DBP;
+
+    if (RCC->BDCR & RCC_BDCR_RTCEN) {
+        // after a reset, the RTC registers may only be read once they
+        // have been synchronized to the APB1 clock
+        RTC->CRL &= ~RTC_CRL_RSF;
+        while (!(RTC->CRL & RTC_CRL_RSF)) {}
+        running = true;
+        return true;
+    }
+
+    RCC->BDCR |= RCC_BDCR_LSEON;
+    return false;
+}
+
+bool rtc_start() {
+    if (running) { return true; }
+    if (!(RCC->BDCR & RCC_BDCR_LSERDY)) { return false; }
+
+    RCC->BDCR |= RCC_BDCR_RTCSEL_LSE;
+    RCC->BDCR |= RCC_BDCR_RTCEN;
+
+    // the counter counts seconds; the prescaler divider has the ticks
+    rtc_wait_write();
+    RTC->CRL |= RTC_CRL_CNF;
+    RTC->PRLH = 0;
+    RTC->PRLL = time_backup::TICKS_PER_SECOND - 1;
+    RTC->CNTH = 0;
+    RTC->CNTL = 0;
+    RTC->CRL &= ~RTC_CRL_CNF;
+    rtc_wait_write();
+
+    running = true;
+    return true;
+}
+
+uint64_t rtc_get_ticks() {
+    uint32_t seconds, divider;
+    // the counter may have moved on while the divider was read
+    do {
+        seconds = (RTC->CNTH << 16) | RTC->CNTL;
+        divider = ((RTC->DIVH & 0xf) << 16) | RTC->DIVL;
+    } while (seconds != ((RTC->CNTH << 16) | RTC->CNTL));
+
+    // the divider counts down to 0 within each second
+    return static_cast<uint64_t>(seconds) * time_backup::TICKS_PER_SECOND + (time_backup::TICKS_PER_SECOND - 1 - divider);
+}
+
+void rtc_read_backup(uint16_t registers[time_backup::REGISTER_COUNT]) {
+    const volatile uint32_t *data = &BKP->DR1;
+    for (uint32_t i = 0; i < time_backup::REGISTER_COUNT; i++) {
+        registers[i] = static_cast<uint16_t>(data[i]);
+    }
+}
+
+void rtc_write_backup(const uint16_t registers[time_backup::REGISTER_COUNT]) {
+    volatile uint32_t *data = &BKP->DR1;
+    for (uint32_t i = 0; i < time_backup::REGISTER_COUNT; i++) {
+        data[i] = registers[i];
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+#include "time_backup.h"
+
+/**
+ * Enables the backup domain, and starts the LSE crystal unless the RTC
+ * kept running through the reset. Returns true if it did; the backup
+ * registers may then hold a time.
+ */
+bool rtc_init();
+
+/**
+ * Starts the RTC once the crystal has started, which takes up to a few
+ * seconds after a power loss. Returns true if the RTC is running.
+ */
+bool rtc_start();
+
+/** the RTC count, in ticks of 1/32768 s; the RTC must be running */
+uint64_t rtc_get_ticks();
+
+void rtc_read_backup(uint16_t registers[time_backup::REGISTER_COUNT]);
+void rtc_write_backup(const uint16_t registers[time_backup::REGISTER_COUNT]);
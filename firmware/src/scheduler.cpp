@@ -0,0 +1,36 @@
+#include "scheduler.h"
+
+bool Scheduler::add(Task &task) {
+    if (this->task_count >= this->tasks.size()) { return false; }
+
+    this->tasks[this->task_count++] = &task;
+    return true;
+}
+
+uint64_t Scheduler::run_due(uint64_t now) {
+    // bit i is set once tasks[i] has run
+    uint32_t done = 0;
+
+    while (1) {
+        int32_t earliest = -1;
+        uint64_t earliest_deadline = Task::NEVER;
+        for (uint32_t i = 0; i < this->task_count; i++) {
+            if (done & (1u << i)) { continue; }
+            if (this->tasks[i]->deadline < earliest_deadline) {
+                earliest = i;
+                earliest_deadline = this->tasks[i]->deadline;
+            }
+        }
+
+        if (earliest < 0 || earliest_deadline > now) { break; }
+
+        done |= (1u << earliest);
+        this->tasks[earliest]->run(now);
+    }
+
+    uint64_t next = Task::NEVER;
+    for (uint32_t i = 0; i < this->task_count; i++) {
+        if (this->tasks[i]->deadline < next) { next = this->tasks[i]->deadline; }
+    }
+    return next;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/**
+ * A resumable state machine which is run by the Scheduler.
+ *
+ * run() must return quickly; instead of waiting, it sets deadline to the
+ * time at which it wants to be run next.
+ */
+class Task {
+public:
+    static constexpr uint64_t NEVER = UINT64_MAX;
+
+    /** the time in us since boot at which the task wants to run */
+    uint64_t deadline = NEVER;
+
+    /** does the next step; now is the current time in us since boot */
+    virtual void run(uint64_t now) = 0;
+
+protected:
+    ~Task() = default;
+};
+
+/**
+ * Cooperative scheduler: runs the due tasks, earliest deadline first.
+ */
+class Scheduler {
+public:
+    /** returns false if there are too many tasks */
+    bool add(Task &task);
+
+    /**
+     * Runs each task whose deadline is <= now once, earliest deadline
+     * first. Returns the earliest deadline afterwards.
+     */
+    uint64_t run_due(uint64_t now);
+
+private:
+    std::array<Task *, 8> tasks;
+    uint32_t task_count = 0;
+};
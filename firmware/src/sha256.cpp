@@ -1,5 +1,7 @@
 #include "sha256.h"
 
+#include <cstring>
+
 constexpr uint32_t rotate_left(uint32_t a, uint32_t b) {
     return (((a) << (b)) | ((a) >> (32-(b))));
 }
@@ -15,6 +17,19 @@ constexpr uint32_t rotate_right(uint32_t a, uint32_t b) {
 #define SIG0(x) (rotate_right(x,  7) ^ rotate_right(x, 18) ^ ((x) >>  3))
 #define SIG1(x) (rotate_right(x, 17) ^ rotate_right(x, 19) ^ ((x) >> 10))
 
+SHA256::SHA256() {
+    this->reset();
+}
+
+
+#if SHA256_ASM
+// hand-written Thumb-2 implementation, see sha256_m3.s
+extern "C" void sha256_transform_m3(uint32_t state[8], const uint8_t block[64]);
+
+void SHA256::transform(const uint8_t block[64]) {
+    sha256_transform_m3(this->state, block);
+}
+#else
 static const uint32_t k[64] = {
     0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
     0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
@@ -35,18 +50,13 @@ static const uint32_t k[64] = {
 };
 
 
-SHA256::SHA256() {
-    this->reset();
-}
-
+void SHA256::transform(const uint8_t block[64]) {
+    // the message schedule is expanded in place; w[i % 16] holds m[i - 16]
+    // until round i overwrites it with m[i].
+    uint32_t a, b, c, d, e, f, g, h, i, t1, t2, w[16];
 
-void SHA256::transform() {
-    uint32_t a, b, c, d, e, f, g, h, i, j, t1, t2, m[64];
-
-    for (i = 0, j = 0; i < 16; ++i, j += 4)
-        m[i] = (this->data[j] << 24) | (this->data[j + 1] << 16) | (this->data[j + 2] << 8) | (this->data[j + 3]);
-    for ( ; i < 64; ++i)
-        m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
+    for (i = 0; i < 16; ++i)
+        w[i] = (block[4 * i] << 24) | (block[4 * i + 1] << 16) | (block[4 * i + 2] << 8) | (block[4 * i + 3]);
 
     a = this->state[0];
     b = this->state[1];
@@ -58,7 +68,10 @@ void SHA256::transform() {
     h = this->state[7];
 
     for (i = 0; i < 64; ++i) {
-        t1 = h + EP1(e) + CH(e,f,g) + k[i] + m[i];
+        if (i >= 16) {
+            w[i & 15] += SIG1(w[(i - 2) & 15]) + w[(i - 7) & 15] + SIG0(w[(i - 15) & 15]);
+        }
+        t1 = h + EP1(e) + CH(e,f,g) + k[i] + w[i & 15];
         t2 = EP0(a) + MAJ(a,b,c);
         h = g;
         g = f;
@@ -79,6 +92,7 @@ void SHA256::transform() {
     this->state[6] += g;
     this->state[7] += h;
 }
+#endif
 
 void SHA256::reset() {
     this->datalen = 0;
@@ -93,17 +107,60 @@ void SHA256::reset() {
     this->state[7] = 0x5be0cd19;
 }
 
+bool SHA256::export_state(SHA256State &result) const {
+    if (this->datalen != 0) { return false; }
+
+    for (uint32_t i = 0; i < 8; i++) {
+        result.state[i] = this->state[i];
+    }
+    result.bitlen = this->bitlen;
+    return true;
+}
+
+void SHA256::import_state(const SHA256State &state) {
+    this->datalen = 0;
+    this->bitlen = state.bitlen;
+    for (uint32_t i = 0; i < 8; i++) {
+        this->state[i] = state.state[i];
+    }
+}
+
 void SHA256::update(const uint8_t *buf, uint32_t bufsize) {
-    for (uint32_t i = 0; i < bufsize; i++) {
-        this->add_byte(buf[i]);
+    // top up a partially-filled block first
+    if (this->datalen > 0) {
+        uint32_t count = 64 - this->datalen;
+        if (count > bufsize) { count = bufsize; }
+
+        std::memcpy(&this->data[this->datalen], buf, count);
+        this->datalen += count;
+        buf += count;
+        bufsize -= count;
+
+        if (this->datalen < 64) { return; }
+
+        this->transform(this->data);
+        this->bitlen += 512;
+        this->datalen = 0;
     }
+
+    // whole blocks are compressed straight from the input
+    while (bufsize >= 64) {
+        this->transform(buf);
+        this->bitlen += 512;
+        buf += 64;
+        bufsize -= 64;
+    }
+
+    // keep the remainder for later
+    std::memcpy(this->data, buf, bufsize);
+    this->datalen = bufsize;
 }
 
 void SHA256::add_byte(const uint8_t byte) {
     this->data[this->datalen++] = byte;
 
     if (this->datalen == 64) {
-        this->transform();
+        this->transform(this->data);
         this->bitlen += 512;
         this->datalen = 0;
     }
@@ -124,7 +181,7 @@ void SHA256::calculate_digest(uint8_t *digest) {
             this->data[i++] = 0x00;
         }
 
-        this->transform();
+        this->transform(this->data);
 
         for (i = 0; i < 56; i++) {
             this->data[i] = 0;
@@ -142,7 +199,7 @@ void SHA256::calculate_digest(uint8_t *digest) {
     this->data[57] = this->bitlen >> 48;
     this->data[56] = this->bitlen >> 56;
 
-    this->transform();
+    this->transform(this->data);
 
     // Since this implementation uses little endian byte ordering and SHA uses big endian,
     // reverse all the bytes when copying the final state to the output hash.
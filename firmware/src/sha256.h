@@ -2,6 +2,15 @@
 
 #include <cstdint>
 
+/**
+ * The chaining state of a SHA256 hash, taken on a block boundary.
+ * Can be used to resume hashing from a known prefix.
+ */
+struct SHA256State {
+    uint32_t state[8];
+    uint64_t bitlen;
+};
+
 class SHA256 {
 public:
     SHA256();
@@ -10,6 +19,14 @@ public:
     void update(const uint8_t *buf, uint32_t size);
     void calculate_digest(uint8_t *hash);
 
+    /**
+     * Exports the state. Only possible if a multiple of 64 bytes has been
+     * added; returns false otherwise.
+     */
+    bool export_state(SHA256State &result) const;
+    /** Resets the hash and resumes from an exported state. */
+    void import_state(const SHA256State &state);
+
 private:
     // internal state
     uint8_t data[64];
@@ -17,5 +34,5 @@ private:
     uint64_t bitlen;
     uint32_t state[8];
 
-    void transform();
+    void transform(const uint8_t block[64]);
 };
\ No newline at end of file
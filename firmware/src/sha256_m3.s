@@ -0,0 +1,158 @@
+/**
+ * SHA256 compression function for the Cortex-M3, fully unrolled.
+ *
+ * void sha256_transform_m3(uint32_t state[8], const uint8_t block[64]);
+ *
+ * This is a drop-in replacement for the C implementation of
+ * SHA256::transform() in sha256.cpp, which remains the reference.
+ * It is used if the firmware is built with SHA256_ASM=1.
+ *
+ * Register allocation:
+ *
+ *   r4-r11   the working variables a-h. Instead of shifting the values
+ *            around after each round, the register names are rotated
+ *            in the macro arguments.
+ *   r12, lr  b ^ c of the current round, and a ^ b which becomes b ^ c
+ *            of the next round. Their roles alternate every round.
+ *   r3       pointer to the round constants
+ *   r0-r2    temporaries
+ *   sp       the 16-word circular message schedule W
+ *
+ * The sigma functions use the barrel shifter, e.g.
+ *   EP1(e) = ror(e ^ ror(e, 5) ^ ror(e, 19), 6)
+ * where the final rotation is folded into the add to h.
+ */
+
+  .syntax unified
+  .thumb
+
+/* r2 = W[i] for i >= 16; stored in W if it is needed by a later round */
+.macro SCHEDULE i
+    ldr     r0, [sp, #4*(((\i)-15)&15)]
+    ldr     r2, [sp, #4*((\i)&15)]
+    ror     r1, r0, #7
+    eor     r1, r1, r0, ror #18
+    eor     r1, r1, r0, lsr #3              @ SIG0(W[i-15])
+    add     r2, r2, r1
+    ldr     r0, [sp, #4*(((\i)-2)&15)]
+    ldr     r1, [sp, #4*(((\i)-7)&15)]
+    add     r2, r2, r1
+    ror     r1, r0, #17
+    eor     r1, r1, r0, ror #19
+    eor     r1, r1, r0, lsr #10             @ SIG1(W[i-2])
+    add     r2, r2, r1
+  .if (\i) < 62
+    str     r2, [sp, #4*((\i)&15)]
+  .endif
+.endm
+
+/* one round; x must hold b ^ c, y receives a ^ b */
+.macro ROUND a, b, c, d, e, f, g, h, x, y, i
+  .if (\i) < 16
+    ldr     r2, [sp, #4*(\i)]
+  .else
+    SCHEDULE \i
+  .endif
+    ldr     r1, [r3, #4*(\i)]
+    add     \h, \h, r2                      @ h += W[i]
+    eor     r0, \e, \e, ror #5
+    add     \h, \h, r1                      @ h += K[i]
+    eor     r0, r0, \e, ror #19
+    and     r1, \e, \f
+    add     \h, \h, r0, ror #6              @ h += EP1(e)
+    bic     r2, \g, \e
+    add     \h, \h, r1
+    add     \h, \h, r2                      @ h += CH(e, f, g), h is now T1
+    eor     r0, \a, \a, ror #11
+    add     \d, \d, \h                      @ d += T1
+    eor     r0, r0, \a, ror #20
+    eor     \y, \a, \b
+    add     \h, \h, r0, ror #2              @ h += EP0(a)
+    and     r1, \x, \y
+    eor     r1, r1, \b                      @ MAJ(a, b, c) = b ^ ((a ^ b) & (b ^ c))
+    add     \h, \h, r1                      @ h is now the new a
+.endm
+
+.macro ROUNDS8 i
+    ROUND r4,  r5,  r6,  r7,  r8,  r9,  r10, r11, r12, lr,  (\i)+0
+    ROUND r11, r4,  r5,  r6,  r7,  r8,  r9,  r10, lr,  r12, (\i)+1
+    ROUND r10, r11, r4,  r5,  r6,  r7,  r8,  r9,  r12, lr,  (\i)+2
+    ROUND r9,  r10, r11, r4,  r5,  r6,  r7,  r8,  lr,  r12, (\i)+3
+    ROUND r8,  r9,  r10, r11, r4,  r5,  r6,  r7,  r12, lr,  (\i)+4
+    ROUND r7,  r8,  r9,  r10, r11, r4,  r5,  r6,  lr,  r12, (\i)+5
+    ROUND r6,  r7,  r8,  r9,  r10, r11, r4,  r5,  r12, lr,  (\i)+6
+    ROUND r5,  r6,  r7,  r8,  r9,  r10, r11, r4,  lr,  r12, (\i)+7
+.endm
+
+/* W[i] = big-endian word i of the block; the block may be unaligned */
+.macro LOAD_W i
+    ldr     r2, [r1, #4*(\i)]
+    rev     r2, r2
+    str     r2, [sp, #4*(\i)]
+.endm
+
+  .section .text.sha256_transform_m3,"ax",%progbits
+  .align 2
+  .global sha256_transform_m3
+  .thumb_func
+  .type sha256_transform_m3, %function
+sha256_transform_m3:
+    push    {r0, r4-r11, lr}
+    sub     sp, sp, #64
+
+  .irp i, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+    LOAD_W  \i
+  .endr
+
+    movw    r3, #:lower16:sha256_k
+    movt    r3, #:upper16:sha256_k
+    ldm     r0, {r4-r11}
+    eor     r12, r5, r6
+
+    ROUNDS8 0
+    ROUNDS8 8
+    ROUNDS8 16
+    ROUNDS8 24
+    ROUNDS8 32
+    ROUNDS8 40
+    ROUNDS8 48
+    ROUNDS8 56
+
+    /* after 64 rounds, a-h are back in r4-r11 */
+    ldr     r0, [sp, #64]
+    ldm     r0, {r1, r2, r3, r12}
+    add     r1, r1, r4
+    add     r2, r2, r5
+    add     r3, r3, r6
+    add     r12, r12, r7
+    stm     r0!, {r1, r2, r3, r12}
+    ldm     r0, {r1, r2, r3, r12}
+    add     r1, r1, r8
+    add     r2, r2, r9
+    add     r3, r3, r10
+    add     r12, r12, r11
+    stm     r0, {r1, r2, r3, r12}
+
+    add     sp, sp, #64
+    pop     {r0, r4-r11, pc}
+  .size sha256_transform_m3, .-sha256_transform_m3
+
+  .section .rodata.sha256_k,"a",%progbits
+  .align 2
+sha256_k:
+  .word 0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5
+  .word 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5
+  .word 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3
+  .word 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174
+  .word 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc
+  .word 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da
+  .word 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7
+  .word 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967
+  .word 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13
+  .word 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85
+  .word 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3
+  .word 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070
+  .word 0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5
+  .word 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3
+  .word 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208
+  .word 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
@@ -0,0 +1,48 @@
+#include "stall_detector.h"
+
+// 2nd-order Butterworth low-pass, fc = 30 Hz at fs = 1 kHz:
+//   b = [0.00782, 0.01564, 0.00782], a = [1, -1.73473, 0.76601]
+// in the CMSIS order {b0, 0, b1, b2, -a1, -a2}, halved for postShift = 1.
+// it suppresses the 133 Hz ripple of the opening current, which would
+// otherwise reach the stall current.
+static q15_t FILTER_COEFFS[6] = {128, 0, 256, 128, 28422, -12550};
+
+StallDetector::StallDetector() {
+    this->reset();
+}
+
+void StallDetector::reset() {
+    arm_biquad_cascade_df1_init_q15(&this->filter, 1, FILTER_COEFFS, this->filter_state, 1);
+    this->samples_seen = 0;
+    this->samples_above = 0;
+    this->last_filtered = 0;
+    this->stall = false;
+}
+
+bool StallDetector::process(const int16_t *samples_ma, uint32_t count) {
+    while (count) {
+        q15_t block[16];
+        uint32_t block_size = (count < 16) ? count : 16;
+        for (uint32_t i = 0; i < block_size; i++) { block[i] = samples_ma[i]; }
+
+        arm_biquad_cascade_df1_q15(&this->filter, block, block, block_size);
+
+        for (uint32_t i = 0; i < block_size; i++) {
+            this->samples_seen += 1;
+            if (this->samples_seen <= blanking_samples) { continue; }
+
+            if (block[i] > stall_current_ma) {
+                this->samples_above += 1;
+                if (this->samples_above >= stall_samples) { this->stall = true; }
+            } else {
+                this->samples_above = 0;
+            }
+        }
+        this->last_filtered = block[block_size - 1];
+
+        samples_ma += block_size;
+        count -= block_size;
+    }
+
+    return this->stall;
+}
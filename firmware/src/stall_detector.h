@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+
+#include "arm_math.h"
+
+/**
+ * Detects the mechanical stop of the motor from its current.
+ *
+ * The current measurements (board/motor-current-measurements) show these
+ * phases of a rotation:
+ *
+ *   - a start spike of up to 450 mA, above 300 mA for ~7 ms
+ *   - travel, between 100 mA and 300 mA
+ *   - the bolt transition, 100 mA to 300 mA for ~20 ms
+ *   - the mechanical stop, fluctuating between 300 mA and 600 mA
+ *   - opening, 100 mA to 300 mA plus a 200 mA sine with a period of 7.5 ms
+ *
+ * The samples are low-pass filtered with a CMSIS-DSP biquad. Once the
+ * start spike is over, a filtered current above stall_current_ma for
+ * stall_samples samples in a row is a mechanical stop.
+ */
+class StallDetector {
+public:
+    /** the rate at which process() is fed */
+    static constexpr uint32_t sample_rate_hz = 1000;
+    /** the start spike is ignored for this number of samples */
+    static constexpr uint32_t blanking_samples = 30;
+    static constexpr int16_t stall_current_ma = 350;
+    static constexpr uint32_t stall_samples = 5;
+
+    StallDetector();
+
+    /** to be called when the motor starts moving */
+    void reset();
+
+    /**
+     * Processes a block of current samples in mA.
+     * Returns true once the mechanical stop has been detected.
+     */
+    bool process(const int16_t *samples_ma, uint32_t count);
+
+    inline bool stalled() const { return this->stall; }
+
+    /** the last filtered current, in mA */
+    inline int16_t filtered_ma() const { return this->last_filtered; }
+
+private:
+    arm_biquad_casd_df1_inst_q15 filter;
+    q15_t filter_state[4];
+
+    uint32_t samples_seen;
+    uint32_t samples_above;
+    int16_t last_filtered;
+    bool stall;
+};
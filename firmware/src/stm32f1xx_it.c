@@ -187,6 +187,8 @@ void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
 
+  isr_latency_measure_systick();
+
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
@@ -207,15 +209,43 @@ void SysTick_Handler(void)
 
 void USART1_IRQHandler(void)
 {
-  if (huart1.Instance->SR & USART_SR_RXNE)
-  {
-    uart_data_received(huart1.Instance->DR);
-  }
-  if (huart1.Instance->SR & USART_SR_TXE)
+  if (huart1.Instance->SR & USART_SR_IDLE)
   {
-    uart_transmit_next();
+    uart_rx_dma_update();
   }
 }
 
+void DMA1_Channel4_IRQHandler(void)
+{
+  uart_tx_dma_complete();
+}
+
+void TIM1_CC_IRQHandler(void)
+{
+  on_dcf77_capture();
+}
+
+void TIM2_IRQHandler(void)
+{
+  on_beeper_timer();
+}
+
+void TIM3_IRQHandler(void)
+{
+  on_step_timer();
+}
+
+#if MOTOR_CURRENT_SENSE
+void DMA1_Channel1_IRQHandler(void)
+{
+  on_motor_current_dma();
+}
+#endif
+
+void DMA1_Channel5_IRQHandler(void)
+{
+  uart_rx_dma_update();
+}
+
 /* USER CODE END 1 */
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
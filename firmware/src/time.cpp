@@ -1,6 +1,10 @@
 #include "time.h"
 
+#include "clock_discipline.h"
 #include "hardware.h"
+#include "rtc.h"
+#include "time_backup.h"
+#include "units.h"
 
 void sleep_us(uint64_t duration_us) {
     sleep_until_us(time_get_64() + duration_us);
@@ -10,35 +14,84 @@ void sleep_until_us(uint64_t timestamp_us) {
     while (time_get_64() < timestamp_us) {}
 }
 
-Period::Period(uint64_t period_us)
-    :
-    start{time_get_64()},
-    period_us(period_us)
-{}
+// before the timestamp has been set, get_timestamp() will return
+// (1970-01-01 00:00 UTC + time since boot)
+static ClockDiscipline discipline;
 
-void Period::wait_next() {
-    uint64_t current_time = time_get_64();
-    uint64_t position_in_period = (time_get_64() - this->start) % this->period_us;
+// the time kept in the RTC, if it runs
+static TimeBackupRecord backup_record;
+static bool backup_valid = false;
 
-    sleep_until_us(current_time - position_in_period + this->period_us);
+uint64_t get_time_us() {
+    CriticalSectionLock lock;
+    return discipline.unix_us(time_get_64());
 }
 
-// before the timestamp has been set, the offset will be 0,
-// i.e. get_timestamp() will return (1970-01-01 00:00 UTC + time since boot)
-static uint64_t timestamp_offset = 0;
+uint64_t get_timestamp() {
+    return units::us_to_s(get_time_us());
+}
 
-static uint64_t get_timestamp_offset() {
+uint64_t get_timestamp_uncertainty_us() {
     CriticalSectionLock lock;
-    return timestamp_offset;
+    return discipline.uncertainty_us(time_get_64());
 }
 
-uint64_t get_timestamp() {
-    return (time_get_64() / static_cast<uint64_t>(1000000)) + get_timestamp_offset();
+bool get_clock_rate(int32_t &rate_ppb, uint32_t &uncertainty_ppb) {
+    CriticalSectionLock lock;
+    rate_ppb = discipline.rate_ppb();
+    uncertainty_ppb = discipline.rate_uncertainty_ppb();
+    return discipline.rate_known();
 }
 
-void set_timestamp(uint64_t monotonic_timestamp, uint64_t unix_timestamp) {
-    uint64_t microseconds_since_boot = monotonic_timestamp;
-    uint64_t seconds_since_boot = microseconds_since_boot / static_cast<uint64_t>(1000000);
+/** adds a synchronization to the time kept in the RTC */
+static void backup_synchronize(uint64_t monotonic_timestamp, uint64_t unix_us, uint32_t uncertainty_us) {
+    if (!rtc_start()) { return; }
+    // the RTC count at monotonic_timestamp
+    uint64_t ticks = rtc_get_ticks();
+    uint64_t since_us = time_get_64() - monotonic_timestamp;
+    ticks -= time_backup::us_to_ticks(since_us);
+
+    // the monotonic time may be off by a tick against the RTC
+    time_backup_synchronize(backup_record, backup_valid, ticks, unix_us, uncertainty_us + time_backup::ticks_to_us(1) + 1);
+    backup_valid = true;
+    uint16_t registers[time_backup::REGISTER_COUNT];
+    time_backup_encode(backup_record, registers);
+    rtc_write_backup(registers);
+}
 
-    timestamp_offset = unix_timestamp - seconds_since_boot;
-}
\ No newline at end of file
+void set_timestamp(uint64_t monotonic_timestamp, uint64_t unix_timestamp, uint32_t uncertainty_us) {
+    uint64_t unix_us = units::s_to_us(unix_timestamp);
+    {
+        CriticalSectionLock lock;
+        discipline.synchronize(monotonic_timestamp, unix_us, uncertainty_us);
+    }
+    backup_synchronize(monotonic_timestamp, unix_us, uncertainty_us);
+}
+
+void set_time_us(uint64_t monotonic_us, uint64_t unix_us, uint32_t uncertainty_us) {
+    {
+        CriticalSectionLock lock;
+        discipline.set(monotonic_us, unix_us, uncertainty_us);
+    }
+    // the time is only set when it isn't known better, so the record
+    // gains from it too, and the time survives the next power loss
+    backup_synchronize(monotonic_us, unix_us, uncertainty_us);
+}
+
+bool restore_timestamp() {
+    if (!rtc_init()) { return false; }
+
+    uint16_t registers[time_backup::REGISTER_COUNT];
+    rtc_read_backup(registers);
+    backup_valid = time_backup_decode(registers, backup_record);
+    if (!backup_valid) { return false; }
+
+    uint64_t now = time_get_64();
+    uint64_t unix_us, uncertainty_us;
+    time_backup_estimate(backup_record, rtc_get_ticks(), unix_us, uncertainty_us);
+    if (uncertainty_us == UINT64_MAX) { return false; }
+    // the monotonic time may be off by a tick against the RTC
+    CriticalSectionLock lock;
+    discipline.set(now, unix_us, uncertainty_us + time_backup::ticks_to_us(1) + 1);
+    return true;
+}
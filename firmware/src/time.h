@@ -9,18 +9,40 @@
 void sleep_us(uint64_t duration_us);
 void sleep_until_us(uint64_t timestamp_us);
 
-class Period {
-public:
-    Period(uint64_t period_us);
-    void wait_next();
-
-private:
-    uint64_t start;
-    uint64_t period_us;
-};
+/** returns the UNIX time in us, as disciplined by set_timestamp(). */
+uint64_t get_time_us();
 
 /** returns the UNIX time, as synchronized through set_timestamp(). */
 uint64_t get_timestamp();
 
-/** sets a new UNIX time from an external time source, valid at monotonic_timestamp */
-void set_timestamp(uint64_t monotonic_timestamp, uint64_t unix_timestamp);
\ No newline at end of file
+/**
+ * returns how far get_time_us() may be off, in us. It grows with the
+ * time since the last synchronization, by the uncertainty of the
+ * measured rate of the crystal; UINT64_MAX until the first one.
+ */
+uint64_t get_timestamp_uncertainty_us();
+
+/**
+ * returns how much faster than real time the crystal runs, and how far
+ * that may be off, in ppb; false until the rate has been measured.
+ */
+bool get_clock_rate(int32_t &rate_ppb, uint32_t &uncertainty_ppb);
+
+/**
+ * sets a new UNIX time from an external time source, valid at monotonic_timestamp
+ * and off by up to uncertainty_us. It is also kept in the RTC.
+ */
+void set_timestamp(uint64_t monotonic_timestamp, uint64_t unix_timestamp, uint32_t uncertainty_us);
+
+/**
+ * sets a new UNIX time in us from a source that is too coarse to measure
+ * the rate of the crystal, such as a time-set message. The RTC keeps it
+ * as a synchronization with that uncertainty.
+ */
+void set_time_us(uint64_t monotonic_us, uint64_t unix_us, uint32_t uncertainty_us);
+
+/**
+ * sets the UNIX time that the RTC has kept through the reset, if it has.
+ * To be called once at startup.
+ */
+bool restore_timestamp();
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "time_backup.h"
+
+#include "calibration.h"
+
+using namespace time_backup;
+
+// the CRC of an empty record isn't 0
+static constexpr uint32_t CRC_SEED = 0x54494d45; // "TIME"
+
+static constexpr uint64_t US_PER_MINUTE = 60000000;
+
+static uint16_t record_crc(const uint16_t *registers) {
+    return static_cast<uint16_t>(crc32(
+        reinterpret_cast<const uint8_t *>(registers),
+        (REGISTER_COUNT - 1) * sizeof(uint16_t),
+        CRC_SEED
+    ));
+}
+
+bool time_backup_decode(const uint16_t *registers, TimeBackupRecord &record) {
+    if (registers[REGISTER_COUNT - 1] != record_crc(registers)) { return false; }
+
+    record.anchor_ticks = 0;
+    record.anchor_unix_ms = 0;
+    for (uint32_t i = 0; i < 3; i++) {
+        record.anchor_ticks |= static_cast<uint64_t>(registers[i]) << (16 * i);
+        record.anchor_unix_ms |= static_cast<uint64_t>(registers[3 + i]) << (16 * i);
+    }
+    record.uncertainty_ms = registers[6] & MAX_UNCERTAINTY_MS;
+    record.drift_known = registers[6] >> 15;
+    record.drift = static_cast<int16_t>(registers[7]);
+    record.fit_minutes = registers[8];
+    return true;
+}
+
+void time_backup_encode(const TimeBackupRecord &record, uint16_t *registers) {
+    for (uint32_t i = 0; i < 3; i++) {
+        registers[i] = static_cast<uint16_t>(record.anchor_ticks >> (16 * i));
+        registers[3 + i] = static_cast<uint16_t>(record.anchor_unix_ms >> (16 * i));
+    }
+    registers[6] = static_cast<uint16_t>(record.uncertainty_ms | (record.drift_known << 15));
+    registers[7] = static_cast<uint16_t>(record.drift);
+    registers[8] = record.fit_minutes;
+    registers[REGISTER_COUNT - 1] = record_crc(registers);
+}
+
+void time_backup_estimate(
+    const TimeBackupRecord &record, uint64_t ticks,
+    uint64_t &unix_us, uint64_t &uncertainty_us
+) {
+    uint64_t anchor_unix_us = record.anchor_unix_ms * 1000;
+    if (ticks < record.anchor_ticks) {
+        // the RTC has been set back; it says nothing about the time
+        unix_us = anchor_unix_us;
+        uncertainty_us = UINT64_MAX;
+        return;
+    }
+
+    uint64_t elapsed_us = ticks_to_us(ticks - record.anchor_ticks);
+    uint64_t drift = static_cast<uint64_t>(record.drift < 0 ? -record.drift : record.drift);
+    uint64_t correction_us = units::ConstantDivisor<16000000, 63>::divide(elapsed_us * drift);
+    elapsed_us = (record.drift < 0) ? elapsed_us + correction_us : elapsed_us - correction_us;
+    unix_us = anchor_unix_us + elapsed_us;
+
+    // the rate is off by up to the tolerance, and by the rounding to
+    // 1/16 ppm, since the last fit; the count by up to a tick, and the
+    // conversions round down
+    uint64_t fit_us = record.fit_minutes * US_PER_MINUTE;
+    uint64_t since_fit_us = (elapsed_us > fit_us) ? elapsed_us - fit_us : 0;
+    uint64_t tolerance = 16 * (record.drift_known ? KNOWN_DRIFT_PPM : UNKNOWN_DRIFT_PPM) + 1;
+    uncertainty_us = (
+        (static_cast<uint64_t>(record.uncertainty_ms) + 1) * 1000 +
+        units::ConstantDivisor<16000000, 63>::divide(since_fit_us * tolerance) +
+        ticks_to_us(1) + 2
+    );
+}
+
+void time_backup_synchronize(
+    TimeBackupRecord &record, bool valid, uint64_t ticks,
+    uint64_t unix_us, uint32_t uncertainty_us
+) {
+    uint32_t uncertainty_ms = (uncertainty_us + 999) / 1000;
+    if (uncertainty_ms > MAX_UNCERTAINTY_MS) { return; }
+
+    if (valid) {
+        // a synchronization that contradicts the record
+        uint64_t estimate_us, estimate_uncertainty_us;
+        time_backup_estimate(record, ticks, estimate_us, estimate_uncertainty_us);
+        uint64_t difference_us = (unix_us > estimate_us) ? unix_us - estimate_us : estimate_us - unix_us;
+        valid = (
+            estimate_uncertainty_us != UINT64_MAX &&
+            unix_us > record.anchor_unix_ms * 1000 &&
+            difference_us <= estimate_uncertainty_us + uncertainty_us
+        );
+    }
+    if (!valid) {
+        record.anchor_ticks = ticks;
+        record.anchor_unix_ms = unix_us / 1000;
+        record.uncertainty_ms = static_cast<uint16_t>(uncertainty_ms);
+        record.drift_known = false;
+        record.drift = 0;
+        record.fit_minutes = 0;
+        return;
+    }
+
+    // the rate is good to 1 ppm once the anchor is this far back
+    uint64_t elapsed_us = unix_us - record.anchor_unix_ms * 1000;
+    uint32_t fit_uncertainty_ms = (uncertainty_ms > record.uncertainty_ms) ? uncertainty_ms : record.uncertainty_ms;
+    uint64_t min_elapsed_us = (2 * static_cast<uint64_t>(fit_uncertainty_ms) + 1) * 1000 * 1000000;
+    if (elapsed_us >= min_elapsed_us) {
+        // this happens once per synchronization, so the 64-bit division doesn't matter
+        int64_t error_us = static_cast<int64_t>(ticks_to_us(ticks - record.anchor_ticks) - elapsed_us);
+        int64_t drift = error_us * 16000000 / static_cast<int64_t>(elapsed_us);
+        if (drift > INT16_MAX) { drift = INT16_MAX; }
+        if (drift < INT16_MIN) { drift = INT16_MIN; }
+        uint64_t fit_minutes = elapsed_us / US_PER_MINUTE;
+        record.drift = static_cast<int16_t>(drift);
+        record.drift_known = true;
+        record.fit_minutes = static_cast<uint16_t>(fit_minutes > UINT16_MAX ? UINT16_MAX : fit_minutes);
+        record.uncertainty_ms = static_cast<uint16_t>(fit_uncertainty_ms);
+    }
+
+    if (record.drift_known && elapsed_us >= ANCHOR_INTERVAL_US) {
+        record.anchor_ticks = ticks;
+        record.anchor_unix_ms = unix_us / 1000;
+        record.uncertainty_ms = static_cast<uint16_t>(uncertainty_ms);
+        record.fit_minutes = 0;
+    }
+}
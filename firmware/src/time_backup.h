@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+
+#include "units.h"
+
+/**
+ * The UNIX time as it is kept across resets: the RTC counts the ticks
+ * of the 32768 Hz LSE crystal in the backup domain, and the backup
+ * registers hold this record. It says which UNIX time an RTC count
+ * stood for at the anchor, and how fast the RTC runs.
+ *
+ * Every synchronization fits the rate to the anchor, once the two are
+ * far enough apart for 1 ppm; the time is then known as well as at that
+ * synchronization, and from there on the uncertainty grows with the
+ * temperature drift of the crystal. The anchor moves on to the
+ * synchronization once a day. A synchronization that contradicts the
+ * record starts over with an unknown rate.
+ */
+struct TimeBackupRecord {
+    // the RTC count at the anchor, in ticks
+    uint64_t anchor_ticks;
+    // the UNIX time at the anchor
+    uint64_t anchor_unix_ms;
+    // how far the anchor and the last fitted synchronization may be off
+    uint16_t uncertainty_ms;
+    // false until the drift has been measured
+    bool drift_known;
+    // how much faster than real time the RTC runs, in 1/16 ppm
+    int16_t drift;
+    // the last synchronization that the rate has been fitted to, in
+    // minutes after the anchor
+    uint16_t fit_minutes;
+};
+
+namespace time_backup {
+
+static constexpr uint32_t TICKS_PER_SECOND = 32768;
+// the number of 16-bit backup registers of the STM32F103C8
+static constexpr uint32_t REGISTER_COUNT = 10;
+
+// the rate error of an LSE crystal, and of its temperature drift once
+// the rate has been measured to 1 ppm
+static constexpr uint32_t UNKNOWN_DRIFT_PPM = 100;
+static constexpr uint32_t KNOWN_DRIFT_PPM = 5 + 1;
+
+// the anchor moves on after this long, once the rate is known
+static constexpr uint64_t ANCHOR_INTERVAL_US = 86400ULL * 1000000;
+// the largest uncertainty the record can hold
+static constexpr uint32_t MAX_UNCERTAINTY_MS = 0x7fff;
+
+constexpr uint64_t ticks_to_us(uint64_t ticks) {
+    // 10^6 / 32768 = 15625 / 2^9
+    return (ticks * 15625) >> 9;
+}
+
+/** for durations below 2^46 us, about two years */
+constexpr uint64_t us_to_ticks(uint64_t us) {
+    return units::ConstantDivisor<15625, 55>::divide(us << 9);
+}
+
+static_assert(ticks_to_us(32768) == 1000000 && us_to_ticks(1000000) == 32768, "ticks");
+
+}  // namespace time_backup
+
+/** reads the record from the backup registers; false if it isn't valid */
+bool time_backup_decode(const uint16_t *registers, TimeBackupRecord &record);
+
+/** writes the record, and its CRC, to the backup registers */
+void time_backup_encode(const TimeBackupRecord &record, uint16_t *registers);
+
+/** the UNIX time at an RTC count, and how far it may be off */
+void time_backup_estimate(
+    const TimeBackupRecord &record, uint64_t ticks,
+    uint64_t &unix_us, uint64_t &uncertainty_us
+);
+
+/**
+ * Adds a synchronization from an external time source to the record,
+ * which may be invalid.
+ */
+void time_backup_synchronize(
+    TimeBackupRecord &record, bool valid, uint64_t ticks,
+    uint64_t unix_us, uint32_t uncertainty_us
+);
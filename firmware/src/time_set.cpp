@@ -0,0 +1,52 @@
+#include "time_set.h"
+
+#include "deserialize.h"
+#include "units.h"
+
+using namespace time_set;
+
+bool time_set_parse(
+    uint64_t valid_from, uint64_t valid_until,
+    const uint8_t *payload, uint32_t payload_size,
+    TimeSetMessage &message
+) {
+    if (payload_size != PAYLOAD_SIZE) { return false; }
+    if (valid_until < valid_from || valid_until - valid_from > MAX_VALIDITY_S) { return false; }
+
+    message.unix_us = deserialize_u64(payload);
+    message.sequence = deserialize_u32(payload + 8);
+
+    uint64_t timestamp = units::us_to_s(message.unix_us);
+    return timestamp >= valid_from && timestamp <= valid_until;
+}
+
+TimeSetResult time_set_check(
+    const TimeSetMessage &message, uint32_t last_sequence,
+    uint64_t local_us, uint64_t local_uncertainty_us, uint64_t max_uncertainty_us
+) {
+    if (last_sequence == ERASED - 1 || message.sequence != last_sequence + 1) {
+        return TimeSetResult::WRONG_SEQUENCE;
+    }
+
+    if (local_uncertainty_us > max_uncertainty_us) { return TimeSetResult::SET; }
+
+    uint64_t difference_us = (message.unix_us > local_us) ? message.unix_us - local_us : local_us - message.unix_us;
+    if (difference_us > local_uncertainty_us + UNCERTAINTY_US) { return TimeSetResult::CONTRADICTS; }
+    return (local_uncertainty_us > SET_UNCERTAINTY_US) ? TimeSetResult::SET : TimeSetResult::KEPT;
+}
+
+uint32_t time_set_last_sequence(const uint32_t *slots) {
+    // the numbers only grow, and the firmware image comes with zeros
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < SEQUENCE_SLOTS; i++) {
+        if (slots[i] != ERASED && slots[i] > last) { last = slots[i]; }
+    }
+    return last;
+}
+
+uint32_t time_set_free_slot(const uint32_t *slots) {
+    for (uint32_t i = 0; i < SEQUENCE_SLOTS; i++) {
+        if (slots[i] == ERASED) { return i; }
+    }
+    return SEQUENCE_SLOTS;
+}
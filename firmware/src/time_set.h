@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Message type 4 sets the time from the database, which signs its own
+ * time, so that the lock doesn't need to wait for DCF77 after a reset.
+ *
+ * The payload holds the UNIX time in us and a sequence number, which
+ * must be the one after that of the last accepted message; the
+ * sequence numbers are kept in flash, so that no message is accepted
+ * twice. If the lock knows the time already, the message must agree
+ * with it within the uncertainty of both.
+ */
+struct TimeSetMessage {
+    uint64_t unix_us;
+    uint32_t sequence;
+};
+
+enum class TimeSetResult {
+    // the time is set from the message
+    SET,
+    // the time is known well enough already
+    KEPT,
+    // not the next sequence number; the message may have been replayed
+    WRONG_SEQUENCE,
+    // the message is too far off the time that is known
+    CONTRADICTS,
+};
+
+namespace time_set {
+
+static constexpr uint8_t MESSAGE_TYPE = 0x04;
+static constexpr uint32_t PAYLOAD_SIZE = 12;
+
+// how far the time may be off when it arrives: the way from the
+// database through the bridge takes less than this
+static constexpr uint32_t UNCERTAINTY_US = 2000000;
+// the time is only set if it may be off by more than this. a time set
+// from a message is off by a bit more than UNCERTAINTY_US right away,
+// so the margin keeps the next message from setting it again.
+static constexpr uint64_t SET_UNCERTAINTY_US = 2 * UNCERTAINTY_US;
+// the validity window of a message may be at most this long
+static constexpr uint64_t MAX_VALIDITY_S = 120;
+
+// the sequence numbers are appended to a flash page of this many
+// slots; an erased slot reads as ERASED
+static constexpr uint32_t SEQUENCE_SLOTS = 256;
+static constexpr uint32_t ERASED = 0xffffffff;
+
+}  // namespace time_set
+
+/**
+ * Reads the payload of a time-set message. False if it is malformed,
+ * or if the time is outside of the validity window of the message.
+ */
+bool time_set_parse(
+    uint64_t valid_from, uint64_t valid_until,
+    const uint8_t *payload, uint32_t payload_size,
+    TimeSetMessage &message
+);
+
+/**
+ * Decides on a message, given the last accepted sequence number and the
+ * local UNIX time with its uncertainty. The local time counts as known
+ * if it is off by at most max_uncertainty_us.
+ */
+TimeSetResult time_set_check(
+    const TimeSetMessage &message, uint32_t last_sequence,
+    uint64_t local_us, uint64_t local_uncertainty_us, uint64_t max_uncertainty_us
+);
+
+/**
+ * The last sequence number in the slots; 0 if there is none. A slot
+ * that was written only halfway reads as a larger number than it was
+ * going to be, so that no sequence number can be accepted twice.
+ */
+uint32_t time_set_last_sequence(const uint32_t *slots);
+
+/** the first erased slot, or SEQUENCE_SLOTS if the page is full */
+uint32_t time_set_free_slot(const uint32_t *slots);
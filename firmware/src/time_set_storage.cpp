@@ -0,0 +1,36 @@
+#include "time_set_storage.h"
+
+#include "stm32f1xx_hal.h"
+
+// by default, no time-set message has been accepted.
+__attribute__((section(".time_set_storage")))
+const uint32_t TIME_SET_SEQUENCES[time_set::SEQUENCE_SLOTS] = {};
+
+bool time_set_write_sequence(uint32_t sequence) {
+    uint32_t slot = time_set_free_slot(TIME_SET_SEQUENCES);
+
+    HAL_FLASH_Unlock();
+
+    bool ok = true;
+    if (slot == time_set::SEQUENCE_SLOTS) {
+        FLASH_EraseInitTypeDef erase_init;
+        erase_init.TypeErase = FLASH_TYPEERASE_PAGES;
+        erase_init.Banks = 0; /* only used for mass erase */
+        erase_init.PageAddress = reinterpret_cast<uint32_t>(TIME_SET_SEQUENCES);
+        erase_init.NbPages = 1;
+
+        uint32_t page_error;
+        ok = (HAL_FLASHEx_Erase(&erase_init, &page_error) == HAL_OK);
+        slot = 0;
+    }
+
+    // the upper half first: a slot that is written only halfway then
+    // reads as a larger number
+    uint32_t address = reinterpret_cast<uint32_t>(&TIME_SET_SEQUENCES[slot]);
+    ok = ok && HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, address + 2, sequence >> 16) == HAL_OK;
+    ok = ok && HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, address, sequence & 0xffff) == HAL_OK;
+
+    HAL_FLASH_Lock();
+
+    return ok && time_set_last_sequence(TIME_SET_SEQUENCES) == sequence;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "time_set.h"
+
+/** the sequence numbers of the accepted time-set messages in flash, in the order they were written */
+extern const uint32_t TIME_SET_SEQUENCES[time_set::SEQUENCE_SLOTS];
+
+/**
+ * appends the sequence number to the flash page; once the page is full,
+ * it is erased first. A reset between the erase and the write loses the
+ * sequence numbers; that takes a reset during the 20 ms of the erase,
+ * once per SEQUENCE_SLOTS messages.
+ */
+bool time_set_write_sequence(uint32_t sequence);
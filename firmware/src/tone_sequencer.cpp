@@ -0,0 +1,134 @@
+#include "tone_sequencer.h"
+
+namespace tones {
+
+TonePattern beep(uint32_t period_us, uint32_t duration_us) {
+    return TonePattern{period_us, period_us, duration_us, 0, 1, 1, 0};
+}
+
+TonePattern pattern(uint32_t period_a_us, uint32_t period_b_us, uint32_t pause_us, uint32_t beeps) {
+    return TonePattern{period_a_us, period_b_us, 10000, pause_us, beeps, 1, 0};
+}
+
+TonePattern good(uint32_t length_us) {
+    return beep(1000000/152, length_us);
+}
+
+TonePattern error(uint32_t code) {
+    return TonePattern{1000000/152, 1000000/900, 10000, 1000, 10, code, 200000};
+}
+
+TonePattern party(uint32_t duration) {
+    return pattern(1000000/152, 1000000/900, 100000, duration);
+}
+
+TonePattern startup() {
+    return pattern(1000000/200, 1000000/150, 100000, 5);
+}
+
+}
+
+
+bool ToneSequencer::enqueue(const TonePattern &pattern) {
+    if (pattern.period_a_us == 0 || pattern.period_a_us > MAX_PERIOD_US) { return false; }
+    if (pattern.period_b_us == 0 || pattern.period_b_us > MAX_PERIOD_US) { return false; }
+    if (pattern.beeps == 0 || pattern.repeats == 0) { return true; }
+
+    uint32_t head = this->head.load(std::memory_order_relaxed);
+    uint32_t tail = this->tail.load(std::memory_order_acquire);
+    if (head - tail >= QUEUE_SIZE) { return false; }
+
+    this->queue[head % QUEUE_SIZE] = pattern;
+    this->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+
+bool ToneSequencer::busy() const {
+    return this->head.load(std::memory_order_acquire) != this->tail.load(std::memory_order_acquire);
+}
+
+
+void ToneSequencer::start_tone(uint32_t period_us, uint32_t duration_us) {
+    // the blocking beeper was high and low for period_us/2 each
+    this->segment_high_us = period_us / 2;
+    this->segment_period_us = 2 * this->segment_high_us;
+    this->segment_periods_left = duration_us / period_us;
+    this->segment_long_periods_left = 0;
+}
+
+
+void ToneSequencer::start_pause(uint32_t duration_us) {
+    uint32_t periods = (duration_us + MAX_PERIOD_US - 1) / MAX_PERIOD_US;
+    this->segment_high_us = 0;
+    this->segment_periods_left = periods;
+    if (periods) {
+        this->segment_period_us = duration_us / periods;
+        this->segment_long_periods_left = duration_us % periods;
+    }
+}
+
+
+bool ToneSequencer::next_segment() {
+    uint32_t tail = this->tail.load(std::memory_order_relaxed);
+
+    if (!this->playing) {
+        if (tail == this->head.load(std::memory_order_acquire)) { return false; }
+        this->playing = true;
+        this->repeats_left = this->queue[tail % QUEUE_SIZE].repeats;
+        this->beeps_left = 0;
+        this->pause_next = false;
+        this->repeat_pause_next = false;
+    }
+    const TonePattern &pattern = this->queue[tail % QUEUE_SIZE];
+
+    if (this->pause_next) {
+        this->pause_next = false;
+        this->start_pause(pattern.pause_us);
+        return true;
+    }
+
+    if (this->beeps_left) {
+        this->start_tone(this->period_b ? pattern.period_b_us : pattern.period_a_us, pattern.beep_us);
+        this->beeps_left -= 1;
+        this->period_b = !this->period_b;
+        this->pause_next = (this->beeps_left > 0);
+        this->repeat_pause_next = (this->beeps_left == 0);
+        return true;
+    }
+
+    if (this->repeat_pause_next) {
+        // like the blocking beeper, every repeat is followed by the pause
+        this->repeat_pause_next = false;
+        this->start_pause(pattern.repeat_pause_us);
+        return true;
+    }
+
+    if (this->repeats_left) {
+        this->repeats_left -= 1;
+        this->beeps_left = pattern.beeps;
+        this->period_b = false;
+        return this->next_segment();
+    }
+
+    // the pattern is over
+    this->playing = false;
+    this->tail.store(tail + 1, std::memory_order_release);
+    return this->next_segment();
+}
+
+
+bool ToneSequencer::next_period(uint32_t &period_us, uint32_t &high_us) {
+    while (this->segment_periods_left == 0) {
+        if (!this->next_segment()) { return false; }
+    }
+
+    this->segment_periods_left -= 1;
+    period_us = this->segment_period_us;
+    high_us = this->segment_high_us;
+    if (this->segment_long_periods_left) {
+        this->segment_long_periods_left -= 1;
+        period_us += 1;
+    }
+    return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * A beep pattern: 'repeats' times 'beeps' tones of beep_us each,
+ * alternating between the two periods, separated by pause_us.
+ * Each repeat is followed by repeat_pause_us.
+ */
+struct TonePattern {
+    uint32_t period_a_us;
+    uint32_t period_b_us;
+    uint32_t beep_us;
+    uint32_t pause_us;
+    uint32_t beeps;
+    uint32_t repeats;
+    uint32_t repeat_pause_us;
+};
+
+/** the patterns of the Beeper */
+namespace tones {
+
+TonePattern beep(uint32_t period_us, uint32_t duration_us);
+TonePattern pattern(uint32_t period_a_us, uint32_t period_b_us, uint32_t pause_us, uint32_t beeps);
+TonePattern good(uint32_t length_us);
+TonePattern error(uint32_t code);
+TonePattern party(uint32_t duration);
+TonePattern startup();
+
+}
+
+/**
+ * Plays a queue of beep patterns as a sequence of PWM periods.
+ *
+ * Patterns are enqueued from the main loop, and next_period() is called
+ * from the timer interrupt; the queue is lock-free for this one producer
+ * and one consumer.
+ *
+ * Each tone is a number of PWM periods with a duty cycle of 50%. Pauses
+ * are silent periods; long pauses are split into periods that fit into
+ * a 16-bit timer.
+ */
+class ToneSequencer {
+public:
+    static constexpr uint32_t QUEUE_SIZE = 8;
+    /** the longest period of a 16-bit timer that counts us */
+    static constexpr uint32_t MAX_PERIOD_US = 0x10000;
+
+    /**
+     * Appends a pattern to the queue. Returns false if the queue is
+     * full, or if a tone period doesn't fit into the timer.
+     */
+    bool enqueue(const TonePattern &pattern);
+
+    /**
+     * The next PWM period: the output is high for the first high_us of
+     * period_us. Returns false once everything has been played.
+     */
+    bool next_period(uint32_t &period_us, uint32_t &high_us);
+
+    /** true while something is queued or playing */
+    bool busy() const;
+
+private:
+    TonePattern queue[QUEUE_SIZE];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+
+    // the pattern that is playing; it stays in the queue until it is over
+    bool playing = false;
+    uint32_t repeats_left;
+    uint32_t beeps_left;
+    bool period_b;
+    // the next segment is the pause between two beeps, or after a repeat
+    bool pause_next;
+    bool repeat_pause_next;
+
+    // the segment that is playing: a tone or a pause
+    uint32_t segment_period_us;
+    uint32_t segment_high_us;
+    uint32_t segment_periods_left = 0;
+    // pauses that aren't a multiple of their period: this many periods
+    // are 1 us longer
+    uint32_t segment_long_periods_left = 0;
+
+    bool next_segment();
+    void start_tone(uint32_t period_us, uint32_t duration_us);
+    void start_pause(uint32_t duration_us);
+};
@@ -0,0 +1,131 @@
+#include "uart_rx.h"
+
+#include "binary_frame.h"
+
+inline bool UARTRxFramer::is_end(uint8_t byte) const {
+    if (this->binary) { return byte == binary_frame::END; }
+    return byte == '\0' || byte == '\r' || byte == '\n';
+}
+
+void UARTRxFramer::start_message() {
+    uint32_t head = this->head.load(std::memory_order_relaxed);
+    uint32_t tail = this->tail.load(std::memory_order_acquire);
+
+    this->in_message = true;
+    // the slot held by the main loop is still counted, since tail is
+    // only advanced past it on the next poll
+    this->discarding = (head - tail >= SLOTS);
+    if (!this->discarding) {
+        this->slots[head % SLOTS].reset();
+    }
+}
+
+void UARTRxFramer::end_message() {
+    if (!this->in_message) {
+        // an empty message
+        this->start_message();
+    }
+    this->in_message = false;
+    this->binary = false;
+
+    if (this->discarding) {
+        this->dropped_queue_full = this->dropped_queue_full + 1;
+        return;
+    }
+
+    uint32_t head = this->head.load(std::memory_order_relaxed);
+    if (this->slots[head % SLOTS].overflow) {
+        this->dropped_too_long = this->dropped_too_long + 1;
+        return;
+    }
+
+    // publish the slot
+    this->head.store(head + 1, std::memory_order_release);
+}
+
+void UARTRxFramer::idle() {
+    // a client sends a binary frame at once
+    if (this->in_message && this->binary) {
+        this->end_message();
+    }
+}
+
+void UARTRxFramer::receive(uint8_t byte) {
+    this->receive(&byte, 1);
+}
+
+void UARTRxFramer::receive(const uint8_t *data, uint32_t length) {
+    while (length) {
+        if (this->is_end(*data)) {
+            this->end_message();
+            data++;
+            length--;
+            continue;
+        }
+
+        if (!this->in_message) {
+            this->binary = (*data == binary_frame::START);
+            this->start_message();
+        }
+
+        if (this->discarding) {
+            // skip the run of bytes up to the next terminator
+            while (length && !this->is_end(*data)) {
+                data++;
+                length--;
+            }
+            continue;
+        }
+
+        // copy the run of bytes up to the next terminator
+        UARTRxBuffer &slot = this->slots[this->head.load(std::memory_order_relaxed) % SLOTS];
+        uint32_t space = slot.buf.size() - slot.buf_pos;
+        while (length && !this->is_end(*data)) {
+            if (space) {
+                slot.buf[slot.buf_pos++] = *data;
+                space--;
+            } else {
+                slot.overflow = true;
+                // no binary frame is this long; a text terminator ends it
+                this->binary = false;
+            }
+            data++;
+            length--;
+        }
+    }
+}
+
+UARTRxBuffer *UARTRxFramer::poll_message() {
+    uint32_t tail = this->tail.load(std::memory_order_relaxed);
+    if (this->holding) {
+        // release the previous message
+        this->holding = false;
+        tail += 1;
+        this->tail.store(tail, std::memory_order_release);
+    }
+
+    if (this->head.load(std::memory_order_acquire) == tail) { return nullptr; }
+
+    this->holding = true;
+    return &this->slots[tail % SLOTS];
+}
+
+UARTRxBuffer *UARTRxFramer::peek_receiving(uint32_t &generation, uint32_t &length) {
+    UARTRxBuffer *slot = &this->slots[this->head.load(std::memory_order_relaxed) % SLOTS];
+    generation = slot->generation;
+    length = (this->in_message && !this->discarding) ? slot->buf_pos : 0;
+    return slot;
+}
+
+void DMARxRing::update(uint32_t remaining, UARTRxFramer &framer) {
+    uint32_t write_pos = (this->buf.size() - remaining) % this->buf.size();
+
+    if (write_pos < this->read_pos) {
+        // the DMA controller has wrapped around
+        framer.receive(&this->buf[this->read_pos], this->buf.size() - this->read_pos);
+        this->read_pos = 0;
+    }
+
+    framer.receive(&this->buf[this->read_pos], write_pos - this->read_pos);
+    this->read_pos = write_pos;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+class UARTRxBuffer {
+public:
+    std::array<uint8_t, 256> buf;
+    uint32_t buf_pos;
+    // the message didn't fit into buf, it will be dropped
+    bool overflow;
+    // incremented whenever the content is discarded
+    volatile uint32_t generation = 0;
+
+    inline UARTRxBuffer() { this->reset(); }
+
+    inline void reset() {
+        this->generation = this->generation + 1;
+        this->buf_pos = 0;
+        this->overflow = false;
+    }
+};
+
+/**
+ * Splits the received bytes into messages which are terminated by
+ * '\0', '\r' or '\n', and queues them in a fixed number of slots.
+ * A message that starts with binary_frame::START is a binary frame,
+ * which binary_frame::END or an idle line terminates. A binary frame
+ * that doesn't fit into a UARTRxBuffer is taken for text, so a stray
+ * START can't hold up the text messages after it.
+ *
+ * The queue is a single-producer/single-consumer ring: receive() is
+ * meant to be called from an ISR, poll_message() from the main loop.
+ *
+ * Drop policy: messages that are longer than a UARTRxBuffer are dropped.
+ * If all slots are occupied when a message starts, the new message is
+ * dropped and the queued ones are kept.
+ */
+class UARTRxFramer {
+public:
+    static constexpr uint32_t SLOTS = 4;
+
+    // the number of messages that were dropped
+    volatile uint32_t dropped_queue_full = 0;
+    volatile uint32_t dropped_too_long = 0;
+
+    void receive(uint8_t byte);
+    void receive(const uint8_t *data, uint32_t length);
+
+    /** the line has gone idle; called after the bytes before it are received */
+    void idle();
+
+    /**
+     * Returns the oldest queued message, or nullptr.
+     * The slot of the previously returned message is released.
+     */
+    UARTRxBuffer *poll_message();
+
+    /**
+     * Returns the slot to which the current message is being received.
+     * length is 0 while no message is being received to a slot.
+     * Must be called with interrupts disabled.
+     */
+    UARTRxBuffer *peek_receiving(uint32_t &generation, uint32_t &length);
+
+private:
+    std::array<UARTRxBuffer, SLOTS> slots;
+
+    // slots[head % SLOTS] receives the next message; written by receive()
+    std::atomic<uint32_t> head{0};
+    // slots[tail % SLOTS] is the oldest message; written by poll_message()
+    std::atomic<uint32_t> tail{0};
+    // the slot before tail has been returned by poll_message()
+    bool holding = false;
+
+    // used by receive() only
+    bool in_message = false;
+    bool discarding = false;
+    bool binary = false;
+
+    inline bool is_end(uint8_t byte) const;
+
+    void start_message();
+    void end_message();
+};
+
+/**
+ * The receive buffer of a DMA channel in circular mode.
+ * The DMA controller writes to buf; update() passes everything that
+ * has been written since the previous call on to a UARTRxFramer.
+ *
+ * update() must be called before the DMA controller has written
+ * another buf.size() bytes, e.g. from the half-transfer and
+ * transfer-complete interrupts.
+ */
+class DMARxRing {
+public:
+    std::array<uint8_t, 256> buf;
+
+    /**
+     * remaining is the DMA channel's transfer counter (CNDTR),
+     * which counts down from buf.size() to 1 and then reloads.
+     */
+    void update(uint32_t remaining, UARTRxFramer &framer);
+
+private:
+    uint32_t read_pos = 0;
+};
@@ -0,0 +1,33 @@
+#include "uart_tx.h"
+
+#include <cstring>
+
+bool UARTTxBuffer::add(const uint8_t *data, uint32_t length) {
+    if (length > this->space()) { return false; }
+
+    uint32_t end_pos = (this->start_pos + this->size) % this->buf.size();
+    uint32_t first = this->buf.size() - end_pos;
+    if (first > length) { first = length; }
+
+    std::memcpy(&this->buf[end_pos], data, first);
+    std::memcpy(&this->buf[0], data + first, length - first);
+    this->size += length;
+    return true;
+}
+
+uint32_t UARTTxBuffer::start_chunk(const uint8_t *&data) {
+    if (this->chunk_size) { return 0; }
+
+    uint32_t length = this->buf.size() - this->start_pos;
+    if (length > this->size) { length = this->size; }
+
+    data = &this->buf[this->start_pos];
+    this->chunk_size = length;
+    return length;
+}
+
+void UARTTxBuffer::finish_chunk() {
+    this->start_pos = (this->start_pos + this->chunk_size) % this->buf.size();
+    this->size -= this->chunk_size;
+    this->chunk_size = 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/**
+ * The UART transmit ring buffer, which is drained in contiguous chunks
+ * by the DMA controller.
+ *
+ * Not thread-safe: all methods must be called with interrupts disabled.
+ */
+class UARTTxBuffer {
+public:
+    std::array<uint8_t, 256> buf;
+
+    /** the number of bytes that can be added */
+    inline uint32_t space() const { return this->buf.size() - this->size; }
+
+    /**
+     * Adds data to the ring.
+     * Returns false, and adds nothing, if it doesn't fit.
+     */
+    bool add(const uint8_t *data, uint32_t length);
+
+    /**
+     * Returns the length of the next contiguous chunk of data to transmit,
+     * or 0 if there is none or the previous chunk hasn't been finished.
+     */
+    uint32_t start_chunk(const uint8_t *&data);
+
+    /** releases the space of the chunk that has been transmitted */
+    void finish_chunk();
+
+private:
+    uint32_t start_pos = 0;
+    // the number of bytes in the ring, including the current chunk
+    uint32_t size = 0;
+    uint32_t chunk_size = 0;
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Time and motor unit conversions without 64-bit divisions; the
+ * Cortex-M3 only divides 32-bit values in hardware, and a 64-bit
+ * division is a call to __aeabi_uldivmod of several hundred cycles.
+ *
+ * Divisions by constants are multiplications by a fixed-point
+ * reciprocal, which is computed at compile time, and which gives the
+ * exact quotient for every dividend in the stated range.
+ */
+namespace units {
+
+/** floor(a * b / 2^shift) of the full 128-bit product, for shift < 128 */
+constexpr uint64_t mul_shift(uint64_t a, uint64_t b, uint32_t shift) {
+    uint64_t a_lo = a & 0xffffffff, a_hi = a >> 32;
+    uint64_t b_lo = b & 0xffffffff, b_hi = b >> 32;
+
+    uint64_t lo_lo = a_lo * b_lo;
+    uint64_t hi_lo = a_hi * b_lo;
+    uint64_t lo_hi = a_lo * b_hi;
+    uint64_t hi_hi = a_hi * b_hi;
+
+    uint64_t middle = (lo_lo >> 32) + (hi_lo & 0xffffffff) + (lo_hi & 0xffffffff);
+    uint64_t lo = (middle << 32) | (lo_lo & 0xffffffff);
+    uint64_t hi = hi_hi + (hi_lo >> 32) + (lo_hi >> 32) + (middle >> 32);
+
+    if (shift == 0) { return lo; }
+    if (shift < 64) { return (hi << (64 - shift)) | (lo >> shift); }
+    return hi >> (shift - 64);
+}
+
+/** the smallest l with 2^l >= value */
+constexpr uint32_t ceil_log2(uint64_t value) {
+    uint32_t l = 0;
+    while (l < 64 && (uint64_t(1) << l) < value) { l++; }
+    return l;
+}
+
+constexpr uint32_t trailing_zeros(uint64_t value) {
+    uint32_t count = 0;
+    while (count < 63 && !(value & (uint64_t(1) << count))) { count++; }
+    return count;
+}
+
+/** ceil(2^exponent / divisor), or 0 if it doesn't fit into 64 bits */
+constexpr uint64_t ceil_pow2_div(uint32_t exponent, uint64_t divisor) {
+    // long division of a 1 followed by 'exponent' zeros
+    uint64_t quotient = 0;
+    uint64_t remainder = 0;
+    for (int32_t bit = exponent; bit >= 0; bit--) {
+        if (quotient >> 63) { return 0; }
+        remainder = 2 * remainder + (static_cast<uint32_t>(bit) == exponent ? 1 : 0);
+        quotient = 2 * quotient;
+        if (remainder >= divisor) {
+            remainder -= divisor;
+            quotient += 1;
+        }
+    }
+    if (remainder) {
+        if (quotient == UINT64_MAX) { return 0; }
+        quotient += 1;
+    }
+    return quotient;
+}
+
+/**
+ * Division by DIVISOR, exact for all dividends below 2^BITS.
+ *
+ * With d = DIVISOR / 2^z odd, N = BITS - z and l = ceil(log2(d)),
+ * m = ceil(2^(N + l) / d) and n < 2^N, floor(n * m / 2^(N + l)) is
+ * floor(n / d): m * d - 2^(N + l) < d <= 2^l, so the product exceeds
+ * n / d by less than 1/d.
+ */
+template <uint64_t DIVISOR, uint32_t BITS = 64>
+struct ConstantDivisor {
+    static constexpr uint32_t PRE_SHIFT = trailing_zeros(DIVISOR);
+    static constexpr uint64_t ODD = DIVISOR >> PRE_SHIFT;
+    static constexpr uint32_t SHIFT = (BITS - PRE_SHIFT) + ceil_log2(ODD);
+    static constexpr uint64_t MAGIC = ceil_pow2_div(SHIFT, ODD);
+
+    static_assert(DIVISOR > 0, "division by zero");
+    static_assert(ODD == 1 || MAGIC != 0, "the reciprocal doesn't fit into 64 bits; reduce BITS");
+
+    static constexpr uint64_t divide(uint64_t dividend) {
+        return (ODD == 1)
+            ? (dividend >> PRE_SHIFT)
+            : mul_shift(dividend >> PRE_SHIFT, MAGIC, SHIFT);
+    }
+};
+
+static constexpr uint64_t US_PER_S = 1000000;
+static constexpr uint32_t UREV_PER_STEP = 1000000 / 200;
+
+/** seconds in a time in us, rounded down; exact for all 64-bit values */
+constexpr uint64_t us_to_s(uint64_t us) {
+    return ConstantDivisor<US_PER_S>::divide(us);
+}
+
+constexpr uint64_t s_to_us(uint64_t s) {
+    return s * US_PER_S;
+}
+
+/** the microsteps in a distance in urev, rounded down; mode_index is log2 of the microstep mode */
+constexpr uint32_t urevs_to_microsteps(uint32_t urevs, uint32_t mode_index) {
+    // urevs << mode_index < 2^(32 + 5)
+    return static_cast<uint32_t>(
+        ConstantDivisor<UREV_PER_STEP, 37>::divide(static_cast<uint64_t>(urevs) << mode_index)
+    );
+}
+
+/** the distance in urev of a number of microsteps */
+constexpr uint32_t microsteps_to_urevs(uint32_t microsteps, uint32_t mode_index) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(microsteps) * UREV_PER_STEP) >> mode_index);
+}
+
+/**
+ * floor(numerator / divisor) for numerator < 2^33, with 32-bit
+ * divisions only, which the Cortex-M3 does in hardware:
+ * floor(2a / d) = 2 floor(a / d) + floor(2 (a mod d) / d)
+ */
+constexpr uint64_t divide_u33_u32(uint64_t numerator, uint32_t divisor) {
+    uint32_t half = static_cast<uint32_t>(numerator >> 1);
+    uint32_t quotient = half / divisor;
+    uint64_t remainder = 2 * static_cast<uint64_t>(half - quotient * divisor) + (numerator & 1);
+    // remainder < 2 divisor
+    return 2 * static_cast<uint64_t>(quotient) + (remainder >= divisor ? 1 : 0);
+}
+
+/** the period in us of a frequency in Hz, rounded down; hz must not be 0 */
+constexpr uint32_t hz_to_period_us(uint32_t hz) {
+    // a 32-bit division, which the Cortex-M3 does in hardware
+    return static_cast<uint32_t>(US_PER_S) / hz;
+}
+
+/** the frequency in Hz of a period in us, rounded down; period_us must not be 0 */
+constexpr uint32_t period_us_to_hz(uint32_t period_us) {
+    return static_cast<uint32_t>(US_PER_S) / period_us;
+}
+
+/**
+ * The period in us between the microsteps at a speed in urev/s, rounded
+ * down: floor(10^6 * UREV_PER_STEP / (2^mode_index * urev_per_second)).
+ * 2^mode_index divides 10^6 * UREV_PER_STEP, which is below 2^33.
+ */
+constexpr uint64_t microstep_period_us(uint32_t urev_per_second, uint32_t mode_index) {
+    return divide_u33_u32((US_PER_S * UREV_PER_STEP) >> mode_index, urev_per_second);
+}
+
+static_assert(us_to_s(999999) == 0 && us_to_s(1000000) == 1, "us_to_s");
+static_assert(us_to_s(UINT64_MAX) == UINT64_MAX / 1000000, "us_to_s");
+static_assert(urevs_to_microsteps(3000000, 0) == 600, "urevs_to_microsteps");
+static_assert(urevs_to_microsteps(UINT32_MAX, 5) == (uint64_t(UINT32_MAX) << 5) / 5000, "urevs_to_microsteps");
+static_assert(microstep_period_us(4000000, 0) == 1250, "microstep_period_us");
+static_assert(microstep_period_us(1, 0) == 5000000000, "microstep_period_us");
+
+}
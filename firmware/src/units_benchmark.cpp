@@ -0,0 +1,78 @@
+#include "units_benchmark.h"
+
+#include "stm32f1xx_hal.h"
+
+#include "units.h"
+
+// volatile, so that the compiler can't fold the divisors into the code
+static volatile uint64_t us_per_s = units::US_PER_S;
+static volatile uint64_t urev_per_step = units::UREV_PER_STEP;
+
+__attribute__((noinline)) static uint64_t division_us_to_s(uint64_t us) {
+    return us / us_per_s;
+}
+
+__attribute__((noinline)) static uint64_t units_us_to_s(uint64_t us) {
+    return units::us_to_s(us);
+}
+
+__attribute__((noinline)) static uint64_t division_microsteps(uint32_t urevs, uint32_t mode_index) {
+    return (static_cast<uint64_t>(1 << mode_index) * urevs) / urev_per_step;
+}
+
+__attribute__((noinline)) static uint64_t units_microsteps(uint32_t urevs, uint32_t mode_index) {
+    return units::urevs_to_microsteps(urevs, mode_index);
+}
+
+__attribute__((noinline)) static uint64_t division_period(uint32_t urev_per_second, uint32_t mode_index) {
+    return (us_per_s * urev_per_step) / (static_cast<uint64_t>(1 << mode_index) * urev_per_second);
+}
+
+__attribute__((noinline)) static uint64_t units_period(uint32_t urev_per_second, uint32_t mode_index) {
+    return units::microstep_period_us(urev_per_second, mode_index);
+}
+
+static constexpr uint32_t runs = 64;
+
+/** the average cycles of a conversion, over varying inputs */
+template <typename F>
+static uint32_t measure(F function) {
+    uint64_t sink = 0;
+    uint32_t start = DWT->CYCCNT;
+    for (uint32_t i = 0; i < runs; i++) { sink += function(i); }
+    uint32_t cycles = DWT->CYCCNT - start;
+    static volatile uint64_t result;
+    result = sink;
+    return cycles / runs;
+}
+
+uint32_t units_benchmark_run(UnitsBenchmark *results, uint32_t max_results) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    // the loop overhead is included in both figures
+    UnitsBenchmark all[] = {
+        {
+            "us_to_s",
+            measure([](uint32_t i) { return division_us_to_s(1700000000000000ULL + i * 7919); }),
+            measure([](uint32_t i) { return units_us_to_s(1700000000000000ULL + i * 7919); }),
+        },
+        {
+            "urevs_to_microsteps",
+            measure([](uint32_t i) { return division_microsteps(3000000 + i * 7919, i & 3); }),
+            measure([](uint32_t i) { return units_microsteps(3000000 + i * 7919, i & 3); }),
+        },
+        {
+            "microstep_period_us",
+            measure([](uint32_t i) { return division_period(4000000 + i * 7919, i & 3); }),
+            measure([](uint32_t i) { return units_period(4000000 + i * 7919, i & 3); }),
+        },
+    };
+
+    uint32_t count = 0;
+    for (const UnitsBenchmark &result : all) {
+        if (count == max_results) { break; }
+        results[count++] = result;
+    }
+    return count;
+}
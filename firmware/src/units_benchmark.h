@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Cycle counts of the unit conversions in units.h and of the 64-bit
+ * divisions they replace, measured with the DWT cycle counter. Only
+ * built with UNITS_BENCHMARK=1.
+ */
+struct UnitsBenchmark {
+    const char *name;
+    uint32_t division_cycles;
+    uint32_t units_cycles;
+};
+
+/** runs the benchmark; returns the number of results */
+uint32_t units_benchmark_run(UnitsBenchmark *results, uint32_t max_results);
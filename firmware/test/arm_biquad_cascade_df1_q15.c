@@ -0,0 +1 @@
+../src/Drivers/CMSIS/DSP_Lib/Source/FilteringFunctions/arm_biquad_cascade_df1_q15.c
\ No newline at end of file
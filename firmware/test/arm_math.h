@@ -0,0 +1,52 @@
+#pragma once
+
+/*
+ * The parts of CMSIS-DSP arm_math.h that the firmware uses, for building
+ * the CMSIS-DSP sources on the host. The real header needs a Cortex core.
+ * ARM_MATH_CM0_FAMILY selects the plain C implementations.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#define ARM_MATH_CM0_FAMILY
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+typedef int64_t q63_t;
+
+static inline int32_t __SSAT(int32_t value, uint32_t bits) {
+    const int32_t max = (1 << (bits - 1)) - 1;
+    const int32_t min = -(1 << (bits - 1));
+    if (value > max) { return max; }
+    if (value < min) { return min; }
+    return value;
+}
+
+typedef struct {
+    int8_t numStages;
+    q15_t *pState;
+    q15_t *pCoeffs;
+    int8_t postShift;
+} arm_biquad_casd_df1_inst_q15;
+
+void arm_biquad_cascade_df1_q15(
+    const arm_biquad_casd_df1_inst_q15 *S,
+    q15_t *pSrc,
+    q15_t *pDst,
+    uint32_t blockSize);
+
+void arm_biquad_cascade_df1_init_q15(
+    arm_biquad_casd_df1_inst_q15 *S,
+    uint8_t numStages,
+    q15_t *pCoeffs,
+    q15_t *pState,
+    int8_t postShift);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,12 +1,136 @@
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <string>
 #include <vector>
 
 #include "base64.h"
 
 const char *HEX_CHARS = "0123456789abcdef";
 
-int main() {
+/**
+ * The previous, switch-based decoder, as a reference for the benchmark.
+ * buf[:(bufsize/4)*4+4] must be writable; the result is written to buf.
+ */
+static uint32_t base64_decode_switch(uint8_t *buf, uint32_t bufsize) {
+    // fix the padding
+    while (bufsize % 4) { buf[bufsize++] = '='; }
+
+    uint8_t *result = buf;
+    uint32_t resultsize = 0;
+    uint8_t *end = &buf[bufsize];
+
+    while (buf != end) {
+        // decode one quadruplet, write one triplet to result
+        uint32_t word_value = 0;
+        uint32_t word_chars = 3;
+
+        for (uint32_t i = 0; i < 4; i++) {
+            uint32_t value = 0;
+
+            switch (buf[i]) {
+            case 'A' ... 'Z': value =  0 + buf[i] - 'A'; break;
+            case 'a' ... 'z': value = 26 + buf[i] - 'a'; break;
+            case '0' ... '9': value = 52 + buf[i] - '0'; break;
+            case '+':         value = 62;                break;
+            case '/':         value = 63;                break;
+            case '=':
+                {
+                    if (i == 2) {
+                        if (buf[i + 1] != '=') { return 0; }
+                        word_chars = 1;
+                        i = 3;
+                    } else if (i == 3) {
+                        word_chars = 2;
+                    } else {
+                        return 0;
+                    }
+                }
+                break;
+            default:          return 0;
+            }
+
+            word_value |= (value << (6 * (3 - i)));
+        }
+
+        result[resultsize++] = (uint8_t)(word_value >> 16);
+        if (word_chars > 1) {
+            result[resultsize++] = (uint8_t)(word_value >> 8);
+        }
+        if (word_chars > 2) {
+            result[resultsize++] = (uint8_t)(word_value);
+        }
+        buf += 4;
+    }
+
+    return resultsize;
+}
+
+/**
+ * Reads one base64 string per line from stdin, and compares the
+ * throughput of the switch-based and the table-based decoder.
+ */
+static int run_benchmark() {
+    std::vector<std::string> inputs;
+    std::string line;
+    size_t total_size = 0;
+    while (1) {
+        int c = getchar();
+        if (c < 0) { break; }
+        if (c == '\n') {
+            total_size += line.size();
+            inputs.push_back(line);
+            line.clear();
+        } else {
+            line.push_back(static_cast<char>(c));
+        }
+    }
+
+    std::vector<uint8_t> buf;
+    const uint32_t rounds = 10;
+
+    double switch_s = 0;
+    for (uint32_t round = 0; round < rounds; round++) {
+        for (const std::string &input : inputs) {
+            buf.assign(input.begin(), input.end());
+            buf.resize(input.size() + 4);
+
+            auto start = std::chrono::steady_clock::now();
+            base64_decode_switch(buf.data(), input.size());
+            auto end = std::chrono::steady_clock::now();
+            switch_s += std::chrono::duration<double>(end - start).count();
+        }
+    }
+
+    double table_s = 0;
+    for (uint32_t round = 0; round < rounds; round++) {
+        for (const std::string &input : inputs) {
+            buf.assign(input.begin(), input.end());
+
+            auto start = std::chrono::steady_clock::now();
+            base64_decode(buf.data(), buf.size(), buf.data(), buf.size(), BASE64_STANDARD);
+            auto end = std::chrono::steady_clock::now();
+            table_s += std::chrono::duration<double>(end - start).count();
+        }
+    }
+
+    double megabytes = static_cast<double>(total_size) * rounds / 1e6;
+    printf("%lu base64 strings, %lu characters\n", inputs.size(), total_size);
+    printf("switch %8.2f MB/s\n", megabytes / switch_s);
+    printf("table  %8.2f MB/s\n", megabytes / table_s);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    enum base64_alphabet alphabet = BASE64_STANDARD;
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0) {
+        return run_benchmark();
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--urlsafe") == 0) {
+        alphabet = BASE64_URLSAFE;
+    }
+
     std::vector<uint8_t> buf;
 
     while (1) {
@@ -19,12 +143,13 @@ int main() {
         }
     }
 
-    //const char *input = "YWJjZGVmZ2hpCmFiY2RlZmdoaQphYmNkZWZnaGkKYWJjZGVmZ2hpCmFiY2RlZmdoaQphYmNkZWZnCg==";
-    //while (*input) { buf.push_back(*(input++)); }
-
-    uint32_t size = base64_decode(buf.data(), buf.size());
+    std::vector<uint8_t> result(buf.size());
+    int32_t size = base64_decode(buf.data(), buf.size(), result.data(), result.size(), alphabet);
+    if (size < 0) {
+        return 1;
+    }
 
-    fwrite(buf.data(), size, 1, stdout);
+    fwrite(result.data(), size, 1, stdout);
 
     return 0;
 }
@@ -0,0 +1,215 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "pin.h"
+#include "tone_sequencer.h"
+
+uint64_t pin_time = 0;
+std::vector<PinChange> pin_changes;
+
+// the blocking beeper implementation, with simulated time
+namespace blocking {
+
+static void sleep_us(uint64_t duration_us) {
+    pin_time += duration_us;
+}
+
+static void beep(OutputPin &pin, uint32_t period_us, uint32_t duration_us) {
+    uint32_t num_periods = duration_us / period_us;
+
+    while (num_periods--) {
+        pin.high();
+        sleep_us(period_us/2);
+        pin.low();
+        sleep_us(period_us/2);
+    }
+}
+
+static void pattern(OutputPin &pin, uint32_t period_a_us, uint32_t period_b_us, uint32_t pause_us, uint32_t beeps) {
+    while (beeps--) {
+        beep(pin, period_a_us, 10000);
+
+        uint32_t tmp = period_a_us;
+        period_a_us = period_b_us;
+        period_b_us = tmp;
+
+        if (beeps) {
+            sleep_us(pause_us);
+        }
+    }
+}
+
+static void error(OutputPin &pin, uint32_t code) {
+    while (code--) {
+        pattern(pin, 1000000/152, 1000000/900, 1000, 10);
+        sleep_us(200000);
+    }
+}
+
+}
+
+/**
+ * Plays everything that is queued, like the PWM timer: each period is
+ * high for high_us, then low. Returns the number of periods, i.e. the
+ * number of timer interrupts.
+ */
+static uint32_t play(ToneSequencer &sequencer, OutputPin &pin) {
+    uint32_t periods = 0;
+    uint32_t period_us;
+    uint32_t high_us;
+    while (sequencer.next_period(period_us, high_us)) {
+        if (period_us == 0 || period_us > ToneSequencer::MAX_PERIOD_US || high_us >= period_us) {
+            printf("period doesn't fit into the timer\n");
+            return 0;
+        }
+        if (high_us) { pin.high(); }
+        pin_time += high_us;
+        pin.low();
+        pin_time += period_us - high_us;
+        periods += 1;
+    }
+    return periods;
+}
+
+static bool same_changes(const std::vector<PinChange> &a, const std::vector<PinChange> &b) {
+    if (a.size() != b.size()) { return false; }
+    for (uint32_t i = 0; i < a.size(); i++) {
+        if (a[i].time != b[i].time || a[i].value != b[i].value) { return false; }
+    }
+    return true;
+}
+
+/** the sequencer must produce the same waveforms as the blocking beeper */
+static bool test_waveforms() {
+    for (uint32_t code = 1; code <= 9; code++) {
+        OutputPin pin;
+        pin_time = 1000;
+        pin_changes.clear();
+        blocking::error(pin, code);
+        std::vector<PinChange> expected = pin_changes;
+        uint64_t expected_end = pin_time;
+
+        ToneSequencer sequencer;
+        pin_time = 1000;
+        pin_changes.clear();
+        sequencer.enqueue(tones::error(code));
+        play(sequencer, pin);
+
+        if (!same_changes(pin_changes, expected) || pin_time != expected_end || sequencer.busy()) {
+            printf("waveform of error(%u) is wrong\n", code);
+            return false;
+        }
+    }
+
+    const char *names[] = {"party()", "good()", "startup", "beep()"};
+    for (uint32_t i = 0; i < 4; i++) {
+        OutputPin pin;
+        pin_time = 0;
+        pin_changes.clear();
+        TonePattern pattern;
+        if (i == 0) {
+            blocking::pattern(pin, 1000000/152, 1000000/900, 100000, 10);
+            pattern = tones::party(10);
+        } else if (i == 1) {
+            blocking::beep(pin, 1000000/152, 1000000);
+            pattern = tones::good(1000000);
+        } else if (i == 2) {
+            blocking::pattern(pin, 1000000/200, 1000000/150, 100000, 5);
+            pattern = tones::startup();
+        } else {
+            blocking::beep(pin, 1111, 12345);
+            pattern = tones::beep(1111, 12345);
+        }
+        std::vector<PinChange> expected = pin_changes;
+
+        ToneSequencer sequencer;
+        pin_time = 0;
+        pin_changes.clear();
+        sequencer.enqueue(pattern);
+        play(sequencer, pin);
+
+        if (!same_changes(pin_changes, expected)) {
+            printf("waveform of %s is wrong\n", names[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** queued patterns are played one after the other, like blocking calls */
+static bool test_queue() {
+    OutputPin pin;
+    pin_time = 0;
+    pin_changes.clear();
+    blocking::error(pin, 2);
+    blocking::beep(pin, 1000000/152, 10000);
+    blocking::pattern(pin, 1000000/152, 1000000/900, 100000, 3);
+    std::vector<PinChange> expected = pin_changes;
+
+    ToneSequencer sequencer;
+    pin_time = 0;
+    pin_changes.clear();
+    sequencer.enqueue(tones::error(2));
+    sequencer.enqueue(tones::good(10000));
+    sequencer.enqueue(tones::party(3));
+    if (!sequencer.busy()) {
+        printf("sequencer with queued patterns is not busy\n");
+        return false;
+    }
+    play(sequencer, pin);
+
+    if (!same_changes(pin_changes, expected) || sequencer.busy()) {
+        printf("waveform of queued patterns is wrong\n");
+        return false;
+    }
+
+    // a full queue rejects patterns
+    for (uint32_t i = 0; i < ToneSequencer::QUEUE_SIZE; i++) {
+        if (!sequencer.enqueue(tones::good(10000))) {
+            printf("queue is too short\n");
+            return false;
+        }
+    }
+    if (sequencer.enqueue(tones::good(10000))) {
+        printf("full queue accepts a pattern\n");
+        return false;
+    }
+    return true;
+}
+
+/** the CPU time: the blocking beeper vs. one interrupt per PWM period */
+static void benchmark() {
+    const char *names[] = {"good(1000000)", "error(3)", "party(10)"};
+    for (uint32_t i = 0; i < 3; i++) {
+        OutputPin pin;
+        pin_time = 0;
+        if (i == 0) {
+            blocking::beep(pin, 1000000/152, 1000000);
+        } else if (i == 1) {
+            blocking::error(pin, 3);
+        } else {
+            blocking::pattern(pin, 1000000/152, 1000000/900, 100000, 10);
+        }
+        uint64_t blocking_us = pin_time;
+
+        ToneSequencer sequencer;
+        sequencer.enqueue((i == 0) ? tones::good(1000000) : (i == 1) ? tones::error(3) : tones::party(10));
+        uint32_t interrupts = play(sequencer, pin);
+
+        printf("%-14s blocking %7.1f ms busy, PWM %4u interrupts\n", names[i], blocking_us / 1000.0, interrupts);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0) {
+        benchmark();
+        return 0;
+    }
+
+    if (!test_waveforms()) { return 1; }
+    if (!test_queue()) { return 1; }
+    return 0;
+}
@@ -0,0 +1 @@
+../src/binary_frame.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/binary_frame.h
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "binary_frame.h"
+#include "hmac.h"
+#include "secret_key.h"
+
+using namespace binary_frame;
+
+/** the same as encode_frame() in bridge/serial_server.py */
+static std::vector<uint8_t> encode(const std::vector<uint8_t> &message) {
+    std::vector<uint8_t> body;
+    body.push_back(static_cast<uint8_t>(message.size()));
+    body.insert(body.end(), message.begin(), message.end());
+    uint16_t crc = crc16(body.data(), body.size());
+    body.push_back(static_cast<uint8_t>(crc));
+    body.push_back(static_cast<uint8_t>(crc >> 8));
+
+    std::vector<uint8_t> frame{START};
+    std::vector<uint8_t> block;
+    for (uint8_t byte : body) {
+        if (byte != 0) { block.push_back(byte); }
+        if (byte == 0 || block.size() == 254) {
+            frame.push_back(static_cast<uint8_t>(byte == 0 ? block.size() + 1 : 0xff));
+            frame.insert(frame.end(), block.begin(), block.end());
+            block.clear();
+        }
+    }
+    frame.push_back(static_cast<uint8_t>(block.size() + 1));
+    frame.insert(frame.end(), block.begin(), block.end());
+    frame.push_back(END);
+    return frame;
+}
+
+/** decodes a whole frame, as the UARTRxFramer passes it on, but for END */
+static bool decode(std::vector<uint8_t> frame, std::vector<uint8_t> &message) {
+    const uint8_t *data;
+    uint32_t size;
+    if (!binary_frame_decode(frame.data() + 1, frame.size() - 2, data, size)) { return false; }
+    message.assign(data, data + size);
+    return true;
+}
+
+static std::vector<uint8_t> random_message(uint32_t size) {
+    std::vector<uint8_t> message;
+    for (uint32_t i = 0; i < size; i++) {
+        // plenty of zeros
+        message.push_back((std::rand() % 4 == 0) ? 0 : static_cast<uint8_t>(std::rand()));
+    }
+    return message;
+}
+
+static bool test_crc() {
+    // the check value of CRC-16/CCITT-FALSE
+    return crc16(reinterpret_cast<const uint8_t *>("123456789"), 9) == 0x29b1;
+}
+
+static bool test_bridge() {
+    // encoded by bridge/serial_server.py
+    std::vector<uint8_t> message{0x00, 0x0a, 0x0d, 0xa5, 0x11, 0x00, 0xff};
+    std::vector<uint8_t> frame{0xa5, 0x02, 0x07, 0x05, 0x0a, 0x0d, 0xa5, 0x11, 0x04, 0xff, 0xce, 0x6d, 0x00};
+    std::vector<uint8_t> decoded;
+    return encode(message) == frame && decode(frame, decoded) && decoded == message;
+}
+
+static bool test_round_trip() {
+    std::vector<uint8_t> decoded;
+    for (uint32_t size = 0; size <= MAX_MESSAGE_SIZE; size++) {
+        std::vector<uint8_t> message = random_message(size);
+        std::vector<uint8_t> frame = encode(message);
+        // a frame of the largest message fits into a UARTRxBuffer
+        if (frame.size() > 256 || !decode(frame, decoded) || decoded != message) {
+            printf("message of %u bytes wrong\n", size);
+            return false;
+        }
+        // no 0 but at the end, so the framing can't be lost
+        if (std::memchr(frame.data(), 0, frame.size() - 1) != nullptr) { return false; }
+    }
+
+    // without zeros, a block of 254 bytes has no 0 after it
+    std::vector<uint8_t> message(MAX_MESSAGE_SIZE, 0x42);
+    return decode(encode(message), decoded) && decoded == message;
+}
+
+static bool test_corruption() {
+    std::vector<uint8_t> decoded;
+    for (uint32_t size = 0; size <= MAX_MESSAGE_SIZE; size += 7) {
+        std::vector<uint8_t> message = random_message(size);
+        std::vector<uint8_t> frame = encode(message);
+
+        // any bit error in the data, even where it makes a 0 of a byte
+        for (uint32_t i = 1; i < frame.size() - 1; i++) {
+            for (uint32_t bit = 0; bit < 8; bit++) {
+                std::vector<uint8_t> corrupted = frame;
+                corrupted[i] ^= static_cast<uint8_t>(1 << bit);
+                if (decode(corrupted, decoded) && decoded != message) {
+                    printf("bit %u of byte %u accepted in a frame of %u bytes\n", bit, i, size);
+                    return false;
+                }
+            }
+        }
+
+        // a lost byte, since the framing would be off
+        for (uint32_t i = 1; i < frame.size() - 1; i++) {
+            std::vector<uint8_t> shortened = frame;
+            shortened.erase(shortened.begin() + i);
+            if (decode(shortened, decoded)) { return false; }
+        }
+    }
+
+    // the message is too long
+    std::vector<uint8_t> message = random_message(MAX_MESSAGE_SIZE + 1);
+    return !decode(encode(message), decoded);
+}
+
+/**
+ * The time that the door takes to reject a corrupted frame by its CRC,
+ * and to calculate the HMAC of the message in it
+ */
+static void benchmark() {
+    const uint32_t rounds = 100000;
+    HMACContext hmac_context(SECRET_KEY);
+
+    for (uint32_t size : {28, 52, 192}) {
+        std::vector<uint8_t> frame = encode(random_message(size));
+        // the CRC is wrong, so the whole frame is decoded before it is rejected
+        frame[frame.size() - 2] ^= 0x10;
+        std::vector<uint8_t> work;
+        const uint8_t *data;
+        uint32_t message_size;
+        uint32_t accepted = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < rounds; i++) {
+            work = frame;
+            accepted += binary_frame_decode(work.data() + 1, work.size() - 2, data, message_size);
+        }
+        auto end = std::chrono::steady_clock::now();
+        double reject_ns = std::chrono::duration<double, std::nano>(end - start).count() / rounds;
+
+        std::vector<uint8_t> message = random_message(size);
+        uint8_t digest[32];
+        start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < rounds; i++) {
+            message[0] = static_cast<uint8_t>(i);
+            hmac_context.calculate(message.data() + HMAC_SIZE, size - HMAC_SIZE, digest);
+        }
+        end = std::chrono::steady_clock::now();
+        double hmac_ns = std::chrono::duration<double, std::nano>(end - start).count() / rounds;
+
+        printf(
+            "%3u bytes: rejected by CRC in %.0f ns (%u accepted), HMAC %.0f ns\n",
+            size, reject_ns, accepted, hmac_ns
+        );
+    }
+}
+
+/** checks the binary frames against the bridge's encoder, and their CRC */
+int main(int argc, char **argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0) {
+        benchmark();
+        return 0;
+    }
+
+    if (!test_crc()) {
+        printf("CRC-16 wrong\n");
+        return 1;
+    }
+    if (!test_bridge()) {
+        printf("binary frame differs from the bridge's\n");
+        return 1;
+    }
+    if (!test_round_trip()) {
+        printf("binary frame round trip wrong\n");
+        return 1;
+    }
+    if (!test_corruption()) {
+        printf("corrupted binary frame accepted\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1 @@
+../src/calibration.cpp
\ No newline at end of file
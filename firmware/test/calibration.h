@@ -0,0 +1 @@
+../src/calibration.h
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "calibration.h"
+
+static MotorCalibration example() {
+    MotorCalibration calibration = {};
+    calibration.magic = MotorCalibration::MAGIC;
+    calibration.entry_count = 3;
+    calibration.entries[0] = {1, 1, 0, 3100000, 900000, 2950000, 860000};
+    calibration.entries[1] = {4, 1, 0, 3120000, 780000, 2960000, 750000};
+    calibration.entries[2] = {16, 0, 0, 0, 0, 0, 0};
+    calibration.crc = calibration_crc(calibration);
+    return calibration;
+}
+
+static bool test_record() {
+    MotorCalibration calibration = example();
+    if (!calibration_valid(calibration)) {
+        printf("valid record is rejected\n");
+        return false;
+    }
+
+    // erased flash
+    MotorCalibration erased;
+    memset(&erased, 0xff, sizeof(erased));
+    if (calibration_valid(erased)) {
+        printf("erased record is accepted\n");
+        return false;
+    }
+
+    // every flipped bit is detected
+    for (uint32_t i = 0; i < sizeof(MotorCalibration) * 8; i++) {
+        MotorCalibration corrupted = calibration;
+        reinterpret_cast<uint8_t *>(&corrupted)[i / 8] ^= 1 << (i % 8);
+        if (calibration_valid(corrupted)) {
+            printf("record with flipped bit %u is accepted\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool test_door_travel() {
+    MotorCalibration calibration = example();
+    DoorTravel travel;
+    // the fastest mode that worked, plus the margin
+    if (!calibration_door_travel(calibration, travel)
+        || travel.microsteps_per_step != 4
+        || travel.open_urevs != 3120000 + 195000
+        || travel.close_urevs != 2960000 + 185000) {
+        printf("wrong door travel\n");
+        return false;
+    }
+
+    calibration.entries[0].ok = 0;
+    calibration.entries[1].ok = 0;
+    calibration.crc = calibration_crc(calibration);
+    if (calibration_door_travel(calibration, travel)) {
+        printf("door travel without a working mode\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--crc32") == 0) {
+        // the CRC-32 of stdin
+        std::vector<uint8_t> data;
+        int c;
+        while ((c = getchar()) != EOF) { data.push_back(c); }
+        printf("%08x\n", crc32(data.data(), data.size()));
+        return 0;
+    }
+
+    if (!test_record()) { return 1; }
+    if (!test_door_travel()) { return 1; }
+    return 0;
+}
@@ -0,0 +1 @@
+../src/clock_discipline.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/clock_discipline.h
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "clock_discipline.h"
+
+/**
+ * The HSE crystal that the monotonic time is counted from, with a rate
+ * error which changes with the temperature.
+ */
+class SimulatedCrystal {
+public:
+    SimulatedCrystal(double rate_error_ppm, double temperature_ppm)
+        : rate_error_ppm(rate_error_ppm), temperature_ppm(temperature_ppm) {}
+
+    /** lets the true time pass, in steps of at most a second */
+    void advance(uint64_t duration_us) {
+        while (duration_us > 0) {
+            uint64_t step = duration_us < 1000000 ? duration_us : 1000000;
+            this->monotonic_exact += step * (1 + this->ppm() * 1e-6);
+            this->true_us += step;
+            duration_us -= step;
+        }
+    }
+
+    /** the current rate error; a day-night cycle of the temperature */
+    double ppm() const {
+        return this->rate_error_ppm + this->temperature_ppm * std::sin(this->true_us * 2 * M_PI / 86400e6);
+    }
+
+    /** the monotonic time offset_us from now, for offsets of a few ms */
+    uint64_t monotonic_us(double offset_us = 0) const {
+        return static_cast<uint64_t>(this->monotonic_exact + offset_us * (1 + this->ppm() * 1e-6));
+    }
+
+    uint64_t true_us = 1546300800ULL * 1000000;
+
+private:
+    double rate_error_ppm;
+    double temperature_ppm;
+    double monotonic_exact = 123456789;
+};
+
+static uint64_t difference(uint64_t a, uint64_t b) {
+    return (a > b) ? a - b : b - a;
+}
+
+/** the estimate now must be within its uncertainty of the true time */
+static bool check(const ClockDiscipline &discipline, const SimulatedCrystal &crystal, const char *when,
+                  uint64_t &uncertainty_us) {
+    uint64_t monotonic_us = crystal.monotonic_us();
+    uncertainty_us = discipline.uncertainty_us(monotonic_us);
+    uint64_t error_us = difference(discipline.unix_us(monotonic_us), crystal.true_us);
+    if (error_us > uncertainty_us) {
+        printf("%s: off by %llu us, uncertainty %llu us\n", when,
+               (unsigned long long)error_us, (unsigned long long)uncertainty_us);
+        return false;
+    }
+    return true;
+}
+
+/** a minute mark as the DCF77 receiver reports it; late or early by up to 15 ms */
+static void minute_mark(ClockDiscipline &discipline, const SimulatedCrystal &crystal, std::mt19937_64 &rng) {
+    std::uniform_real_distribution<double> jitter_us(-15000, 15000);
+    discipline.synchronize(crystal.monotonic_us(jitter_us(rng)), crystal.true_us, 20000);
+}
+
+/**
+ * Synchronizes once a minute, with a few minutes lost to noise, then
+ * checks the time after outages of increasing length, for crystals with
+ * different rate errors.
+ */
+static bool test_outages(bool verbose) {
+    const double rate_errors_ppm[] = {-45, -12, 0, 3, 27, 49};
+    const uint64_t outages_s[] = {60, 600, 3600, 4 * 3600, 10 * 3600, 86400};
+    std::mt19937_64 rng(22);
+
+    if (verbose) {
+        printf("rate error  estimate     uncertainty after: 1 min    10 min   1 h      4 h      10 h     1 day\n");
+    }
+    for (double rate_error_ppm : rate_errors_ppm) {
+        SimulatedCrystal crystal(rate_error_ppm, 1);
+        ClockDiscipline discipline;
+        crystal.advance(rng() % 1000000000);
+
+        // two days of reception; the error between the minute marks is
+        // what the smoothing of the phase is about
+        double squared_error_us = 0;
+        uint32_t samples = 0;
+        for (uint32_t minute = 0; minute < 2 * 1440; minute++) {
+            if (rng() % 16 != 0) { minute_mark(discipline, crystal, rng); }
+            uint64_t uncertainty_us;
+            crystal.advance(30000000);
+            if (!check(discipline, crystal, "between synchronizations", uncertainty_us)) { return false; }
+            if (minute >= 1440) {
+                double error_us = double(discipline.unix_us(crystal.monotonic_us())) - double(crystal.true_us);
+                squared_error_us += error_us * error_us;
+                samples += 1;
+            }
+            crystal.advance(30000000);
+        }
+        if (!discipline.rate_known()) {
+            printf("%+.0f ppm: the rate hasn't been measured\n", rate_error_ppm);
+            return false;
+        }
+        double rate_error = discipline.rate_ppb() / 1000.0 - crystal.ppm();
+        if (std::fabs(rate_error) * 1000 > discipline.rate_uncertainty_ppb()) {
+            printf("%+.0f ppm: rate %d ppb, off by more than %u ppb\n", rate_error_ppm,
+                   discipline.rate_ppb(), discipline.rate_uncertainty_ppb());
+            return false;
+        }
+        if (verbose) {
+            printf("%+5.0f ppm   %+8.3f ppm, rms %5.2f ms        ", rate_error_ppm, discipline.rate_ppb() / 1000.0,
+                   std::sqrt(squared_error_us / samples) / 1000);
+        }
+
+        for (uint64_t outage_s : outages_s) {
+            ClockDiscipline held = discipline;
+            SimulatedCrystal later = crystal;
+            later.advance(outage_s * 1000000);
+            uint64_t uncertainty_us;
+            if (!check(held, later, "after an outage", uncertainty_us)) { return false; }
+            if (verbose) { printf("%8.3f ", uncertainty_us / 1e6); }
+            // the rate is known to 3 ppm, instead of the 50 ppm tolerance
+            // of the crystal
+            if (uncertainty_us > 25000 + outage_s * 3) {
+                printf("%+.0f ppm: %llu us after an outage of %llu s\n", rate_error_ppm,
+                       (unsigned long long)uncertainty_us, (unsigned long long)outage_s);
+                return false;
+            }
+
+            // the next minute mark is taken over without starting over; the
+            // fit is good to about 1 ppm
+            minute_mark(held, later, rng);
+            if (!held.rate_known() || held.rate_uncertainty_ppb() > ClockDiscipline::TEMPERATURE_DRIFT_PPB + 1500) {
+                printf("%+.0f ppm: the rate has been lost after an outage of %llu s\n", rate_error_ppm,
+                       (unsigned long long)outage_s);
+                return false;
+            }
+        }
+        if (verbose) { printf("s\n"); }
+    }
+    return true;
+}
+
+/**
+ * The first minutes, before the rate is known, the time from the RTC,
+ * and a wrong synchronization.
+ */
+static bool test_recovery() {
+    std::mt19937_64 rng(23);
+    SimulatedCrystal crystal(-40, 0);
+    ClockDiscipline discipline;
+    uint64_t uncertainty_us;
+    if (discipline.uncertainty_us(crystal.monotonic_us()) != UINT64_MAX) { return false; }
+    if (discipline.unix_us(1234) != 1234) { return false; }
+
+    // the time from the RTC is replaced by the first minute mark
+    discipline.set(crystal.monotonic_us(), crystal.true_us - 300000, 400000);
+    crystal.advance(60000000);
+    if (!check(discipline, crystal, "after the RTC", uncertainty_us)) { return false; }
+    minute_mark(discipline, crystal, rng);
+    if (discipline.uncertainty_us(crystal.monotonic_us()) > 20010) { return false; }
+
+    // with an unknown rate
+    for (uint32_t minute = 0; minute < 60; minute++) {
+        crystal.advance(60000000);
+        if (!check(discipline, crystal, "in the first hour", uncertainty_us)) { return false; }
+        minute_mark(discipline, crystal, rng);
+    }
+    if (!discipline.rate_known()) { return false; }
+
+    // a time-set message that agrees keeps the rate, one that doesn't forgets it
+    crystal.advance(60000000);
+    ClockDiscipline kept = discipline;
+    kept.set(crystal.monotonic_us(), crystal.true_us + 1500000, 2000000);
+    if (!kept.rate_known() || !check(kept, crystal, "after a time-set message", uncertainty_us)) { return false; }
+    kept.set(crystal.monotonic_us(), crystal.true_us + 3600000000ULL, 2000000);
+    if (kept.rate_known()) { return false; }
+
+    // a wrong time is taken over, and replaced by the next right one
+    crystal.advance(60000000);
+    discipline.synchronize(crystal.monotonic_us(), crystal.true_us + 3600000000ULL, 20000);
+    if (discipline.rate_known()) { return false; }
+    crystal.advance(60000000);
+    minute_mark(discipline, crystal, rng);
+    crystal.advance(600000000);
+    return check(discipline, crystal, "after a wrong synchronization", uncertainty_us);
+}
+
+/**
+ * Checks the disciplined time against a simulated crystal; with --stats,
+ * prints the estimated rates and the uncertainties after outages of the
+ * synchronization.
+ */
+int main(int argc, char **argv) {
+    bool verbose = argc > 1 && std::strcmp(argv[1], "--stats") == 0;
+    if (!test_recovery()) {
+        printf("the time isn't recovered\n");
+        return 1;
+    }
+    if (!test_outages(verbose)) { return 1; }
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "monotonic_clock.h"
+
+// the simulated time in us; the counter is its lower 16 bits
+static std::atomic<uint64_t> true_time{0};
+
+// called when the counter is read, e.g. to interrupt a read
+static void (*counter_hook)() = nullptr;
+
+struct FakeCounter {
+    static uint16_t read() {
+        if (counter_hook != nullptr) {
+            void (*hook)() = counter_hook;
+            counter_hook = nullptr;
+            hook();
+        }
+        return static_cast<uint16_t>(true_time.load());
+    }
+};
+
+static MonotonicClock<FakeCounter> *hook_clock;
+
+/** SysTick, delayed by a long interrupt: 70 ms pass, with two updates */
+static void long_interrupt() {
+    true_time += 35000;
+    hook_clock->update();
+    true_time += 35000;
+    hook_clock->update();
+}
+
+/**
+ * A read that is interrupted after it has read the anchor, before it
+ * reads the counter; the anchor it has read is more than one counter
+ * overflow old.
+ */
+static bool test_interrupted_read() {
+    MonotonicClock<FakeCounter> clock;
+    hook_clock = &clock;
+    true_time = 0;
+    clock.update();
+    for (uint32_t i = 0; i < 100; i++) {
+        true_time += 700;
+        clock.update();
+        true_time += 300;
+
+        counter_hook = long_interrupt;
+        uint64_t now = clock.now();
+        if (now != true_time) {
+            printf("interrupted read is %llu, true time %llu\n",
+                   (unsigned long long)now, (unsigned long long)true_time.load());
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * The writer advances the time and updates the clock, like SysTick;
+ * the readers check that the clock is monotonic and between the true
+ * time before and after each read.
+ */
+static bool test_concurrent(uint64_t start_time) {
+    MonotonicClock<FakeCounter> clock;
+    true_time = 0;
+    clock.update();
+    // jump to the start time in steps that the clock can follow
+    while (true_time < start_time) {
+        uint64_t step = start_time - true_time;
+        true_time += (step > 60000) ? 60000 : step;
+        clock.update();
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<bool> ok{true};
+
+    std::vector<std::thread> readers;
+    for (uint32_t i = 0; i < 3; i++) {
+        readers.emplace_back([&clock, &done, &ok]() {
+            uint64_t last = 0;
+            while (!done) {
+                uint64_t before = true_time.load();
+                uint64_t now = clock.now();
+                uint64_t after = true_time.load();
+                if (now < before || now > after || now < last) {
+                    printf("clock read %llu, true time %llu..%llu, last read %llu\n",
+                           (unsigned long long)now, (unsigned long long)before,
+                           (unsigned long long)after, (unsigned long long)last);
+                    ok = false;
+                    return;
+                }
+                last = now;
+            }
+        });
+    }
+
+    // steps of up to 1 ms, with an update after each; sometimes the
+    // update comes late, after 60 ms.
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < 2000000 && ok; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t step = (seed >> 16) % 1000 + 1;
+        if (i % 10000 == 0) { step = 60000; }
+        true_time += step;
+        clock.update();
+    }
+
+    done = true;
+    for (std::thread &reader : readers) { reader.join(); }
+
+    if (ok && clock.updates() == 0) {
+        printf("the clock wasn't updated\n");
+        return false;
+    }
+    return ok;
+}
+
+/** the time a read takes, without contention */
+static void benchmark() {
+    MonotonicClock<FakeCounter> clock;
+    clock.update();
+    const uint32_t reads = 10000000;
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < reads; i++) { sum += clock.now(); }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    printf("MonotonicClock::now(): %.1f ns per read (%llu)\n", ns / reads, (unsigned long long)(sum & 1));
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0) {
+        benchmark();
+        return 0;
+    }
+
+    if (!test_interrupted_read()) { return 1; }
+
+    // from boot, and across the 32-bit boundary of the anchor
+    if (!test_concurrent(0)) { return 1; }
+    if (!test_concurrent(0xffff0000ULL)) { return 1; }
+    return 0;
+}
@@ -0,0 +1 @@
+../src/dcf77_combiner.cpp
\ No newline at end of file
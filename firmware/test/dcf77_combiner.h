@@ -0,0 +1 @@
+../src/dcf77_combiner.h
\ No newline at end of file
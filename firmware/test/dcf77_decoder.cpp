@@ -0,0 +1 @@
+../src/dcf77_decoder.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/dcf77_decoder.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/dcf77_edges.h
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+// synthetic DCF77 signals for the decoder tests
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <random>
+#include <vector>
+
+#include "dcf77_edges.h"
+
+/** the bits that are sent in the minute before unix_timestamp, which must be a full minute */
+inline std::vector<bool> dcf77_encode(uint64_t unix_timestamp, std::mt19937_64 &rng) {
+    // CET all year round, so that the UTC offset is fixed
+    time_t local = static_cast<time_t>(unix_timestamp + 3600);
+    struct tm t;
+    gmtime_r(&local, &t);
+
+    std::vector<bool> bits(59, false);
+    // the encrypted weather data looks random
+    for (uint32_t i = 1; i <= 14; i++) { bits[i] = rng() & 1; }
+    bits[18] = true;
+    bits[20] = true;
+
+    auto bcd = [&bits](uint32_t start, uint32_t length, uint32_t value) {
+        uint32_t encoded = (value / 10) << 4 | (value % 10);
+        for (uint32_t i = 0; i < length; i++) { bits[start + i] = (encoded >> i) & 1; }
+    };
+    auto parity = [&bits](uint32_t start, uint32_t end) {
+        bool result = false;
+        for (uint32_t i = start; i < end; i++) { result ^= bits[i]; }
+        bits[end] = result;
+    };
+    bcd(21, 7, t.tm_min);
+    parity(21, 28);
+    bcd(29, 6, t.tm_hour);
+    parity(29, 35);
+    bcd(36, 6, t.tm_mday);
+    bcd(42, 3, t.tm_wday == 0 ? 7 : t.tm_wday);
+    bcd(45, 5, t.tm_mon + 1);
+    bcd(50, 8, t.tm_year % 100);
+    parity(36, 58);
+    return bits;
+}
+
+/** what happens to the signal between the transmitter and the capture */
+struct DCF77Noise {
+    const char *name;
+    // the receiver lengthens the pulses by this much
+    int32_t width_bias_us;
+    // the standard deviations of the pulse widths and the pulse starts
+    double width_jitter_us;
+    double edge_jitter_us;
+    // spikes of either level, e.g. from the motor driver
+    double glitches_per_second;
+    uint32_t max_glitch_us;
+    // the share of the pulses that are lost, and that have the wrong width
+    double dropout_rate;
+    double bit_error_rate;
+};
+
+/**
+ * The edges of the minutes, of which the first starts at start_us. The
+ * signal is captured from listen_us on; it ends with the pulse that
+ * starts the minute after the last one.
+ */
+inline std::vector<DCF77Edge> dcf77_signal(
+    const std::vector<std::vector<bool>> &minutes, uint64_t start_us, uint64_t listen_us,
+    const DCF77Noise &noise, std::mt19937_64 &rng
+) {
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::normal_distribution<double> width_jitter(0, noise.width_jitter_us + 1e-9);
+    std::normal_distribution<double> edge_jitter(0, noise.edge_jitter_us + 1e-9);
+
+    // the times at which the level changes
+    std::vector<uint64_t> toggles;
+    auto pulse = [&](uint64_t second_us, bool bit) {
+        if (uniform(rng) < noise.dropout_rate) { return; }
+        if (uniform(rng) < noise.bit_error_rate) { bit = !bit; }
+        uint64_t rising = second_us + static_cast<int64_t>(edge_jitter(rng));
+        int64_t width = (bit ? 200000 : 100000) + noise.width_bias_us + static_cast<int64_t>(width_jitter(rng));
+        toggles.push_back(rising);
+        toggles.push_back(rising + std::max<int64_t>(width, 1000));
+    };
+    for (uint32_t minute = 0; minute < minutes.size(); minute++) {
+        for (uint32_t second = 0; second < minutes[minute].size(); second++) {
+            pulse(start_us + minute * 60000000ULL + second * 1000000ULL, minutes[minute][second]);
+        }
+    }
+    uint64_t end_us = start_us + minutes.size() * 60000000ULL;
+    toggles.push_back(end_us);
+    toggles.push_back(end_us + 100000);
+
+    if (noise.glitches_per_second > 0) {
+        std::exponential_distribution<double> interval(noise.glitches_per_second / 1e6);
+        std::uniform_int_distribution<uint32_t> duration(500, noise.max_glitch_us);
+        for (uint64_t time = start_us + interval(rng); time < end_us; time += interval(rng)) {
+            toggles.push_back(time);
+            toggles.push_back(time + duration(rng));
+        }
+    }
+
+    // two toggles at the same time cancel
+    std::sort(toggles.begin(), toggles.end());
+    std::vector<DCF77Edge> edges;
+    bool level = false;
+    for (uint32_t i = 0; i < toggles.size(); i++) {
+        if (i + 1 < toggles.size() && toggles[i] == toggles[i + 1]) {
+            i++;
+            continue;
+        }
+        level = !level;
+        if (toggles[i] >= listen_us) { edges.push_back({toggles[i], level}); }
+    }
+    return edges;
+}
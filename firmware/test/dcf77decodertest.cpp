@@ -0,0 +1,389 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "dcf77_analyze.h"
+#include "dcf77_decoder.h"
+#include "dcf77_edges.h"
+#include "dcf77_signal.h"
+
+static uint32_t seed = 1;
+
+/** a random offset of up to +-range us */
+static int32_t jitter(int32_t range) {
+    seed = seed * 1103515245 + 12345;
+    return static_cast<int32_t>((seed >> 8) % (2 * range + 1)) - range;
+}
+
+/** the edges of one minute that starts at start_us, with pulse widths off by up to 5 ms */
+static std::vector<DCF77Edge> minute_edges(const std::vector<bool> &bits, uint64_t start_us) {
+    std::vector<DCF77Edge> edges;
+    for (uint32_t second = 0; second < bits.size(); second++) {
+        uint64_t rising = start_us + second * 1000000ULL + jitter(500);
+        uint64_t width = (bits[second] ? 200000 : 100000) + jitter(5000);
+        edges.push_back({rising, true});
+        edges.push_back({rising + width, false});
+    }
+    return edges;
+}
+
+static bool test_capture_time() {
+    // the counter has wrapped around between the capture and now
+    if (capture_time(0x30005, 0xfff0) != 0x2fff0) { return false; }
+    if (capture_time(0x30005, 0x0005) != 0x30005) { return false; }
+    if (capture_time(0x3fff0, 0x0010) != 0x30010) { return false; }
+    return true;
+}
+
+static bool test_ring() {
+    DCF77EdgeRing ring;
+    DCF77Edge edge;
+    for (uint32_t i = 0; i < DCF77EdgeRing::SIZE; i++) {
+        if (!ring.push({i, (i & 1) != 0})) { return false; }
+    }
+    if (ring.push({99, false}) || ring.drops() != 1) { return false; }
+    for (uint32_t i = 0; i < DCF77EdgeRing::SIZE; i++) {
+        if (!ring.pop(edge) || edge.time_us != i) { return false; }
+    }
+    return !ring.pop(edge);
+}
+
+/**
+ * The decoder with fixed pulse windows that resets on every outlier, as
+ * it was before the adaptive classification; for comparison.
+ */
+class FixedWindowDecoder {
+public:
+    bool edge(const DCF77Edge &edge, uint64_t &minute_start_us, uint64_t &unix_timestamp) {
+        uint64_t time_delta = edge.time_us - this->last_time_us;
+        bool had_edge = this->have_edge;
+        bool level_changed = (edge.level != this->last_level);
+        this->have_edge = true;
+        this->last_level = edge.level;
+        this->last_time_us = edge.time_us;
+        if (!had_edge) { return false; }
+        if (!level_changed) {
+            this->rx_bitcount = 0;
+            return false;
+        }
+
+        if (edge.level) {
+            if ((time_delta > 700000) && (time_delta <= 1000000)) {
+            } else if ((time_delta >= 1700000) && (time_delta <= 2000000)) {
+                bool valid = dcf77_analyze(this->rx_bits, this->rx_bitcount, unix_timestamp);
+                this->rx_bitcount = 0;
+                if (valid) {
+                    minute_start_us = edge.time_us;
+                    return true;
+                }
+            } else {
+                this->rx_bitcount = 0;
+            }
+        } else {
+            if (this->rx_bitcount >= 60) { this->rx_bitcount = 0; }
+            if ((time_delta >= 30000) && (time_delta <= 135000)) {
+                this->rx_bits &= ~(DCF77Frame(1) << this->rx_bitcount++);
+            } else if ((time_delta >= 140000) && (time_delta <= 260000)) {
+                this->rx_bits |= DCF77Frame(1) << this->rx_bitcount++;
+            } else {
+                this->rx_bitcount = 0;
+            }
+        }
+        return false;
+    }
+
+private:
+    DCF77Frame rx_bits = 0;
+    uint8_t rx_bitcount = 0;
+    bool have_edge = false;
+    bool last_level = false;
+    uint64_t last_time_us = 0;
+};
+
+struct Score {
+    uint32_t minutes = 0;
+    uint32_t decoded = 0;
+    uint32_t wrong = 0;
+    uint32_t trains = 0;
+    // the time from the start of listening to the first correct minute
+    double first_minute_s = 0;
+};
+
+/** decodes a signal whose minute k starts at start_us + k min, at the time first_timestamp + k min */
+template <typename Decoder>
+static void evaluate(
+    const std::vector<DCF77Edge> &edges, uint64_t start_us, uint64_t listen_us,
+    uint64_t first_timestamp, uint32_t minute_count, Score &score
+) {
+    Decoder decoder;
+    uint64_t end_us = start_us + minute_count * 60000000ULL;
+    uint64_t first_us = end_us;
+
+    for (const DCF77Edge &edge : edges) {
+        uint64_t minute_start_us, unix_timestamp;
+        if (!decoder.edge(edge, minute_start_us, unix_timestamp)) { continue; }
+
+        uint64_t minute = (minute_start_us - start_us + 30000000) / 60000000;
+        int64_t offset_us = static_cast<int64_t>(minute_start_us - (start_us + minute * 60000000));
+        if (offset_us < -100000 || offset_us > 100000 || unix_timestamp != first_timestamp + 60 * minute) {
+            score.wrong += 1;
+            continue;
+        }
+        score.decoded += 1;
+        if (minute_start_us < first_us) { first_us = minute_start_us; }
+    }
+
+    for (uint32_t minute = 1; minute <= minute_count; minute++) {
+        if (start_us + minute * 60000000ULL > listen_us) { score.minutes += 1; }
+    }
+    score.trains += 1;
+    score.first_minute_s += (first_us - listen_us) / 1e6;
+}
+
+static const DCF77Noise noise_profiles[] = {
+    // name       bias   width  edge  glitches/s  glitch  dropout  BER
+    {"clean",        0,     0,     0,  0,           0,      0,       0},
+    {"jitter",       0, 12000,  2000,  0,           0,      0,       0},
+    {"slow",     45000, 10000,  2000,  0,           0,      0,       0},
+    {"fast",    -35000, 10000,  2000,  0,           0,      0,       0},
+    {"glitches",     0, 10000,  2000,  0.5,     15000,      0,       0},
+    {"dropouts",     0, 10000,  2000,  0,           0,   0.02,       0},
+    {"motor",    30000, 15000,  3000,  1.0,     20000,   0.01,       0},
+    {"errors",       0, 10000,  2000,  0,           0,      0,    0.03},
+};
+
+/**
+ * Decodes noisy signals of random times with both decoders, from a
+ * random start; the adaptive decoder must decode more minutes, without
+ * decoding wrong ones. It confirms each time by the next minute, and
+ * only trusts times from at least two minutes, so it may lose the first
+ * two minutes of each train.
+ */
+static bool noise_test(bool verbose) {
+    std::mt19937_64 rng(17);
+    bool ok = true;
+
+    for (const DCF77Noise &noise : noise_profiles) {
+        Score fixed, adaptive;
+        for (uint32_t train = 0; train < 50; train++) {
+            const uint32_t minute_count = 15;
+            // a minute in 2019-2029
+            uint64_t first_timestamp = (1546300800 + rng() % (10 * 365 * 86400ULL)) / 60 * 60;
+            std::vector<std::vector<bool>> minutes;
+            for (uint32_t minute = 0; minute < minute_count; minute++) {
+                minutes.push_back(dcf77_encode(first_timestamp + 60 * (minute + 1), rng));
+            }
+            uint64_t start_us = 1000000000ULL + rng() % 1000000000ULL;
+            uint64_t listen_us = start_us + rng() % 60000000;
+            std::vector<DCF77Edge> edges = dcf77_signal(minutes, start_us, listen_us, noise, rng);
+
+            evaluate<FixedWindowDecoder>(edges, start_us, listen_us, first_timestamp, minute_count, fixed);
+            evaluate<DCF77Decoder>(edges, start_us, listen_us, first_timestamp, minute_count, adaptive);
+        }
+
+        if (verbose) {
+            printf("%-9s fixed windows: %5.1f %% decoded, %2u wrong, first after %5.1f s;"
+                   " adaptive: %5.1f %% decoded, %2u wrong, first after %5.1f s\n",
+                   noise.name,
+                   100.0 * fixed.decoded / fixed.minutes, fixed.wrong, fixed.first_minute_s / fixed.trains,
+                   100.0 * adaptive.decoded / adaptive.minutes, adaptive.wrong, adaptive.first_minute_s / adaptive.trains);
+        }
+
+        bool clean = (noise.width_jitter_us == 0);
+        uint32_t confirmed = adaptive.decoded + 2 * adaptive.trains;
+        if (adaptive.wrong != 0 || confirmed < fixed.decoded || (!clean && confirmed <= fixed.decoded)) {
+            printf("%s: the adaptive decoder decodes %u minutes, %u wrong; the fixed windows decode %u\n",
+                   noise.name, adaptive.decoded, adaptive.wrong, fixed.decoded);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/**
+ * The soft bits of a frame, of which a share is wrong, and another share
+ * unknown. Wrong bits are as confident as right ones.
+ */
+static DCF77SoftFrame soft_frame(const std::vector<bool> &bits, double error_rate, double erasure_rate, std::mt19937_64 &rng) {
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::uniform_int_distribution<int> confidence(1, DCF77PulseClassifier::MAX_CONFIDENCE);
+    DCF77SoftFrame frame;
+    frame.bitcount = static_cast<uint8_t>(bits.size());
+    for (uint32_t i = 0; i < bits.size(); i++) {
+        bool bit = bits[i];
+        if (uniform(rng) < error_rate) { bit = !bit; }
+        frame.bits[i] = static_cast<int8_t>(bit ? confidence(rng) : -confidence(rng));
+        if (uniform(rng) < erasure_rate) { frame.bits[i] = 0; }
+    }
+    return frame;
+}
+
+struct SweepScore {
+    uint32_t minutes = 0;
+    uint32_t trusted = 0;
+    uint32_t wrong = 0;
+    // the minutes from the reboot to the first right time
+    double first_minutes = 0;
+};
+
+/**
+ * Decodes random times from frames with bit errors after a reboot, minute
+ * by minute (like the previous decoder) and with DCF77MinuteCombiner; the
+ * combiner must trust no wrong minute, more minutes from 1 % bit errors
+ * and the first one sooner from 5 %.
+ */
+static bool ber_sweep(bool verbose) {
+    const double error_rates[] = {0, 0.005, 0.01, 0.02, 0.03, 0.05, 0.07, 0.1, 0.15};
+    const uint32_t trains = 100;
+    const uint32_t minute_count = 30;
+    std::mt19937_64 rng(18);
+    bool ok = true;
+
+    if (verbose) {
+        printf("BER      single minutes: trusted  wrong  first    combined: trusted  wrong  first\n");
+    }
+    for (double error_rate : error_rates) {
+        SweepScore single, combined;
+        for (uint32_t train = 0; train < trains; train++) {
+            uint64_t first_timestamp = (1546300800 + rng() % (10 * 365 * 86400ULL)) / 60 * 60;
+            uint64_t start_us = 1000000000ULL + rng() % 1000000000ULL;
+            DCF77MinuteCombiner combiner;
+            uint32_t single_first = minute_count, combined_first = minute_count;
+
+            for (uint32_t minute = 1; minute <= minute_count; minute++) {
+                uint64_t timestamp = first_timestamp + 60 * minute;
+                DCF77SoftFrame frame = soft_frame(dcf77_encode(timestamp, rng), error_rate, error_rate / 2, rng);
+
+                DCF77Frame bits = 0, erasures = 0;
+                for (uint32_t i = 0; i < frame.bitcount; i++) {
+                    if (frame.bits[i] > 0) { bits |= DCF77Frame(1) << i; }
+                    if (frame.bits[i] == 0) { erasures |= DCF77Frame(1) << i; }
+                }
+                uint64_t decoded;
+                if (dcf77_resolve_erasures(bits, erasures, frame.bitcount) && dcf77_analyze(bits, frame.bitcount, decoded)) {
+                    if (decoded != timestamp) {
+                        single.wrong += 1;
+                    } else {
+                        single.trusted += 1;
+                        if (minute < single_first) { single_first = minute; }
+                    }
+                }
+
+                if (combiner.add(frame, start_us + minute * 60000000ULL, decoded)) {
+                    if (decoded != timestamp) {
+                        combined.wrong += 1;
+                    } else {
+                        combined.trusted += 1;
+                        if (minute < combined_first) { combined_first = minute; }
+                    }
+                }
+            }
+            single.minutes += minute_count;
+            combined.minutes += minute_count;
+            single.first_minutes += single_first;
+            combined.first_minutes += combined_first;
+        }
+
+        if (verbose) {
+            printf("%5.1f %%                  %5.1f %%  %5u  %4.1f min         %5.1f %%  %5u  %4.1f min\n",
+                   100 * error_rate,
+                   100.0 * single.trusted / single.minutes, single.wrong, single.first_minutes / trains,
+                   100.0 * combined.trusted / combined.minutes, combined.wrong, combined.first_minutes / trains);
+        }
+
+        // it waits for a second frame, which only pays off with poor reception
+        bool more = error_rate < 0.01 || combined.trusted > single.trusted;
+        bool sooner = error_rate < 0.05 || combined.first_minutes < single.first_minutes;
+        if (combined.wrong != 0 || !more || !sooner) {
+            printf("BER %.3f: the combiner trusts %u minutes, %u wrong; single minutes %u\n",
+                   error_rate, combined.trusted, combined.wrong, single.trusted);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/**
+ * Reads one minute of bits per line, like dcf77test, and prints the
+ * decoded time at the start of each following minute.
+ *
+ * With --noise, compares the decoders on noisy synthetic signals, and
+ * with --ber, the single-minute and the combined decoding on frames with
+ * bit errors; --noise-stats and --ber-stats also print the figures.
+ */
+int main(int argc, char **argv) {
+    if (argc > 1 && (std::strcmp(argv[1], "--noise") == 0 || std::strcmp(argv[1], "--noise-stats") == 0)) {
+        return noise_test(std::strcmp(argv[1], "--noise-stats") == 0) ? 0 : 1;
+    }
+    if (argc > 1 && (std::strcmp(argv[1], "--ber") == 0 || std::strcmp(argv[1], "--ber-stats") == 0)) {
+        return ber_sweep(std::strcmp(argv[1], "--ber-stats") == 0) ? 0 : 1;
+    }
+
+    if (!test_capture_time()) {
+        printf("capture_time failed\n");
+        return 1;
+    }
+    if (!test_ring()) {
+        printf("ring failed\n");
+        return 1;
+    }
+
+    std::vector<std::vector<bool>> minutes;
+    std::vector<bool> bits;
+    int c;
+    while ((c = getchar()) != EOF) {
+        if (c == '0' || c == '1') { bits.push_back(c == '1'); }
+        if (c == '\n') {
+            minutes.push_back(bits);
+            bits.clear();
+        }
+    }
+
+    // one continuous signal; the rising edge of each minute's first
+    // second ends the previous minute
+    std::vector<DCF77Edge> edges;
+    std::vector<uint64_t> minute_starts;
+    uint64_t start_us = 12345678;
+    for (const std::vector<bool> &minute : minutes) {
+        std::vector<DCF77Edge> this_minute = minute_edges(minute, start_us);
+        edges.insert(edges.end(), this_minute.begin(), this_minute.end());
+        start_us += 60000000;
+        minute_starts.push_back(start_us);
+    }
+    edges.push_back({start_us, true});
+    edges.push_back({start_us + 100000, false});
+
+    // the decoder drains the ring now and then
+    DCF77Decoder decoder;
+    DCF77EdgeRing ring;
+    std::vector<uint64_t> timestamps(minutes.size(), 0);
+    for (uint32_t i = 0; i < edges.size(); i++) {
+        ring.push(edges[i]);
+        if (i % 5 != 4 && i + 1 != edges.size()) { continue; }
+
+        DCF77Edge edge;
+        while (ring.pop(edge)) {
+            uint64_t minute_start_us, unix_timestamp;
+            if (!decoder.edge(edge, minute_start_us, unix_timestamp)) { continue; }
+
+            uint32_t minute = 0;
+            while (minute < minute_starts.size() && minute_starts[minute] + 1000 < minute_start_us) { minute++; }
+            if (minute == minute_starts.size() || minute_start_us + 1000 < minute_starts[minute]) {
+                printf("a minute starts at %llu\n", (unsigned long long)minute_start_us);
+                return 1;
+            }
+            timestamps[minute] = unix_timestamp;
+        }
+    }
+
+    for (uint64_t timestamp : timestamps) {
+        if (timestamp) {
+            printf("%llu\n", (unsigned long long)timestamp);
+        } else {
+            printf("fail\n");
+        }
+    }
+    return 0;
+}
@@ -1,12 +1,168 @@
 #include <bitset>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
 
 #include "dcf77_analyze.h"
+#include "dcf77_signal.h"
+#include "gregorian_calendar.h"
+
+/**
+ * dcf77_analyze() as it was, reading a std::bitset bit by bit; for
+ * comparison.
+ */
+static bool reference_analyze(const std::bitset<60> &bits, uint8_t bitcount, uint64_t &minute_timestamp) {
+    auto parity = [&bits](uint8_t start, uint8_t end) {
+        uint8_t result = 0;
+        while (start <= end) {
+            if (bits[start++]) { result = !result; }
+        }
+        return result;
+    };
+    // value of the BCD field, or 255 if the units digit is invalid
+    auto bcd = [&bits](uint8_t start, uint8_t length) {
+        static constexpr uint8_t weights[8] = {1, 2, 4, 8, 10, 20, 40, 80};
+        uint8_t value = 0;
+        for (uint8_t i = 0; i < length; i++) {
+            if (i == 4 && value >= 10) { return uint8_t(255); }
+            if (bits[start + i]) { value += weights[i]; }
+        }
+        return (length <= 4 && value >= 10) ? uint8_t(255) : value;
+    };
+
+    if (bitcount < 59) { return false; }
+    if (bitcount == 60 && bits[59] != 0) { return false; }
+    if (bits[0] != 0) { return false; }
+    if (bits[20] != 1) { return false; }
+    if (parity(21, 28) != 0) { return false; }
+    if (parity(29, 35) != 0) { return false; }
+    if (parity(36, 58) != 0) { return false; }
+    if (bits[17] == bits[18]) { return false; }
+    uint8_t utc_offset = bits[17] * 2 + bits[18];
+
+    uint8_t minute = bcd(21, 7);
+    uint8_t hour = bcd(29, 6);
+    uint8_t day_of_month = bcd(36, 6);
+    uint8_t day_of_week = bcd(42, 3);
+    uint8_t month = bcd(45, 5);
+    uint8_t year_of_century = bcd(50, 8);
+    if (minute >= 60 || hour >= 24) { return false; }
+    if (day_of_month == 0 || day_of_month == 255) { return false; }
+    if (day_of_week == 0 || day_of_week > 7) { return false; }
+    if (month == 0 || month > 12) { return false; }
+    if (year_of_century >= 100) { return false; }
+
+    uint32_t year = 2000 + year_of_century;
+    if (year_of_century < 5) { year += 100; }
+
+    GregorianYear gregorian_year(year);
+    for (uint8_t centuries_incremented = 0;;) {
+        if (gregorian_year.day_of_week(month, day_of_month) == day_of_week) { break; }
+        if (++centuries_incremented == 4) { return false; }
+        gregorian_year.set(gregorian_year.get() + 100);
+    }
+
+    minute_timestamp = gregorian_year.timestamp(month, day_of_month);
+    minute_timestamp += 3600 * hour + 60 * minute;
+    minute_timestamp -= 3600 * utc_offset;
+    return true;
+}
+
+/**
+ * Valid frames of random minutes between 2005 and 2104, of which some
+ * have a few bits flipped, so that every check fails now and then.
+ */
+static std::vector<DCF77Frame> synthetic_frames(uint32_t count, std::mt19937_64 &rng) {
+    std::vector<DCF77Frame> frames;
+    frames.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t timestamp = (1104537600 + rng() % (100 * 365 * 86400ULL)) / 60 * 60;
+        std::vector<bool> bits = dcf77_encode(timestamp, rng);
+        DCF77Frame frame = 0;
+        for (uint32_t bit = 0; bit < bits.size(); bit++) {
+            if (bits[bit]) { frame |= DCF77Frame(1) << bit; }
+        }
+        for (uint32_t flips = rng() % 4; flips > 0; flips--) {
+            frame ^= DCF77Frame(1) << (rng() % 59);
+        }
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+/** dcf77_analyze() must agree with the reference, apart from the days 32 to 39 */
+static bool compare(uint32_t count) {
+    std::mt19937_64 rng(19);
+    std::vector<DCF77Frame> frames = synthetic_frames(count, rng);
+    uint32_t valid = 0;
+    for (DCF77Frame frame : frames) {
+        uint64_t timestamp = 0, expected = 0;
+        bool result = dcf77_analyze(frame, 59, timestamp);
+        bool expected_result = reference_analyze(std::bitset<60>(frame), 59, expected);
+        uint32_t day_tens = (frame >> 40) & 3;
+        if (expected_result && day_tens == 3 && ((frame >> 36) & 0xf) > 1) { expected_result = false; }
+        if (result != expected_result || (result && timestamp != expected)) {
+            printf("frame %015llx: %d %llu, expected %d %llu\n", (unsigned long long)frame,
+                   result, (unsigned long long)timestamp, expected_result, (unsigned long long)expected);
+            return false;
+        }
+        valid += result;
+    }
+    // the flipped bits must not make every frame invalid
+    return valid > count / 8 && valid < count;
+}
+
+/** the host time per frame, with a mix of valid and invalid frames */
+static void benchmark() {
+    const uint32_t count = 1 << 12;
+    const uint32_t rounds = 1000;
+    std::mt19937_64 rng(19);
+    std::vector<DCF77Frame> frames = synthetic_frames(count, rng);
+    std::vector<std::bitset<60>> bitsets(frames.begin(), frames.end());
+
+    auto run = [&](const char *name, auto analyze) {
+        uint64_t sum = 0;
+        uint32_t valid = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t round = 0; round < rounds; round++) {
+            for (uint32_t i = 0; i < count; i++) {
+                uint64_t timestamp = 0;
+                if (analyze(i, timestamp)) {
+                    valid += 1;
+                    sum += timestamp;
+                }
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        printf("%s: %.1f Mframes/s, %.1f %% valid (%llu)\n", name, count * double(rounds) / seconds / 1e6,
+               100.0 * valid / (count * double(rounds)), (unsigned long long)(sum & 1));
+    };
+    run("uint64_t   ", [&](uint32_t i, uint64_t &timestamp) { return dcf77_analyze(frames[i], 59, timestamp); });
+    run("std::bitset", [&](uint32_t i, uint64_t &timestamp) { return reference_analyze(bitsets[i], 59, timestamp); });
+}
+
+/**
+ * Reads one minute of bits per line and prints the decoded time.
+ *
+ * With --random, compares the decoding of 200000 synthetic frames
+ * with the previous implementation; with --benchmark, prints how many
+ * frames both decode per second.
+ */
+int main(int argc, char **argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--random") == 0) {
+        return compare(200000) ? 0 : 1;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0) {
+        benchmark();
+        return 0;
+    }
 
-int main() {
     uint8_t bitcount;
-    std::bitset<60> bits;
+    DCF77Frame bits = 0;
     uint64_t timestamp;
 
     while (1) {
@@ -16,8 +172,8 @@ int main() {
             if (c == ' ') { continue; }
             if (c == '\n') { break; }
             if (bitcount >= 60) { return 1; }
-            if (c == '0') { bits[bitcount++] = 0; continue; }
-            if (c == '1') { bits[bitcount++] = 1; continue; }
+            if (c == '0') { bits &= ~(DCF77Frame(1) << bitcount++); continue; }
+            if (c == '1') { bits |= DCF77Frame(1) << bitcount++; continue; }
             return 0;
         }
 
@@ -0,0 +1 @@
+../src/deserialize.cpp
\ No newline at end of file
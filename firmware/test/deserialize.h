@@ -0,0 +1 @@
+../src/deserialize.h
\ No newline at end of file
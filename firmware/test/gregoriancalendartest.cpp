@@ -1,9 +1,106 @@
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <ctime>
 
 #include "gregorian_calendar.h"
 
-int main() {
+/**
+ * Every day from 2000-01-01 to 2400-12-31, counted up one by one, against
+ * both conversions, GregorianYear and timegm().
+ */
+static bool test_all_days() {
+    uint32_t days = 0;
+    uint8_t day_of_week = 6;
+    for (uint32_t year = 2000; year <= 2400; year++) {
+        GregorianYear calendar_year(year);
+        uint32_t day_of_year = 0;
+        for (uint8_t month = 1; month <= 12; month++) {
+            for (uint8_t day = 1; day <= calendar_year.month_length(month); day++) {
+                day_of_year += 1;
+
+                struct tm t = {};
+                t.tm_year = static_cast<int>(year) - 1900;
+                t.tm_mon = month - 1;
+                t.tm_mday = day;
+                uint64_t timestamp = static_cast<uint64_t>(timegm(&t));
+
+                CivilDate date = civil_from_days(days);
+                CivilDate from_timestamp = civil_from_timestamp(timestamp + 86399);
+                bool ok = (
+                    days_from_civil(year, month, day) == days &&
+                    date.year == year && date.month == month && date.day == day &&
+                    from_timestamp.year == year && from_timestamp.month == month && from_timestamp.day == day &&
+                    day_of_week_from_days(days) == day_of_week &&
+                    calendar_year.day_of_week(month, day) == day_of_week &&
+                    calendar_year.day_of_year(month, day) == day_of_year &&
+                    calendar_year.timestamp(month, day) == timestamp &&
+                    static_cast<uint32_t>(t.tm_yday + 1) == day_of_year
+                );
+                if (!ok) {
+                    printf("%04u-%02u-%02u (day %u): %u, %04u-%02u-%02u, %u\n", year, month, day, days,
+                           days_from_civil(year, month, day), date.year, date.month, date.day,
+                           day_of_week_from_days(days));
+                    return false;
+                }
+
+                days += 1;
+                day_of_week = day_of_week % 7 + 1;
+            }
+        }
+        if (day_of_year != calendar_year.length_days()) { return false; }
+    }
+    return days == 146463;
+}
+
+/** the host time of both conversions, on the days of 400 years */
+static void benchmark() {
+    const uint32_t rounds = 500;
+    const uint32_t days_in_400_years = 146097;
+    static CivilDate dates[days_in_400_years];
+    for (uint32_t days = 0; days < days_in_400_years; days++) { dates[days] = civil_from_days(days); }
+
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < rounds; round++) {
+        for (uint32_t days = 0; days < days_in_400_years; days++) {
+            CivilDate date = civil_from_days(days + round);
+            sum += date.year + date.month + date.day;
+        }
+    }
+    auto middle = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < rounds; round++) {
+        for (const CivilDate &date : dates) {
+            sum += days_from_civil(date.year + round, date.month, date.day);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double count = double(rounds) * days_in_400_years;
+    double to_civil_ns = std::chrono::duration<double, std::nano>(middle - start).count() / count;
+    double from_civil_ns = std::chrono::duration<double, std::nano>(end - middle).count() / count;
+    printf("civil_from_days: %.2f ns per date, %.0f M/s\n", to_civil_ns, 1000 / to_civil_ns);
+    printf("days_from_civil: %.2f ns per date, %.0f M/s (%llu)\n", from_civil_ns, 1000 / from_civil_ns,
+           (unsigned long long)(sum & 1));
+}
+
+/**
+ * Reads dates as YYYY-MM-DD and prints the day of year, the day of week
+ * and the timestamp of each.
+ *
+ * With --all, checks every day from 2000 to 2400; with --benchmark,
+ * prints how long the conversions take.
+ */
+int main(int argc, char **argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--all") == 0) {
+        return test_all_days() ? 0 : 1;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0) {
+        benchmark();
+        return 0;
+    }
+
     uint32_t year;
     uint32_t month;
     uint32_t day;
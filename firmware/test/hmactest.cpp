@@ -21,11 +21,19 @@ int main() {
 	std::string data = input.substr(32);
 
 	std::array<uint8_t, 32> digest;
+	std::array<uint8_t, 32> cached_digest;
 
 	hmac_update_key(reinterpret_cast<const uint8_t *>(key.c_str()));
 	hmac(reinterpret_cast<const uint8_t*>(data.c_str()), data.size(), digest.data());
 
+	// the cached context must stay usable across multiple messages
+	HMACContext context(SECRET_KEY);
+	context.calculate(reinterpret_cast<const uint8_t*>(key.c_str()), key.size(), cached_digest.data());
+	context.calculate(reinterpret_cast<const uint8_t*>(data.c_str()), data.size(), cached_digest.data());
+
+	// output both digests; they must both match hashlib.
 	std::copy(std::begin(digest), std::end(digest), std::ostream_iterator<uint8_t>(std::cout));
+	std::copy(std::begin(cached_digest), std::end(cached_digest), std::ostream_iterator<uint8_t>(std::cout));
 	std::cout.flush();
 	return 0;
 }
@@ -0,0 +1 @@
+../src/message_format.cpp
\ No newline at end of file
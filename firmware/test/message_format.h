@@ -0,0 +1 @@
+../src/message_format.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/message_stream.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/message_stream.h
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "message_format.h"
+
+using namespace message_format;
+
+static constexpr uint64_t VALID_FROM = 1600000000;
+
+static void pack(uint8_t *data, uint64_t value, uint32_t size) {
+    for (uint32_t i = 0; i < size; i++) { data[i] = static_cast<uint8_t>(value >> (8 * i)); }
+}
+
+/** a message as sign_message() packs it: '<QQB' and the payload */
+static uint32_t message_v1(uint8_t *data, uint64_t valid_until, uint8_t type, const char *payload) {
+    memset(data, 0xa5, HMAC_SIZE);
+    pack(data + HMAC_SIZE, VALID_FROM, 8);
+    pack(data + HMAC_SIZE + 8, valid_until, 8);
+    data[HMAC_SIZE + 16] = type;
+    memcpy(data + HMAC_SIZE + HEADER_SIZE_V1, payload, strlen(payload));
+    return HMAC_SIZE + HEADER_SIZE_V1 + strlen(payload);
+}
+
+/** a message as sign_message_v2() packs it: '<IHBB' and the payload */
+static uint32_t message_v2(uint8_t *data, uint16_t minutes, uint8_t type, uint8_t version, uint32_t user_id) {
+    memset(data, 0xa5, HMAC_SIZE);
+    pack(data + HMAC_SIZE, VALID_FROM - EPOCH_V2, 4);
+    pack(data + HMAC_SIZE + 4, minutes, 2);
+    data[HMAC_SIZE + 6] = type;
+    data[HMAC_SIZE + 7] = version;
+    pack(data + HMAC_SIZE + HEADER_SIZE_V2, user_id, 4);
+    return HMAC_SIZE + HEADER_SIZE_V2 + 4;
+}
+
+static bool test_v1() {
+    uint8_t data[64];
+    MessageHeader header;
+    uint32_t size = message_v1(data, VALID_FROM + 300, 0x01, "1234-5678-9012-3456");
+
+    if (!message_parse(data, size, header)) { return false; }
+    if (header.version != 1 || header.type != 0x01) { return false; }
+    if (header.valid_from != VALID_FROM || header.valid_until != VALID_FROM + 300) { return false; }
+    if (header.payload != data + HMAC_SIZE + HEADER_SIZE_V1 || header.payload_size != 19) { return false; }
+    // at least one payload byte
+    return !message_parse(data, HMAC_SIZE + HEADER_SIZE_V1, header);
+}
+
+static bool test_v2() {
+    uint8_t data[64];
+    MessageHeader header;
+    uint32_t size = message_v2(data, 15, 0x01, 2, 1234);
+
+    if (size != 28 || !message_parse(data, size, header)) { printf("A %u\n", size); return false; }
+    if (header.version != 2 || header.type != 0x01) { return false; }
+    // the last second of the duration is the last valid one
+    if (header.valid_from != VALID_FROM || header.valid_until != VALID_FROM + 15 * 60 - 1) { return false; }
+    if (header.payload != data + HMAC_SIZE + HEADER_SIZE_V2 || header.payload_size != 4) { return false; }
+    if (!message_parse(data, HMAC_SIZE + HEADER_SIZE_V2 + 1, header)) { return false; }
+    if (message_parse(data, HMAC_SIZE + HEADER_SIZE_V2, header)) { return false; }
+
+    // the longest duration, a bit over 45 days
+    size = message_v2(data, 0xffff, 0x01, 2, 1234);
+    if (!message_parse(data, size, header) || header.valid_until != VALID_FROM + 0xffffULL * 60 - 1) { return false; }
+    // no duration
+    size = message_v2(data, 0, 0x01, 2, 1234);
+    if (message_parse(data, size, header)) { return false; }
+    // byte 7 is 1 in neither format
+    size = message_v2(data, 15, 0x01, 1, 1234);
+    if (!message_parse(data, size, header) || header.version != VERSION_UNKNOWN) { return false; }
+    // a later version is left to the caller
+    size = message_v2(data, 15, 0x01, 3, 1234);
+    return message_parse(data, size, header) && header.version == 3;
+}
+
+/** checks the headers of both message formats */
+int main() {
+    if (!test_v1()) {
+        printf("legacy message header wrong\n");
+        return 1;
+    }
+    if (!test_v2()) {
+        printf("compact message header wrong\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "base64.h"
+#include "hmac.h"
+#include "message_stream.h"
+#include "secret_key.h"
+
+// the time from the end of the message until the HMAC is known,
+// for the batch and the streaming implementation.
+static void benchmark(const std::string &message) {
+    const uint32_t rounds = 100000;
+
+    hmac_update_key(reinterpret_cast<const uint8_t *>("0123456789abcdef0123456789abcdef"));
+    HMACContext context(SECRET_KEY);
+    std::array<uint8_t, 32> digest;
+    std::array<uint8_t, 256> buf;
+
+    double batch_ns = 0;
+    for (uint32_t i = 0; i < rounds; i++) {
+        std::memcpy(buf.data(), message.data(), message.size());
+
+        auto start = std::chrono::steady_clock::now();
+        int32_t size = base64_decode(buf.data(), message.size(), buf.data(), buf.size(), BASE64_ANY);
+        context.calculate(buf.data() + HMAC_SIZE, size - HMAC_SIZE, digest.data());
+        auto end = std::chrono::steady_clock::now();
+
+        batch_ns += std::chrono::duration<double, std::nano>(end - start).count();
+    }
+
+    double stream_ns = 0;
+    MessageStream stream(context);
+    for (uint32_t i = 0; i < rounds; i++) {
+        stream.reset();
+        for (char c : message) {
+            stream.feed(static_cast<uint8_t>(c));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        stream.finish(digest.data());
+        auto end = std::chrono::steady_clock::now();
+
+        stream_ns += std::chrono::duration<double, std::nano>(end - start).count();
+    }
+
+    printf("%3lu-character message, newline to HMAC:", message.size());
+    printf(" batch %6.0f ns, streaming %6.0f ns\n", batch_ns / rounds, stream_ns / rounds);
+}
+
+static int run_benchmark() {
+    // a typical door-opening token: HMAC, two timestamps, type, 20-char uid.
+    // the signed data fits into the last block, so streaming only saves
+    // the base64 decoding.
+    benchmark("c2lnbmF0dXJlc2lnbmF0dUCy7F8AAAAAwAPuXwAAAAABMTIzNC01Njc4LTkwMTItMzQ1Ng==");
+
+    // a message of the maximum size
+    benchmark(std::string(256, 'A'));
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0) {
+        return run_benchmark();
+    }
+
+    std::istreambuf_iterator<char> begin{std::cin}, end;
+    std::string input{begin, end};
+
+    // the first 32 bytes are the hmac key, the rest is the base64 message
+    if (input.size() < 32) {
+        std::cout << "not enough input" << std::endl;
+        return 1;
+    }
+
+    hmac_update_key(reinterpret_cast<const uint8_t *>(input.c_str()));
+    std::string message = input.substr(32);
+
+    HMACContext context(SECRET_KEY);
+    MessageStream stream(context);
+    for (char c : message) {
+        stream.feed(static_cast<uint8_t>(c));
+    }
+    std::array<uint8_t, 32> digest;
+    uint32_t size = stream.finish(digest.data());
+
+    // the result must be identical to base64_decode() + hmac()
+    std::vector<uint8_t> buf(message.size());
+    int32_t expected_size = base64_decode(
+        reinterpret_cast<const uint8_t *>(message.data()), message.size(),
+        buf.data(), buf.size(),
+        BASE64_ANY
+    );
+    if (expected_size < 0) { expected_size = 0; }
+    if (size != static_cast<uint32_t>(expected_size) || std::memcmp(stream.data(), buf.data(), size) != 0) {
+        std::cout << "stream and base64_decode disagree" << std::endl;
+        return 1;
+    }
+    if (size >= HMAC_SIZE) {
+        std::array<uint8_t, 32> expected_digest;
+        hmac(buf.data() + HMAC_SIZE, size - HMAC_SIZE, expected_digest.data());
+        if (digest != expected_digest) {
+            std::cout << "stream and hmac disagree" << std::endl;
+            return 1;
+        }
+    }
+
+    // output the digest, then the decoded message
+    std::copy(std::begin(digest), std::end(digest), std::ostream_iterator<uint8_t>(std::cout));
+    std::copy(stream.data(), stream.data() + size, std::ostream_iterator<uint8_t>(std::cout));
+    std::cout.flush();
+    return 0;
+}
@@ -0,0 +1 @@
+../src/monotonic_clock.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/motor_ramp.h
\ No newline at end of file
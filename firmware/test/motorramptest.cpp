@@ -0,0 +1,113 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "motor_ramp.h"
+
+using namespace motor_ramp;
+
+/** the compile-time table must match the ramp formula */
+static bool test_table() {
+    double acceleration = RAMP_ACCELERATION;
+    for (uint32_t k = 0; k < RAMP_LENGTH; k++) {
+        double expected = std::sqrt(2 / acceleration) * (std::sqrt(k + 1.0) - std::sqrt(k)) * 1e6;
+        if (std::fabs(RAMP.period_us[k] - expected) > 0.5) {
+            printf("ramp period %u is %u, expected %f\n", k, RAMP.period_us[k], expected);
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < 6; i++) {
+        double expected = 65536 / std::sqrt(1 << i);
+        if (std::fabs(RAMP_MODE_SCALE.scale[i] - expected) > 0.5) {
+            printf("mode scale %u is wrong\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+/** the periods between the steps of a rotation */
+static std::vector<uint32_t> rotation(uint32_t gaps, uint32_t min_period_us, uint32_t mode_index) {
+    std::vector<uint32_t> result;
+    for (uint32_t i = 0; i < gaps; i++) {
+        result.push_back(step_period_us(i, gaps, min_period_us, mode_index));
+    }
+    return result;
+}
+
+static bool test_rotations() {
+    for (uint32_t mode_index = 0; mode_index < 6; mode_index++) {
+        for (uint32_t gaps : {1u, 2u, 3u, 100u, 1023u, 1024u, 5000u}) {
+            for (uint32_t min_period_us : {4u, 100u, 1250u, 30000u}) {
+                std::vector<uint32_t> periods = rotation(gaps, min_period_us, mode_index);
+                for (uint32_t i = 0; i < gaps; i++) {
+                    // symmetric acceleration and deceleration
+                    if (periods[i] != periods[gaps - 1 - i]) {
+                        printf("rotation is not symmetric\n");
+                        return false;
+                    }
+                    // never faster than the cruise speed
+                    if (periods[i] < min_period_us) {
+                        printf("rotation is too fast\n");
+                        return false;
+                    }
+                    // monotonic acceleration
+                    if (i > 0 && 2 * i < gaps && periods[i] > periods[i - 1]) {
+                        printf("rotation doesn't accelerate\n");
+                        return false;
+                    }
+                }
+            }
+        }
+
+        // the acceleration in full steps/s^2 is the same in all modes.
+        // v = a t holds for the midpoints of the periods.
+        uint32_t microsteps = 1 << mode_index;
+        std::vector<uint32_t> periods = rotation(2 * RAMP_LENGTH, 1, mode_index);
+        double t = 0;
+        for (uint32_t i = 0; i < RAMP_LENGTH; i++) {
+            double period_s = periods[i] * 1e-6;
+            double v = 1.0 / period_s / microsteps;
+            double acceleration = v / (t + period_s / 2);
+            t += period_s;
+            // the periods are rounded to us, which matters when they are short
+            if (i >= 8 && periods[i] >= 100 && std::fabs(acceleration / RAMP_ACCELERATION - 1) > 0.02) {
+                printf("acceleration in mode %u at step %u is %f\n", microsteps, i, acceleration);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Duration of the door rotations (3 revolutions, 200 steps per
+ * revolution, full-step mode) with and without the ramp.
+ */
+static void benchmark() {
+    const uint32_t steps = 600;
+    for (uint32_t steps_per_s : {400u, 800u, 1600u, 3200u}) {
+        uint32_t min_period_us = 1000000 / steps_per_s;
+        uint64_t ramp_us = 0;
+        uint32_t ramp_steps = 0;
+        for (uint32_t period_us : rotation(steps - 1, min_period_us, 0)) {
+            ramp_us += period_us;
+            if (period_us > min_period_us) { ramp_steps += 1; }
+        }
+        uint64_t constant_us = static_cast<uint64_t>(min_period_us) * (steps - 1);
+        printf("%4u steps/s: instant start %4.0f ms, ramp %4.0f ms (%u steps ramping)\n",
+               steps_per_s, constant_us / 1000.0, ramp_us / 1000.0, ramp_steps);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0) {
+        benchmark();
+        return 0;
+    }
+    if (!test_table()) { return 1; }
+    if (!test_rotations()) { return 1; }
+    return 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/** a pin change, at the time given by pin_time */
+struct PinChange {
+    uint64_t time;
+    bool value;
+};
+
+extern uint64_t pin_time;
+extern std::vector<PinChange> pin_changes;
+
+/**
+ * Records the changes instead of setting a GPIO pin.
+ */
+class OutputPin {
+public:
+    inline void set(bool value=true) {
+        if (value != this->value) {
+            pin_changes.push_back(PinChange{pin_time, value});
+        }
+        this->value = value;
+    }
+
+    inline void reset() { this->set(false); }
+    inline void high() { this->set(true); }
+    inline void low() { this->set(false); }
+    inline void toggle() { this->set(!this->value); }
+
+private:
+    bool value = false;
+};
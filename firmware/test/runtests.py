@@ -1,16 +1,28 @@
 #!/usr/bin/env python3
 
 from datetime import datetime
+import base64
 import hmac
+import math
+import os
+import random
 import subprocess
+import sys
+import zlib
 
 
-def dcf77test():
+def dcf77test(binary='./dcf77test', combined=False):
+    """
+    combined: the binary decodes a minute from the previous ones as well,
+    and may fail for the first two of consecutive minutes, and for the
+    eight after a change of the time zone.
+    """
     # data provided by dcf77logs.de
     with open('dcf77testdata') as fileobj:
         lines = fileobj.read().split('\n')[:-1]
 
     timestamps = []
+    timezones = []
     bitstrings = []
 
     for line in lines:
@@ -29,13 +41,24 @@ def dcf77test():
         dt = datetime.strptime(timestring + ' ' + timezone, '%d.%m.%y %H:%M:%S %z')
 
         timestamps.append(int(dt.timestamp()))
+        timezones.append(timezone)
         bitstrings.append(bits)
 
-    results = subprocess.check_output(['./dcf77test'], input=('\n'.join(bitstrings)+'\n').encode())
-    results = [int(x) for x in results.decode().split('\n')[:-1]]
+    results = subprocess.check_output([binary], input=('\n'.join(bitstrings)+'\n').encode())
+    results = results.decode().split('\n')[:-1]
 
-    if results != timestamps:
-        print((results, timestamps))
+    expected = [str(timestamp) for timestamp in timestamps]
+    if combined:
+        for idx, timestamp in enumerate(timestamps):
+            consecutive = idx >= 2 and timestamps[idx - 2:idx] == [timestamp - 120, timestamp - 60]
+            zone_changed = len(set(timezones[max(idx - 8, 0):idx + 1])) > 1
+            if results[idx:idx + 1] == ['fail'] and (not consecutive or zone_changed):
+                expected[idx] = 'fail'
+
+    if results != expected:
+        print((results, expected))
+        return False
+    return True
 
 
 def gregtest():
@@ -60,21 +83,306 @@ def randbytes(count):
         return randfile.read(count)
 
 
+def bytecounts():
+    return list(range(1024)) + [2**x for x in range(11, 21)]
+
+
+def base64test_invalid():
+    # the decoder is strict: bad padding, bad characters, mixed alphabets
+    # and non-zero trailing bits ('AB', 'ABC', 'ABD=') must all be rejected
+    for text in [b'A', b'AB=', b'AB=A', b'ABC=A', b'A===', b'AB==C', b'AB==AB==',
+                 b'AB*D', b'AB D', b'AB-_', b'AB/+AB-_', b'AB', b'ABC', b'ABD=']:
+        result = subprocess.run(['./base64test'], input=text, stdout=subprocess.DEVNULL)
+        if result.returncode == 0:
+            print("base64 accepted invalid input %r" % (text,))
+            return False
+
+    return True
+
+
+def base64_benchmark():
+    # the same random inputs as the base64 test in main()
+    inputs = [base64.b64encode(randbytes(bytecount)) for bytecount in bytecounts()]
+    print(subprocess.check_output(['./base64test', '--benchmark'], input=b'\n'.join(inputs) + b'\n').decode(), end='')
+
+
+def uartrxtest():
+    # random messages of up to 300 characters, with all three terminators
+    stream = b''
+    expected = []
+    for length in list(range(0, 300, 7)) + [255, 256, 257]:
+        message = bytes(0x20 + x % 0x5f for x in randbytes(length))
+        stream += message + [b'\0', b'\r', b'\n'][randbytes(1)[0] % 3]
+        # messages that don't fit into a UARTRxBuffer are dropped
+        if length <= 256:
+            expected.append(message + b'\n')
+
+    # with an idle line after every byte, no message is lost
+    result = subprocess.check_output(['./uartrxtest', '1'], input=stream)
+    if result != b''.join(expected):
+        print("uart rx framing is wrong")
+        return False
+
+    # a burst of messages without polling: the queue keeps the first ones
+    # and drops the rest, and too long messages don't take up a slot.
+    slots = 4
+    for count in range(slots + 4):
+        messages = [bytes(0x20 + x % 0x5f for x in randbytes(72)) for _ in range(count)]
+        burst = b'x' * 300 + b'\r' + b''.join(message + b'\n' for message in messages)
+        result = subprocess.check_output(['./uartrxtest', '--burst'], input=burst)
+        kept = min(count, slots)
+        expected = b''.join(message + b'\n' for message in messages[:kept])
+        expected += b'dropped %d 1\n' % (count - kept,)
+        if result != expected:
+            print("uart rx burst of %d messages is wrong" % (count,))
+            return False
+
+    # binary frames end at '\0' only, so they may hold '\r' and '\n';
+    # text messages around them are framed as before.
+    stream_binary = b''
+    expected = []
+    for length in range(0, 260, 13):
+        frame = b'\xa5' + bytes(1 + x % 0xff for x in randbytes(length))
+        message = bytes(0x20 + x % 0x5f for x in randbytes(length % 80))
+        stream_binary += frame + b'\0' + message + b'\r\n'
+        if len(frame) <= 256:
+            expected.append(frame + b'\n')
+        expected.append(message + b'\n')
+        expected.append(b'\n')
+    result = subprocess.check_output(['./uartrxtest', '1'], input=stream_binary)
+    if result != b''.join(expected):
+        print("uart rx binary framing is wrong")
+        return False
+    stream += stream_binary
+
+    # a stray binary frame start ends with the idle line, or where it
+    # turns out too long for a binary frame; the text lines after it
+    # are received as usual.
+    for stray in [b'\xa5', b'\xa5x', b'\xa5' + b'x' * 300]:
+        lines = stray + b'\n' + b'status\n' + b'hello\n'
+        result = subprocess.check_output(['./uartrxtest', '--lines'], input=lines)
+        expected = b'status\nhello\n'
+        if len(stray) + 1 <= 256:
+            expected = stray + b'\n\n' + expected
+        if result != expected:
+            print("uart rx after a stray binary frame start is wrong: %r" % (result,))
+            return False
+    # without an idle line, too
+    burst = b'\xa5' + b'x' * 300 + b'\nstatus\nhello\n'
+    result = subprocess.check_output(['./uartrxtest', '--burst'], input=burst)
+    if result != b'status\nhello\ndropped 0 1\n':
+        print("uart rx after a too long binary frame is wrong: %r" % (result,))
+        return False
+
+    # with longer chunks, messages may be dropped before they are
+    # polled; uartrxtest compares with the bytewise reception.
+    for chunk_size in [7, 64, 128, 300, 1000]:
+        result = subprocess.run(['./uartrxtest', str(chunk_size)], input=stream, stdout=subprocess.DEVNULL)
+        if result.returncode != 0:
+            print("uart rx with DMA chunk size %d is wrong" % (chunk_size,))
+            return False
+
+    return True
+
+
+def uarttxtest():
+    lines = [bytes(0x20 + x % 0x5f for x in randbytes(length)) + b'\n'
+             for length in list(range(0, 300, 3)) * 3]
+
+    for rate in [0, 1, 16, 64, 1000]:
+        result = subprocess.run(['./uarttxtest', str(rate)], input=b''.join(lines),
+                                stdout=subprocess.PIPE, stderr=subprocess.PIPE, check=True)
+        full = set(int(x.split()[1]) for x in result.stderr.decode().split('\n')[:-1])
+
+        # lines that don't fit are rejected as a whole
+        expected = b''.join(line for idx, line in enumerate(lines) if idx not in full)
+        if result.stdout != expected:
+            print("uart tx at rate %d is wrong" % (rate,))
+            return False
+        # lines that are longer than the buffer never fit
+        if any(len(line) > 256 for idx, line in enumerate(lines) if idx not in full):
+            print("uart tx at rate %d accepted a line that doesn't fit" % (rate,))
+            return False
+
+    return True
+
+
+def motor_current_trace(rng, stop):
+    """
+    a synthetic motor current trace in mA at 1 kHz, with the phases of
+    board/motor-current-measurements. returns the trace and the index of
+    the first sample at the mechanical stop, or None.
+    """
+    trace = []
+    # start spike, above 300 mA for ~7 ms
+    for i in range(10):
+        trace.append(450 - 25 * i + rng.uniform(-30, 30))
+
+    if stop:
+        # closing: travel, the bolt transition, the stop and holding
+        for i in range(rng.randint(200, 800)):
+            trace.append(rng.uniform(100, 300))
+        for i in range(20):
+            trace.append(rng.uniform(100, 300))
+        stop_index = len(trace)
+        for i in range(100):
+            trace.append(rng.uniform(300, 600))
+        for i in range(200):
+            trace.append(420 + rng.uniform(-20, 20))
+    else:
+        # opening: slowly rising, plus a sine wave
+        length = rng.randint(200, 800)
+        phase = rng.uniform(0, 2 * math.pi)
+        for i in range(length):
+            base = 100 + 200 * i / length
+            trace.append(base + 200 * math.sin(phase + 2 * math.pi * i / 7.5) + rng.uniform(-30, 30))
+        stop_index = None
+        for i in range(200):
+            trace.append(rng.uniform(-5, 5))
+
+    return trace, stop_index
+
+
+def motor_current_input(trace):
+    return ''.join('%.1f\n' % (value,) for value in trace).encode()
+
+
+def stalldetecttest():
+    rng = random.Random(11)
+    for run in range(200):
+        stop = run % 2 == 0
+        trace, stop_index = motor_current_trace(rng, stop)
+        result = int(subprocess.check_output(['./stalldetecttest'], input=motor_current_input(trace)))
+
+        if stop_index is None and result >= 0:
+            print("stall detected at %d ms while opening (run %d)" % (result, run))
+            return False
+        # the stop must be detected within 25 ms
+        if stop_index is not None and not stop_index <= result < stop_index + 25:
+            print("stall detected at %d ms, the stop is at %d ms (run %d)" % (result, stop_index, run))
+            return False
+
+    return True
+
+
+def stall_benchmark():
+    trace, _ = motor_current_trace(random.Random(11), True)
+    print(subprocess.check_output(['./stalldetecttest', '--benchmark'], input=motor_current_input(trace)).decode(), end='')
+
+
+def sha256_commands():
+    commands = [['./sha256test']]
+    # the Thumb-2 implementation is only tested if it has been cross-compiled
+    # with 'make sha256test_m3'.
+    if os.path.exists('./sha256test_m3'):
+        commands.append(['qemu-arm', './sha256test_m3'])
+    return commands
+
+
 def main():
     gregtest()
-    dcf77test()
 
-    for bytecount in list(range(1024)) + [2**x for x in range(11, 21)]:
+    # every day from 2000 to 2400, both ways
+    if subprocess.run(['./gregoriancalendartest', '--all']).returncode != 0:
+        return 13
+
+    if not dcf77test():
+        return 12
+
+    # the packed frame decoding against the previous one, on synthetic frames
+    if subprocess.run(['./dcf77test', '--random']).returncode != 0:
+        return 12
+
+    # the same minutes as a jittery edge train through the capture ring
+    if not dcf77test('./dcf77decodertest', combined=True):
+        return 12
+
+    # the adaptive pulse classification on noisy synthetic signals
+    if subprocess.run(['./dcf77decodertest', '--noise']).returncode != 0:
+        return 12
+
+    # the combination of minutes on frames with bit errors
+    if subprocess.run(['./dcf77decodertest', '--ber']).returncode != 0:
+        return 12
+
+    sha256tests = sha256_commands()
+
+    if not base64test_invalid():
+        return 2
+
+    if not uartrxtest():
+        return 5
+
+    if not uarttxtest():
+        return 5
+
+    # the scheduling order
+    if subprocess.run(['./schedulertest']).returncode != 0:
+        return 6
+
+    # the beeper waveforms
+    if subprocess.run(['./beepertest']).returncode != 0:
+        return 6
+
+    # the compile-time stepper motor ramp
+    if subprocess.run(['./motorramptest']).returncode != 0:
+        return 7
+
+    # the motor stall detection on synthetic current traces
+    if not stalldetecttest():
+        return 8
+
+    # the lock-free 64-bit clock
+    if subprocess.run(['./clocktest']).returncode != 0:
+        return 10
+
+    # the division-free unit conversions against exact division
+    if subprocess.run(['./unitstest']).returncode != 0:
+        return 11
+
+    # the time kept in the RTC, on a simulated one
+    if subprocess.run(['./timebackuptest']).returncode != 0:
+        return 14
+
+    # the disciplined clock, on a simulated crystal
+    if subprocess.run(['./clockdisciplinetest']).returncode != 0:
+        return 15
+
+    # the time-set messages and their sequence numbers
+    if subprocess.run(['./timesettest']).returncode != 0:
+        return 16
+
+    # the headers of the legacy and the compact message format
+    if subprocess.run(['./messageformattest']).returncode != 0:
+        return 17
+
+    # the binary frames, against the bridge's encoder
+    if subprocess.run(['./binaryframetest']).returncode != 0:
+        return 18
+
+    # the CRC-protected motor calibration record
+    if subprocess.run(['./calibrationtest']).returncode != 0:
+        return 9
+
+    for bytecount in bytecounts():
         data = randbytes(bytecount)
-        a = subprocess.check_output(['./sha256test'], input=data)[:-1]
         b = subprocess.check_output(['sha256sum'], input=data)[:-4]
+        for sha256test in sha256tests:
+            a = subprocess.check_output(sha256test, input=data)[:-1]
+
+            if a != b:
+                print("sha256 wrong at bytecount %d (%s)" % (bytecount, sha256test[-1]))
+                print(subprocess.check_output(['xxd'], input=data).decode())
+                print(a)
+                print(b)
+                return 1
+
+        a = b'%08x\n' % (zlib.crc32(data),)
+        b = subprocess.check_output(['./calibrationtest', '--crc32'], input=data)
 
         if a != b:
-            print("sha256 wrong at bytecount %d" % (bytecount,))
-            print(subprocess.check_output(['xxd'], input=data).decode())
-            print(a)
-            print(b)
-            return 1
+            print("crc32 wrong at bytecount %d\n" % (bytecount,))
+            return 9
 
         a = subprocess.check_output(['base64'], input=data).strip()
         b = subprocess.check_output(['./base64test'], input=a)
@@ -85,17 +393,45 @@ def main():
             print(subprocess.check_output(['xxd'], input=b).decode())
             return 2
 
+        a = base64.urlsafe_b64encode(data).rstrip(b'=')
+        b = subprocess.check_output(['./base64test', '--urlsafe'], input=a)
+
+        if b != data:
+            print("urlsafe base64 wrong at bytecount %d\n" % (bytecount,))
+            print(subprocess.check_output(['xxd'], input=data).decode())
+            print(subprocess.check_output(['xxd'], input=b).decode())
+            return 2
+
         key = randbytes(32)
         a = hmac.new(key, data, 'sha256').digest()
         b = subprocess.check_output(['./hmactest'], input=(b"%s%s" % (key, data)))
 
-        if a != b:
+        # hmactest outputs the uncached and the cached HMAC
+        if a + a != b:
             print("hmac wrong at bytecount %d\n" % (bytecount,))
             print(subprocess.check_output(['xxd'], input=a).decode())
             print(subprocess.check_output(['xxd'], input=b).decode())
             return 3
 
+        # a UARTRxBuffer holds at most 256 base64 characters
+        if bytecount <= 192:
+            encoded = subprocess.check_output(['base64', '-w0'], input=data)
+            a = hmac.new(key, data[16:], 'sha256').digest() + data
+            b = subprocess.check_output(['./messagestreamtest'], input=(b"%s%s" % (key, encoded)))
+
+            if a != b:
+                print("message stream wrong at bytecount %d\n" % (bytecount,))
+                print(subprocess.check_output(['xxd'], input=a).decode())
+                print(subprocess.check_output(['xxd'], input=b).decode())
+                return 4
+
     return 0
 
 if __name__ == '__main__':
+    if sys.argv[1:] == ['--benchmark']:
+        base64_benchmark()
+        raise SystemExit(0)
+    if sys.argv[1:] == ['--benchmark-stall']:
+        stall_benchmark()
+        raise SystemExit(0)
     raise SystemExit(main())
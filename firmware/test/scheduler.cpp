@@ -0,0 +1 @@
+../src/scheduler.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/scheduler.h
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "scheduler.h"
+
+// the simulated time
+static uint64_t sim_time = 0;
+
+// the blocking beeper implementation, with simulated time
+namespace blocking {
+
+static void sleep_us(uint64_t duration_us) {
+    sim_time += duration_us;
+}
+
+static void beep(uint32_t period_us, uint32_t duration_us) {
+    uint32_t num_periods = duration_us / period_us;
+
+    while (num_periods--) {
+        sleep_us(period_us/2);
+        sleep_us(period_us/2);
+    }
+}
+
+static void pattern(uint32_t period_a_us, uint32_t period_b_us, uint32_t pause_us, uint32_t beeps) {
+    while (beeps--) {
+        beep(period_a_us, 10000);
+
+        uint32_t tmp = period_a_us;
+        period_a_us = period_b_us;
+        period_b_us = tmp;
+
+        if (beeps) {
+            sleep_us(pause_us);
+        }
+    }
+}
+
+static void error(uint32_t code) {
+    while (code--) {
+        pattern(1000000/152, 1000000/900, 1000, 10);
+        sleep_us(200000);
+    }
+}
+
+}
+
+/** polls for a message, like the MessageHandler */
+class MessageTask : public Task {
+public:
+    static constexpr uint32_t poll_interval_us = 5000;
+
+    uint64_t arrival = NEVER;
+    uint64_t decision = NEVER;
+
+    MessageTask() { this->deadline = 0; }
+
+    void run(uint64_t now) override {
+        this->deadline = now + poll_interval_us;
+        if (now >= this->arrival && this->decision == NEVER) {
+            this->decision = now;
+        }
+    }
+};
+
+/**
+ * Runs the scheduler in simulated time, jumping from one deadline to
+ * the next, until until_us or until nothing is due any more.
+ */
+static void simulate(Scheduler &scheduler, uint64_t until_us) {
+    while (sim_time <= until_us) {
+        uint64_t next = scheduler.run_due(sim_time);
+        if (next == Task::NEVER) { return; }
+        if (next > sim_time) { sim_time = next; }
+    }
+}
+
+/** tasks run earliest deadline first, and each one once per run_due() */
+static bool test_order() {
+    class RecordingTask : public Task {
+    public:
+        char name;
+        std::vector<char> *log;
+        void run(uint64_t now) override {
+            this->log->push_back(this->name);
+            // due again immediately
+            this->deadline = now;
+        }
+    };
+
+    std::vector<char> log;
+    RecordingTask a, b, c;
+    a.name = 'a'; a.log = &log; a.deadline = 30;
+    b.name = 'b'; b.log = &log; b.deadline = 10;
+    c.name = 'c'; c.log = &log; c.deadline = 50;
+
+    Scheduler scheduler;
+    scheduler.add(a);
+    scheduler.add(b);
+    scheduler.add(c);
+
+    uint64_t next = scheduler.run_due(40);
+    if (std::string(log.begin(), log.end()) != "ba" || next != 40) {
+        printf("scheduler order is wrong\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * The time from the arrival of a message until it is handled, while an
+ * error pattern is playing, with the blocking beeper and with the
+ * scheduler, where the beeper plays from the timer interrupt. The
+ * message arrives arrival_us after the error pattern has started.
+ */
+static void latency(uint32_t arrival_us) {
+    printf("message %u ms after the error pattern has started\n", arrival_us / 1000);
+    for (uint32_t code = 1; code <= 8; code++) {
+        // blocking: the message is handled after error() returns
+        sim_time = 0;
+        blocking::error(code);
+        uint64_t blocking_latency = (sim_time > arrival_us) ? sim_time - arrival_us : 0;
+
+        MessageTask message;
+        Scheduler scheduler;
+        scheduler.add(message);
+        sim_time = 0;
+        message.arrival = arrival_us;
+        simulate(scheduler, arrival_us + 1000000);
+
+        printf("error(%u): blocking %8.1f ms, scheduler %5.1f ms\n",
+               code, blocking_latency / 1000.0, (message.decision - message.arrival) / 1000.0);
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0) {
+        latency(52300);
+        return 0;
+    }
+
+    if (!test_order()) { return 1; }
+    return 0;
+}
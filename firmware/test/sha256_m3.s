@@ -0,0 +1 @@
+../src/sha256_m3.s
\ No newline at end of file
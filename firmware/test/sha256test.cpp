@@ -1,24 +1,110 @@
 #include <array>
+#include <chrono>
 #include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
 
 #include "sha256.h"
 
 const char *HEX_CHARS = "0123456789abcdef";
 
-int main() {
+static uint64_t cycles() {
+#if HAVE_RDTSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// hashes buf with the byte-by-byte path
+static void hash_bytewise(const std::vector<uint8_t> &buf, uint8_t *digest) {
+    SHA256 hash;
+    for (uint8_t byte : buf) {
+        hash.add_byte(byte);
+    }
+    hash.calculate_digest(digest);
+}
+
+// hashes buf with the block path, in irregular chunks
+static void hash_blockwise(const std::vector<uint8_t> &buf, uint8_t *digest) {
     SHA256 hash;
+    uint32_t pos = 0;
+    uint32_t chunk = 1;
+    while (pos < buf.size()) {
+        uint32_t len = std::min<uint32_t>(chunk, buf.size() - pos);
+        hash.update(buf.data() + pos, len);
+        pos += len;
+        chunk = (chunk * 7 + 3) % 200;
+    }
+    hash.calculate_digest(digest);
+}
+
+template <typename F>
+static void benchmark(const char *name, F hash_function, const std::vector<uint8_t> &buf, uint32_t rounds) {
     std::array<uint8_t, 32> digest;
 
+    auto start = std::chrono::steady_clock::now();
+    uint64_t start_cycles = cycles();
+    for (uint32_t i = 0; i < rounds; i++) {
+        hash_function(buf, digest.data());
+    }
+    uint64_t end_cycles = cycles();
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double bytes = static_cast<double>(buf.size()) * rounds;
+    printf("%-10s %8.2f MB/s", name, bytes / seconds / 1e6);
+    if (end_cycles != start_cycles) {
+        printf(" %8.2f cycles/byte", static_cast<double>(end_cycles - start_cycles) / bytes);
+    }
+    printf("\n");
+}
+
+static int run_benchmark() {
+    std::vector<uint8_t> buf(1 << 20);
+    for (uint32_t i = 0; i < buf.size(); i++) {
+        buf[i] = static_cast<uint8_t>(i * 2654435761u >> 24);
+    }
+
+    benchmark("add_byte", hash_bytewise, buf, 32);
+    benchmark("update", [](const std::vector<uint8_t> &b, uint8_t *digest) {
+        SHA256 hash;
+        hash.update(b.data(), b.size());
+        hash.calculate_digest(digest);
+    }, buf, 32);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0) {
+        return run_benchmark();
+    }
+
+    std::vector<uint8_t> buf;
+
     while (1) {
         int byte = getchar();
         if (byte < 0) {
             break;
         }
 
-        hash.add_byte(static_cast<uint8_t>(byte));
+        buf.push_back(static_cast<uint8_t>(byte));
     }
 
-    hash.calculate_digest(digest.data());
+    std::array<uint8_t, 32> digest;
+    std::array<uint8_t, 32> digest_bytewise;
+    hash_blockwise(buf, digest.data());
+    hash_bytewise(buf, digest_bytewise.data());
+
+    if (digest != digest_bytewise) {
+        printf("add_byte and update disagree\n");
+        return 1;
+    }
 
     for (uint8_t byte : digest) {
         putchar(HEX_CHARS[byte >> 4]);
@@ -0,0 +1 @@
+../src/stall_detector.cpp
\ No newline at end of file
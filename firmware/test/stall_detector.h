@@ -0,0 +1 @@
+../src/stall_detector.h
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "stall_detector.h"
+
+/**
+ * reads a current trace from stdin, one sample in mA per line at 1 kHz.
+ * in lines with several comma-separated columns, e.g. oscilloscope CSV
+ * exports, the last column is the current. other lines are skipped.
+ */
+static std::vector<int16_t> read_trace() {
+    std::vector<int16_t> trace;
+    char line[256];
+    while (fgets(line, sizeof(line), stdin) != nullptr) {
+        const char *value = strrchr(line, ',');
+        value = (value == nullptr) ? line : value + 1;
+        char *end;
+        double current_ma = strtod(value, &end);
+        if (end == value) { continue; }
+        if (current_ma > INT16_MAX) { current_ma = INT16_MAX; }
+        if (current_ma < INT16_MIN) { current_ma = INT16_MIN; }
+        trace.push_back(static_cast<int16_t>(std::lround(current_ma)));
+    }
+    return trace;
+}
+
+/**
+ * replays the trace sample by sample, as the DMA interrupt does.
+ * returns the index of the sample at which the stop was detected, or -1.
+ */
+static int32_t replay(const std::vector<int16_t> &trace) {
+    StallDetector detector;
+    for (uint32_t i = 0; i < trace.size(); i++) {
+        if (detector.process(&trace[i], 1)) { return i; }
+    }
+    return -1;
+}
+
+static void benchmark(const std::vector<int16_t> &trace) {
+    StallDetector detector;
+    const uint32_t rounds = 2000;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t round = 0; round < rounds; round++) {
+        detector.reset();
+        for (uint32_t i = 0; i < trace.size(); i++) { detector.process(&trace[i], 1); }
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    printf("stall detector: %.1f ns per sample\n", ns / (static_cast<double>(rounds) * trace.size()));
+}
+
+int main(int argc, char **argv) {
+    std::vector<int16_t> trace = read_trace();
+    if (trace.empty()) { return 1; }
+
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0) {
+        benchmark(trace);
+        return 0;
+    }
+
+    // the whole trace at once must give the same result
+    StallDetector detector;
+    bool stalled = detector.process(trace.data(), trace.size());
+    int32_t index = replay(trace);
+    if (stalled != (index >= 0)) {
+        printf("block processing differs from sample processing\n");
+        return 1;
+    }
+
+    printf("%d\n", index);
+    return 0;
+}
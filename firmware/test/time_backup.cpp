@@ -0,0 +1 @@
+../src/time_backup.cpp
\ No newline at end of file
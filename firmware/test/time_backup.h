@@ -0,0 +1 @@
+../src/time_backup.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/time_set.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/time_set.h
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "time_backup.h"
+
+/**
+ * The backup domain: an RTC that counts the ticks of a crystal with a
+ * rate error which changes with the temperature, and the backup registers.
+ * Both are lost together.
+ */
+class SimulatedRTC {
+public:
+    SimulatedRTC(double rate_error_ppm, double temperature_ppm)
+        : rate_error_ppm(rate_error_ppm), temperature_ppm(temperature_ppm) {}
+
+    /** lets the true time pass */
+    void advance(uint64_t duration_us) {
+        const uint64_t step_us = 60000000;
+        while (duration_us > 0) {
+            uint64_t step = duration_us < step_us ? duration_us : step_us;
+            // a day-night cycle of the temperature
+            double ppm = this->rate_error_ppm + this->temperature_ppm * std::sin(this->true_us * 2 * M_PI / 86400e6);
+            this->ticks_exact += step * (1 + ppm * 1e-6) * time_backup::TICKS_PER_SECOND / 1e6;
+            this->true_us += step;
+            duration_us -= step;
+        }
+    }
+
+    void power_loss() {
+        this->ticks_exact = 0;
+        std::memset(this->registers, 0, sizeof(this->registers));
+    }
+
+    uint64_t ticks() const { return static_cast<uint64_t>(this->ticks_exact); }
+
+    uint64_t true_us = 1546300800ULL * 1000000;
+    uint16_t registers[time_backup::REGISTER_COUNT] = {};
+
+private:
+    double rate_error_ppm;
+    double temperature_ppm;
+    double ticks_exact = 0;
+};
+
+/** what time.cpp does on a synchronization, from the backup registers */
+static void synchronize(SimulatedRTC &rtc, uint64_t unix_us, uint32_t uncertainty_us) {
+    TimeBackupRecord record = {};
+    bool valid = time_backup_decode(rtc.registers, record);
+    time_backup_synchronize(record, valid, rtc.ticks(), unix_us, uncertainty_us);
+    time_backup_encode(record, rtc.registers);
+}
+
+/** what time.cpp does at startup; false if there is no time */
+static bool restore(const SimulatedRTC &rtc, uint64_t &unix_us, uint64_t &uncertainty_us) {
+    TimeBackupRecord record;
+    if (!time_backup_decode(rtc.registers, record)) { return false; }
+    time_backup_estimate(record, rtc.ticks(), unix_us, uncertainty_us);
+    return uncertainty_us != UINT64_MAX;
+}
+
+/** the restored time must be within its uncertainty of the true time */
+static bool check_restore(const SimulatedRTC &rtc, const char *when, uint64_t &uncertainty_us) {
+    uint64_t unix_us;
+    if (!restore(rtc, unix_us, uncertainty_us)) {
+        printf("%s: no time restored\n", when);
+        return false;
+    }
+    uint64_t error_us = unix_us > rtc.true_us ? unix_us - rtc.true_us : rtc.true_us - unix_us;
+    if (error_us > uncertainty_us) {
+        printf("%s: off by %llu us, uncertainty %llu us\n", when,
+               (unsigned long long)error_us, (unsigned long long)uncertainty_us);
+        return false;
+    }
+    return true;
+}
+
+static bool test_registers() {
+    TimeBackupRecord record = {0x7fffffffffffULL, 1546300800123ULL, 1234, true, -321, 1439};
+    uint16_t registers[time_backup::REGISTER_COUNT];
+    time_backup_encode(record, registers);
+
+    TimeBackupRecord decoded;
+    if (!time_backup_decode(registers, decoded)) { return false; }
+    if (decoded.anchor_ticks != record.anchor_ticks || decoded.anchor_unix_ms != record.anchor_unix_ms) { return false; }
+    if (decoded.uncertainty_ms != 1234 || !decoded.drift_known || decoded.drift != -321) { return false; }
+    if (decoded.fit_minutes != 1439) { return false; }
+
+    // any flipped bit, and the registers after a power loss
+    for (uint32_t bit = 0; bit < 16 * time_backup::REGISTER_COUNT; bit++) {
+        registers[bit / 16] ^= 1 << (bit % 16);
+        if (time_backup_decode(registers, decoded)) { return false; }
+        registers[bit / 16] ^= 1 << (bit % 16);
+    }
+    uint16_t empty[time_backup::REGISTER_COUNT] = {};
+    return !time_backup_decode(empty, decoded);
+}
+
+/**
+ * Synchronizes once a minute with the jitter of the DCF77 receiver, and
+ * restores after outages of increasing length, from crystals with
+ * different rate errors.
+ */
+static bool test_outages(bool verbose) {
+    const double rate_errors_ppm[] = {-80, -20, 0, 7, 35, 95};
+    const uint64_t outages_s[] = {0, 60, 3600, 86400, 7 * 86400, 30 * 86400};
+    const uint32_t dcf77_uncertainty_us = 20000;
+    std::mt19937_64 rng(21);
+    std::uniform_real_distribution<double> jitter_us(-15000, 15000);
+
+    if (verbose) {
+        printf("rate error   uncertainty after: sync     1 min    1 h      1 day    1 week   30 days\n");
+    }
+    for (double rate_error_ppm : rate_errors_ppm) {
+        if (verbose) { printf("%+5.0f ppm                      ", rate_error_ppm); }
+        for (uint64_t outage_s : outages_s) {
+            SimulatedRTC rtc(rate_error_ppm, 2);
+            rtc.advance(rng() % 1000000000);
+
+            // two days of reception, so that the rate has been measured
+            for (uint32_t minute = 0; minute < 2 * 1440; minute++) {
+                synchronize(rtc, rtc.true_us + static_cast<int64_t>(jitter_us(rng)), dcf77_uncertainty_us);
+                uint64_t uncertainty_us;
+                rtc.advance(30000000);
+                if (!check_restore(rtc, "between synchronizations", uncertainty_us)) { return false; }
+                rtc.advance(30000000);
+            }
+            TimeBackupRecord record;
+            if (!time_backup_decode(rtc.registers, record) || !record.drift_known) {
+                printf("%+.0f ppm: the rate hasn't been measured\n", rate_error_ppm);
+                return false;
+            }
+
+            rtc.advance(outage_s * 1000000);
+            uint64_t uncertainty_us;
+            if (!check_restore(rtc, "after an outage", uncertainty_us)) { return false; }
+            if (verbose) { printf("%8.3f ", uncertainty_us / 1e6); }
+            // a month must leave the time good enough for the messages
+            if (uncertainty_us > 300000000) {
+                printf("%+.0f ppm: %llu s after an outage of %llu s\n", rate_error_ppm,
+                       (unsigned long long)(uncertainty_us / 1000000), (unsigned long long)outage_s);
+                return false;
+            }
+        }
+        if (verbose) { printf("s\n"); }
+    }
+    return true;
+}
+
+/**
+ * The first hour after the RTC has started, before the rate is known, a
+ * wrong synchronization, and the power loss of the backup domain.
+ */
+static bool test_recovery() {
+    SimulatedRTC rtc(60, 0);
+    uint64_t uncertainty_us, unix_us;
+    if (restore(rtc, unix_us, uncertainty_us)) { return false; }
+
+    // with an unknown rate
+    synchronize(rtc, rtc.true_us, 20000);
+    rtc.advance(600000000);
+    if (!check_restore(rtc, "10 min after the first synchronization", uncertainty_us)) { return false; }
+    for (uint32_t minute = 0; minute < 60; minute++) {
+        rtc.advance(60000000);
+        synchronize(rtc, rtc.true_us, 20000);
+        if (!check_restore(rtc, "in the first hour", uncertainty_us)) { return false; }
+    }
+
+    // a wrong time is taken over, and replaced by the next right one
+    synchronize(rtc, rtc.true_us + 3600000000ULL, 20000);
+    rtc.advance(60000000);
+    synchronize(rtc, rtc.true_us, 20000);
+    rtc.advance(3600000000ULL);
+    if (!check_restore(rtc, "after a wrong synchronization", uncertainty_us)) { return false; }
+
+    rtc.power_loss();
+    return !restore(rtc, unix_us, uncertainty_us);
+}
+
+/**
+ * Checks the restore of the time from a simulated RTC; with --stats,
+ * prints the uncertainties after outages of the synchronization.
+ */
+int main(int argc, char **argv) {
+    bool verbose = argc > 1 && std::strcmp(argv[1], "--stats") == 0;
+    if (!test_registers()) {
+        printf("the backup registers don't hold the record\n");
+        return 1;
+    }
+    if (!test_recovery()) { return 1; }
+    if (!test_outages(verbose)) { return 1; }
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "time_set.h"
+
+using namespace time_set;
+
+static constexpr uint64_t NOW_US = 1558000000123456ULL;
+static constexpr uint64_t NOW_S = NOW_US / 1000000;
+static constexpr uint64_t MAX_UNCERTAINTY_US = 300000000;
+
+/** the payload as the database packs it: struct.pack('<QI', unix_us, sequence) */
+static void pack(uint8_t *payload, uint64_t unix_us, uint32_t sequence) {
+    for (uint32_t i = 0; i < 8; i++) { payload[i] = static_cast<uint8_t>(unix_us >> (8 * i)); }
+    for (uint32_t i = 0; i < 4; i++) { payload[8 + i] = static_cast<uint8_t>(sequence >> (8 * i)); }
+}
+
+static bool test_parse() {
+    uint8_t payload[PAYLOAD_SIZE + 1];
+    pack(payload, NOW_US, 17);
+    TimeSetMessage message;
+
+    if (!time_set_parse(NOW_S - 60, NOW_S + 60, payload, PAYLOAD_SIZE, message)) { return false; }
+    if (message.unix_us != NOW_US || message.sequence != 17) { return false; }
+    // the time must be within the validity window, which must be short
+    if (!time_set_parse(NOW_S, NOW_S, payload, PAYLOAD_SIZE, message)) { return false; }
+    if (time_set_parse(NOW_S + 1, NOW_S + 60, payload, PAYLOAD_SIZE, message)) { return false; }
+    if (time_set_parse(NOW_S - 60, NOW_S - 1, payload, PAYLOAD_SIZE, message)) { return false; }
+    if (time_set_parse(NOW_S + 60, NOW_S - 60, payload, PAYLOAD_SIZE, message)) { return false; }
+    if (time_set_parse(NOW_S - 61, NOW_S + 60, payload, PAYLOAD_SIZE, message)) { return false; }
+    // and the payload must have the right size
+    if (time_set_parse(NOW_S - 60, NOW_S + 60, payload, PAYLOAD_SIZE - 1, message)) { return false; }
+    return !time_set_parse(NOW_S - 60, NOW_S + 60, payload, PAYLOAD_SIZE + 1, message);
+}
+
+static bool test_check() {
+    TimeSetMessage message = {NOW_US, 8};
+    auto check = [&](uint32_t last_sequence, uint64_t local_us, uint64_t local_uncertainty_us) {
+        return time_set_check(message, last_sequence, local_us, local_uncertainty_us, MAX_UNCERTAINTY_US);
+    };
+
+    // only the next sequence number
+    if (check(7, 0, UINT64_MAX) != TimeSetResult::SET) { return false; }
+    if (check(8, 0, UINT64_MAX) != TimeSetResult::WRONG_SEQUENCE) { return false; }
+    if (check(6, 0, UINT64_MAX) != TimeSetResult::WRONG_SEQUENCE) { return false; }
+    if (check(9, 0, UINT64_MAX) != TimeSetResult::WRONG_SEQUENCE) { return false; }
+    // the last one can't be written
+    message.sequence = ERASED;
+    if (check(ERASED - 1, 0, UINT64_MAX) != TimeSetResult::WRONG_SEQUENCE) { return false; }
+    message.sequence = 8;
+
+    // any time, if the local time is not known well enough
+    if (check(7, NOW_US + 3600000000ULL, MAX_UNCERTAINTY_US + 1) != TimeSetResult::SET) { return false; }
+    // otherwise, within the uncertainty of both
+    if (check(7, NOW_US + 12000000, 10000000) != TimeSetResult::SET) { return false; }
+    if (check(7, NOW_US - 12000000, 10000000) != TimeSetResult::SET) { return false; }
+    if (check(7, NOW_US + 12000001, 10000000) != TimeSetResult::CONTRADICTS) { return false; }
+    if (check(7, NOW_US - 12000001, 10000000) != TimeSetResult::CONTRADICTS) { return false; }
+    // a better time is kept
+    if (check(7, NOW_US + 1000000, UNCERTAINTY_US) != TimeSetResult::KEPT) { return false; }
+    // and so is one that a message has just set, with a little more uncertainty
+    if (check(7, NOW_US + 1000000, UNCERTAINTY_US + 3002) != TimeSetResult::KEPT) { return false; }
+    if (check(7, NOW_US, SET_UNCERTAINTY_US) != TimeSetResult::KEPT) { return false; }
+    if (check(7, NOW_US, SET_UNCERTAINTY_US + 1) != TimeSetResult::SET) { return false; }
+    return check(7, NOW_US + 3000000, 20000) == TimeSetResult::CONTRADICTS;
+}
+
+/** a flash page as time_set_write_sequence() writes it, including halfway */
+static void write_slot(uint32_t *slots, uint32_t sequence, bool halfway = false) {
+    uint32_t slot = time_set_free_slot(slots);
+    if (slot == SEQUENCE_SLOTS) {
+        for (uint32_t i = 0; i < SEQUENCE_SLOTS; i++) { slots[i] = ERASED; }
+        slot = 0;
+    }
+    // flash bits only go from 1 to 0; the upper half first
+    slots[slot] &= (sequence | 0xffff);
+    if (!halfway) { slots[slot] &= (sequence | 0xffff0000); }
+}
+
+static bool test_slots() {
+    // the firmware image comes with zeros
+    uint32_t slots[SEQUENCE_SLOTS] = {};
+    if (time_set_last_sequence(slots) != 0 || time_set_free_slot(slots) != SEQUENCE_SLOTS) { return false; }
+
+    for (uint32_t sequence = 1; sequence <= 3 * SEQUENCE_SLOTS + 5; sequence++) {
+        write_slot(slots, sequence);
+        if (time_set_last_sequence(slots) != sequence) {
+            printf("sequence %u reads as %u\n", sequence, time_set_last_sequence(slots));
+            return false;
+        }
+    }
+
+    // a write that a reset interrupted can't let a number through twice
+    uint32_t last = time_set_last_sequence(slots);
+    write_slot(slots, last + 1, true);
+    if (time_set_last_sequence(slots) <= last) { return false; }
+    return time_set_free_slot(slots) == (3 * SEQUENCE_SLOTS + 5) % SEQUENCE_SLOTS + 1;
+}
+
+/** checks the time-set messages and the log of their sequence numbers */
+int main() {
+    if (!test_parse()) {
+        printf("time-set payload wrong\n");
+        return 1;
+    }
+    if (!test_check()) {
+        printf("time-set decision wrong\n");
+        return 1;
+    }
+    if (!test_slots()) {
+        printf("time-set sequence log wrong\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1 @@
+../src/tone_sequencer.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/tone_sequencer.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/uart_rx.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/uart_rx.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/uart_tx.cpp
\ No newline at end of file
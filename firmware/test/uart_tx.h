@@ -0,0 +1 @@
+../src/uart_tx.h
\ No newline at end of file
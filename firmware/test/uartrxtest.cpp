@@ -0,0 +1,208 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "uart_rx.h"
+
+/**
+ * Passes bytes to a UARTRxFramer through a DMARxRing, in the same way
+ * as the DMA controller and the RX interrupt handlers do.
+ */
+class DMASimulation {
+public:
+    UARTRxFramer framer;
+    DMARxRing ring;
+    uint32_t remaining = 256;
+    uint32_t interrupts = 0;
+    double isr_ns = 0;
+
+    /** one byte is received by the DMA controller */
+    void receive(uint8_t byte) {
+        this->ring.buf[this->ring.buf.size() - this->remaining] = byte;
+        this->remaining -= 1;
+        if (this->remaining == this->ring.buf.size() / 2) {
+            // half-transfer interrupt
+            this->interrupt();
+        }
+        if (this->remaining == 0) {
+            this->remaining = this->ring.buf.size();
+            // transfer-complete interrupt
+            this->interrupt();
+        }
+    }
+
+    /** an RX interrupt; idle for the idle-line interrupt */
+    void interrupt(bool idle = false) {
+        auto start = std::chrono::steady_clock::now();
+        this->ring.update(this->remaining, this->framer);
+        if (idle) {
+            this->framer.idle();
+        }
+        auto end = std::chrono::steady_clock::now();
+        this->isr_ns += std::chrono::duration<double, std::nano>(end - start).count();
+        this->interrupts += 1;
+    }
+};
+
+static std::vector<uint8_t> read_stdin() {
+    std::vector<uint8_t> result;
+    while (1) {
+        int byte = getchar();
+        if (byte < 0) { break; }
+        result.push_back(static_cast<uint8_t>(byte));
+    }
+    return result;
+}
+
+// a flood of back-to-back 72-character tokens
+static void benchmark() {
+    const uint32_t tokens = 100000;
+    const char *chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::vector<uint8_t> flood;
+    for (uint32_t i = 0; i < tokens; i++) {
+        for (uint32_t j = 0; j < 72; j++) {
+            flood.push_back(static_cast<uint8_t>(chars[std::rand() % 64]));
+        }
+        flood.push_back('\n');
+    }
+
+    // one interrupt per byte
+    UARTRxFramer framer;
+    uint32_t bytewise_interrupts = 0;
+    double bytewise_ns = 0;
+    for (uint8_t byte : flood) {
+        auto start = std::chrono::steady_clock::now();
+        framer.receive(byte);
+        auto end = std::chrono::steady_clock::now();
+        bytewise_ns += std::chrono::duration<double, std::nano>(end - start).count();
+        bytewise_interrupts += 1;
+        framer.poll_message();
+    }
+
+    // DMA, without and with an idle line between the tokens
+    DMASimulation flooded;
+    DMASimulation gaps;
+    for (uint8_t byte : flood) {
+        flooded.receive(byte);
+        while (flooded.framer.poll_message()) {}
+        gaps.receive(byte);
+        if (byte == '\n') {
+            gaps.interrupt();
+            while (gaps.framer.poll_message()) {}
+        }
+    }
+    flooded.interrupt();
+
+    // the host timings include the overhead of steady_clock::now().
+    printf("%u tokens of 73 bytes\n", tokens);
+    printf("byte interrupts:   %6.2f interrupts/token, %7.1f ns ISR time/token\n",
+           static_cast<double>(bytewise_interrupts) / tokens, bytewise_ns / tokens);
+    printf("DMA, back-to-back: %6.2f interrupts/token, %7.1f ns ISR time/token\n",
+           static_cast<double>(flooded.interrupts) / tokens, flooded.isr_ns / tokens);
+    printf("DMA, idle gaps:    %6.2f interrupts/token, %7.1f ns ISR time/token\n",
+           static_cast<double>(gaps.interrupts) / tokens, gaps.isr_ns / tokens);
+}
+
+/**
+ * Receives stdin without polling, like while the main loop is busy
+ * opening the door, then prints the queued messages, one per line,
+ * followed by the drop counters.
+ */
+static void burst() {
+    std::vector<uint8_t> input = read_stdin();
+
+    UARTRxFramer framer;
+    framer.receive(input.data(), input.size());
+
+    while (UARTRxBuffer *message = framer.poll_message()) {
+        fwrite(message->buf.data(), message->buf_pos, 1, stdout);
+        putchar('\n');
+    }
+    printf("dropped %u %u\n", framer.dropped_queue_full, framer.dropped_too_long);
+}
+
+/**
+ * Receives stdin through the DMA ring like a client that sends one line
+ * at a time: the line goes idle after every '\n'. Prints each message.
+ */
+static void lines() {
+    std::vector<uint8_t> input = read_stdin();
+
+    DMASimulation dma;
+    for (uint8_t byte : input) {
+        dma.receive(byte);
+        if (byte == '\n') {
+            dma.interrupt(true);
+        }
+        while (UARTRxBuffer *message = dma.framer.poll_message()) {
+            fwrite(message->buf.data(), message->buf_pos, 1, stdout);
+            putchar('\n');
+        }
+    }
+}
+
+/**
+ * Receives stdin through the DMA ring, with an RX interrupt after every
+ * chunk_size bytes, and polls for messages after every interrupt.
+ * Prints each message on a line.
+ *
+ * Checks that the messages are the same as with one interrupt per byte
+ * and the same polling points.
+ */
+int main(int argc, char **argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0) {
+        benchmark();
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--burst") == 0) {
+        burst();
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--lines") == 0) {
+        lines();
+        return 0;
+    }
+
+    uint32_t chunk_size = 1;
+    if (argc > 1) {
+        chunk_size = static_cast<uint32_t>(std::atoi(argv[1]));
+    }
+
+    std::vector<uint8_t> input = read_stdin();
+
+    DMASimulation dma;
+    UARTRxFramer bytewise;
+
+    auto poll = [&]() {
+        while (1) {
+            UARTRxBuffer *message = dma.framer.poll_message();
+            UARTRxBuffer *expected = bytewise.poll_message();
+            if ((message == nullptr) != (expected == nullptr)) { return false; }
+            if (message == nullptr) { return true; }
+            if (message->buf_pos != expected->buf_pos) { return false; }
+            if (std::memcmp(message->buf.data(), expected->buf.data(), message->buf_pos) != 0) {
+                return false;
+            }
+            fwrite(message->buf.data(), message->buf_pos, 1, stdout);
+            putchar('\n');
+        }
+    };
+
+    for (uint32_t i = 0; i < input.size(); i++) {
+        dma.receive(input[i]);
+        bytewise.receive(input[i]);
+        if ((i + 1) % chunk_size == 0 || i + 1 == input.size()) {
+            dma.interrupt();
+            if (!poll()) {
+                fprintf(stderr, "DMA and bytewise reception disagree\n");
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
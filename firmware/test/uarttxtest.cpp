@@ -0,0 +1,62 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "uart_tx.h"
+
+/**
+ * Adds the lines from stdin to a UARTTxBuffer while a simulated DMA
+ * controller drains it at a limited rate, and prints what has been
+ * transmitted.
+ *
+ * Each line that doesn't fit is reported on stderr as "full <index>".
+ * argv[1] is the number of bytes that are transmitted per line.
+ */
+int main(int argc, char **argv) {
+    uint32_t rate = 16;
+    if (argc > 1) {
+        rate = static_cast<uint32_t>(std::atoi(argv[1]));
+    }
+
+    UARTTxBuffer txbuf;
+    std::vector<uint8_t> transmitted;
+    const uint8_t *chunk = nullptr;
+    uint32_t chunk_size = 0;
+    uint32_t chunk_pos = 0;
+
+    auto transmit = [&](uint32_t count) {
+        while (count--) {
+            if (chunk_pos == chunk_size) {
+                if (chunk_size) { txbuf.finish_chunk(); }
+                chunk_size = txbuf.start_chunk(chunk);
+                chunk_pos = 0;
+                if (chunk_size == 0) { return; }
+            }
+            transmitted.push_back(chunk[chunk_pos++]);
+        }
+    };
+
+    std::vector<uint8_t> line;
+    uint32_t index = 0;
+    while (1) {
+        int byte = getchar();
+        if (byte < 0) { break; }
+        line.push_back(static_cast<uint8_t>(byte));
+        if (byte != '\n') { continue; }
+
+        if (!txbuf.add(line.data(), line.size())) {
+            fprintf(stderr, "full %u\n", index);
+        }
+        line.clear();
+        index += 1;
+
+        transmit(rate);
+    }
+
+    // drain the buffer
+    transmit(static_cast<uint32_t>(-1));
+
+    fwrite(transmitted.data(), transmitted.size(), 1, stdout);
+    return 0;
+}
@@ -0,0 +1 @@
+../src/units.h
\ No newline at end of file
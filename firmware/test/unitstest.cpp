@@ -0,0 +1,128 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "units.h"
+
+static bool check(const char *name, uint64_t input, uint32_t mode_index, uint64_t result, uint64_t expected) {
+    if (result == expected) { return true; }
+    printf("%s(%llu, %u) is %llu, expected %llu\n", name, (unsigned long long)input, mode_index,
+           (unsigned long long)result, (unsigned long long)expected);
+    return false;
+}
+
+/** us_to_s against the 64-bit division, at random values and around multiples of 10^6 */
+static bool test_us_to_s(std::mt19937_64 &rng) {
+    const uint64_t inputs[] = {0, 1, 999999, 1000000, 1000001, UINT64_MAX, UINT64_MAX - 1,
+                               UINT64_MAX / 1000000 * 1000000, UINT64_MAX / 1000000 * 1000000 - 1};
+    for (uint64_t us : inputs) {
+        if (!check("us_to_s", us, 0, units::us_to_s(us), us / 1000000)) { return false; }
+    }
+
+    for (uint32_t i = 0; i < 5000000; i++) {
+        // random values of every magnitude, and the neighbours of multiples of 10^6
+        uint64_t us = rng() >> (i % 64);
+        if (i & 1) { us = us / 1000000 * 1000000 - (i & 2 ? 1 : 0); }
+        if (!check("us_to_s", us, 0, units::us_to_s(us), us / 1000000)) { return false; }
+        if (us <= UINT64_MAX / 1000000 && units::s_to_us(us) != us * 1000000) { return false; }
+    }
+    return true;
+}
+
+/** the microstep conversions against the divisions they replace, in all modes */
+static bool test_microsteps(std::mt19937_64 &rng) {
+    for (uint32_t mode_index = 0; mode_index <= 5; mode_index++) {
+        uint64_t microsteps_per_step = uint64_t(1) << mode_index;
+
+        // all distances up to 16 rev, then random ones of every magnitude
+        for (uint64_t i = 0; i < (uint64_t(1) << 24) + 2000000; i++) {
+            uint32_t urevs = (i < (uint64_t(1) << 24))
+                ? static_cast<uint32_t>(i)
+                : static_cast<uint32_t>(rng() >> (32 + i % 32));
+            uint32_t expected = static_cast<uint32_t>(microsteps_per_step * urevs / units::UREV_PER_STEP);
+            if (!check("urevs_to_microsteps", urevs, mode_index,
+                       units::urevs_to_microsteps(urevs, mode_index), expected)) { return false; }
+        }
+        const uint32_t edges[] = {UINT32_MAX, UINT32_MAX - 1, UINT32_MAX / 5000 * 5000, UINT32_MAX / 5000 * 5000 - 1};
+        for (uint32_t urevs : edges) {
+            uint32_t expected = static_cast<uint32_t>(microsteps_per_step * urevs / units::UREV_PER_STEP);
+            if (!check("urevs_to_microsteps", urevs, mode_index,
+                       units::urevs_to_microsteps(urevs, mode_index), expected)) { return false; }
+        }
+
+        for (uint32_t i = 0; i < 1000000; i++) {
+            uint32_t microsteps = static_cast<uint32_t>(rng() >> (32 + i % 32));
+            uint32_t expected = static_cast<uint32_t>(uint64_t(microsteps) * units::UREV_PER_STEP / microsteps_per_step);
+            if (!check("microsteps_to_urevs", microsteps, mode_index,
+                       units::microsteps_to_urevs(microsteps, mode_index), expected)) { return false; }
+        }
+    }
+    return true;
+}
+
+/** the microstep period against the 64-bit division of StepperMotor::rotate() */
+static bool test_periods(std::mt19937_64 &rng) {
+    for (uint32_t mode_index = 0; mode_index <= 5; mode_index++) {
+        uint64_t microsteps_per_step = uint64_t(1) << mode_index;
+
+        // all speeds up to 16 rev/s, then random ones of every magnitude
+        for (uint64_t i = 1; i < (uint64_t(1) << 24) + 2000000; i++) {
+            uint32_t speed = (i < (uint64_t(1) << 24))
+                ? static_cast<uint32_t>(i)
+                : static_cast<uint32_t>(rng() >> (32 + i % 32)) | 1;
+            uint64_t expected = uint64_t(1000000) * units::UREV_PER_STEP / (microsteps_per_step * speed);
+            if (!check("microstep_period_us", speed, mode_index,
+                       units::microstep_period_us(speed, mode_index), expected)) { return false; }
+        }
+        uint64_t expected = uint64_t(1000000) * units::UREV_PER_STEP / (microsteps_per_step * UINT32_MAX);
+        if (!check("microstep_period_us", UINT32_MAX, mode_index,
+                   units::microstep_period_us(UINT32_MAX, mode_index), expected)) { return false; }
+    }
+
+    for (uint32_t value = 1; value < 2000000; value++) {
+        if (!check("hz_to_period_us", value, 0, units::hz_to_period_us(value), 1000000 / value)) { return false; }
+        if (!check("period_us_to_hz", value, 0, units::period_us_to_hz(value), 1000000 / value)) { return false; }
+    }
+    return true;
+}
+
+template <typename F>
+static void benchmark_one(const char *name, F function) {
+    const uint32_t count = 50000000;
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < count; i++) { sum += function(i); }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    printf("%s: %.2f ns per conversion (%llu)\n", name, ns / count, (unsigned long long)(sum & 1));
+}
+
+/** the host time of a conversion; the divisor is opaque to the compiler in the reference */
+static void benchmark() {
+    volatile uint64_t opaque_s = 1000000;
+    volatile uint64_t opaque_step = units::UREV_PER_STEP;
+    uint64_t divisor_s = opaque_s, divisor_step = opaque_step;
+    uint64_t base = uint64_t(1) << 50;
+
+    benchmark_one("us_to_s             ", [=](uint32_t i) { return units::us_to_s(base + i * 7919ULL); });
+    benchmark_one("us / 1000000        ", [=](uint32_t i) { return (base + i * 7919ULL) / divisor_s; });
+    benchmark_one("urevs_to_microsteps ", [=](uint32_t i) { return units::urevs_to_microsteps(i, i & 3); });
+    benchmark_one("mps * urevs / 5000  ", [=](uint32_t i) { return ((uint64_t(1) << (i & 3)) * i) / divisor_step; });
+    benchmark_one("microstep_period_us ", [=](uint32_t i) { return units::microstep_period_us(i | 1, i & 3); });
+    benchmark_one("5e9 / (mps * speed) ", [=](uint32_t i) { return (divisor_s * divisor_step) / ((uint64_t(1) << (i & 3)) * (i | 1)); });
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark") == 0) {
+        benchmark();
+        return 0;
+    }
+
+    std::mt19937_64 rng(15);
+    if (!test_us_to_s(rng)) { return 1; }
+    if (!test_microsteps(rng)) { return 1; }
+    if (!test_periods(rng)) { return 1; }
+    return 0;
+}
@@ -1,27 +1,40 @@
 import argparse
-from hashlib import sha256
-
 import base64
-import cbor
-import json
+import hmac
+import struct
+import time
+
 import qrcode
 
+HMAC_SIZE = 16
+EPOCH_V2 = 1577836800
+
 cli = argparse.ArgumentParser()
-cli.add_argument("message")
+cli.add_argument("user_id", help="the numeric user id, or the uid text for --legacy")
+cli.add_argument("--validity", type=int, default=300,
+                 help="seconds that the message is valid before and after now")
+cli.add_argument("--legacy", action="store_true",
+                 help="the legacy format with 64-bit timestamps")
 args = cli.parse_args()
 
-message = json.loads(args.message)
-encoded = cbor.dumps(message)
+now = int(time.time())
+
+# message type 1: open the door
+if args.legacy:
+    message = struct.pack('<QQB', now - args.validity, now + args.validity, 1)
+    message += args.user_id.encode()
+else:
+    duration_minutes = min(max(-(-2 * args.validity // 60), 1), 65535)
+    message = struct.pack('<IHBB', now - args.validity - EPOCH_V2, duration_minutes, 1, 2)
+    message += struct.pack('<I', int(args.user_id))
 
 with open('secretkey', 'rb') as fileobj:
     secret_key = fileobj.read()
 
-hashobj = sha256(secret_key)
-hashobj.update(encoded)
-
-signed = hashobj.digest() + encoded
+signed = hmac.new(secret_key, message, 'sha256').digest()[:HMAC_SIZE] + message
+token = base64.b64encode(signed)
 
-qrcode.make(base64.b64encode(signed)).show()
+qrcode.make(token).show()
 
-print(repr(signed[:32]))
-print(repr(signed[32:]))
+print(f"{len(signed)} bytes, {len(token)} base64 characters")
+print(token.decode())
@@ -83,6 +83,13 @@ def gen_token(key: str) -> Optional[str]:
     return res[0]
 
 
+def gen_timeset(key: str, sequence: int) -> Optional[str]:
+    res = _exec_query('SELECT gen_timeset(%s, %s)', key, sequence)
+    if res is None:
+        return None
+    return res[0]
+
+
 def gen_signing_key_token(admin_key: str) -> Optional[str]:
     res = _exec_query('SELECT gen_keyupdate(%s)', admin_key)
     if res is None:
@@ -13,6 +13,7 @@ import settings
 from authentication import User
 from db import (
     gen_token,
+    gen_timeset,
     modify_user,
     add_user,
     enable_user,
@@ -76,6 +77,38 @@ def api_token():
         )
 
 
+@app.route('/api/timeset', methods=['POST'])
+def api_timeset():
+    try:
+        jsn = request.get_json(force=True)
+        if 'key' not in jsn or 'sequence' not in jsn:
+            return app.response_class(
+                response=json.dumps({'error': 'must contain "key" and "sequence" fields'}),
+                status=400,
+                mimetype='application/json'
+            )
+        else:
+            token = gen_timeset(jsn['key'], int(jsn['sequence']))
+            if token is not None:
+                return app.response_class(
+                    response=json.dumps({'token': token}),
+                    status=200,
+                    mimetype='application/json'
+                )
+            else:
+                return app.response_class(
+                    response=json.dumps({'error': 'invalid key or sequence - access denied'}),
+                    status=403,
+                    mimetype='application/json'
+                )
+    except:
+        return app.response_class(
+            response=json.dumps({'error': 'Invalid json'}),
+            status=400,
+            mimetype='application/json'
+        )
+
+
 @app.route('/login', methods=['GET', 'POST'])
 def login():
     if current_user.is_authenticated: